@@ -15,15 +15,36 @@
 
 #include <Arduino.h>
 #include "pdu_controller.h"
+#include "pdu_command_queue.h"
 
 class SerialCommandHandler {
 public:
-    static void handleCommand(const String& command, PDUController& pdu);
+    static void poll(PDUController& pdu);
+    static void handleCommand(const char* command, PDUController& pdu);
+    static void setOutput(Print& stream) { output = &stream; }     // Replies go to Serial by default
 
 private:
-    static void handleSetCommand(const String& command, PDUController& pdu);
-    static void handleGetCommand(const String& command, PDUController& pdu);
+    static char line[SERIAL_LINE_MAX];
+    static size_t lineLength;
+    static bool lineOverflow;           // Characters past SERIAL_LINE_MAX were dropped
+    static Print* output;
+
+    static void handleSetCommand(const char* command, PDUController& pdu);
+    static void handleGetCommand(const char* command, PDUController& pdu);
+    static void submitted(uint32_t ticket);
+    static void reportCommand(const PDUCommand& command, CommandStatus status, void* context);
     static void printStatus(PDUController& pdu);
+    static void printEvents(const char* command);
+    static void printSequence(PDUController& pdu);
+    static void printRules(PDUController& pdu);
+    static void printHeap();
+    static void printPark(PDUController& pdu);
+    static void printMqtt();
+    static void printJournal(const char* command);
+    static void printTrace(bool withData);
+#if PDU_MICROBENCH
+    static void printBench(PDUController& pdu);
+#endif
 };
 
 #endif // SERIAL_COMMAND_HANDLER_H
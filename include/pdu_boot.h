@@ -0,0 +1,40 @@
+/*
+ * PDU Boot Timing Header
+ *
+ * This header defines the PDUBoot class which records a timestamp for
+ * each startup phase, so that time-to-first-relay-decision and the
+ * duration of the deferred Wi-Fi/HTTP bring-up can be tracked.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_BOOT_H
+#define PDU_BOOT_H
+
+#include <Arduino.h>
+
+enum BootPhase {
+    BOOT_OUTPUTS_SAFE,      // All outputs driven to their OFF state
+    BOOT_SETTINGS_LOADED,   // Settings restored from flash
+    BOOT_FIRST_DECISION,    // First IGN/relay decision taken
+    BOOT_SENSORS_READY,     // Temperature sensor bus initialized
+    BOOT_WIFI_READY,        // Access point up
+    BOOT_HTTP_READY,        // Web server accepting requests
+    BOOT_PHASE_COUNT
+};
+
+class PDUBoot {
+public:
+    // Timestamps are microseconds since the application started (0 = not reached yet)
+    static void mark(BootPhase phase) { phaseTimes[phase] = micros(); }
+    static uint32_t getPhaseTime(BootPhase phase) { return phaseTimes[phase]; }
+    static const char* getPhaseName(BootPhase phase);
+
+private:
+    static volatile uint32_t phaseTimes[BOOT_PHASE_COUNT];
+};
+
+#endif // PDU_BOOT_H
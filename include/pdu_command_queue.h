@@ -0,0 +1,110 @@
+/*
+ * PDU Command Queue Header
+ *
+ * This header defines the PDUCommandQueue class which carries control
+ * commands (channel, relay flag, thresholds, sequence profile, VP lockout)
+ * from the interfaces to the controller. Any number of producers can
+ * submit without locks; the controller drains the queue once per
+ * update() and is the only code that changes its own state.
+ *
+ * Commands in the same batch that target the same thing (e.g. repeated
+ * sets of one channel) are coalesced: only the last is applied and the
+ * earlier ones complete as superseded. Every submit returns a ticket whose
+ * result can be polled, and an optional callback is run on the controller
+ * task once the batch has been applied.
+ *
+ * The queue is a bounded ring with a sequence number per cell: producers
+ * claim a position with a compare-and-swap and publish the cell by
+ * storing its sequence, the single consumer frees cells the same way.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_COMMAND_QUEUE_H
+#define PDU_COMMAND_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "pdu_config.h"
+#include "pdu_controller.h"
+
+enum CommandType : uint8_t {
+    CMD_SET_CHANNEL,
+    CMD_SET_RELAY_FLAG,
+    CMD_SET_TEMP_THRESHOLD,
+    CMD_SET_TIME_THRESHOLD,
+    CMD_SET_SEQUENCE,
+    CMD_CLEAR_VP_LOCK,
+    CMD_SET_PARK_MODE
+};
+
+enum CommandStatus : uint8_t {
+    CMD_PENDING,        // Queued, not applied yet
+    CMD_APPLIED,
+    CMD_SUPERSEDED,     // Replaced by a later command for the same target in the same tick
+    CMD_REJECTED,       // Invalid when applied (e.g. sequence dependency cycle)
+    CMD_UNKNOWN         // Never issued, or the result has been overwritten since
+};
+
+struct PDUCommand;
+typedef void (*CommandCallback)(const PDUCommand& command, CommandStatus status, void* context);
+
+struct PDUCommand {
+    uint32_t ticket;
+    CommandType type;
+    uint8_t channel;        // CMD_SET_CHANNEL, CMD_SET_SEQUENCE
+    bool state;             // Channel ON / relay flag / parked mode enabled
+    float temperature;      // CMD_SET_TEMP_THRESHOLD (degC)
+    uint32_t timeMs;        // CMD_SET_TIME_THRESHOLD, CMD_SET_PARK_MODE (wake interval)
+    SequenceStep step;      // CMD_SET_SEQUENCE
+    CommandCallback callback;
+    void* context;
+};
+
+class PDUCommandQueue {
+public:
+    // All submitters return the ticket, or 0 when the queue is full
+    static uint32_t submit(PDUCommand& command);
+    static uint32_t submitAll(PDUCommand* commands, size_t count);   // All or none; last ticket
+    static PDUCommand makeCommand(CommandType type, CommandCallback callback = nullptr, void* context = nullptr);
+    static uint32_t setChannel(uint8_t channel, bool on, CommandCallback callback = nullptr, void* context = nullptr);
+    static uint32_t setRelayFlag(bool on, CommandCallback callback = nullptr, void* context = nullptr);
+    static uint32_t setTempThreshold(float celsius, CommandCallback callback = nullptr, void* context = nullptr);
+    static uint32_t setTimeThreshold(uint32_t ms, CommandCallback callback = nullptr, void* context = nullptr);
+    static uint32_t setSequenceStep(uint8_t channel, const SequenceStep& step,
+                                    CommandCallback callback = nullptr, void* context = nullptr);
+    static uint32_t clearVpLockout(CommandCallback callback = nullptr, void* context = nullptr);
+    static uint32_t setParkMode(bool enabled, uint32_t wakeIntervalMs,
+                                CommandCallback callback = nullptr, void* context = nullptr);
+
+    static CommandStatus getResult(uint32_t ticket);
+    static const char* getStatusName(CommandStatus status);
+    static uint32_t getSubmitted() { return enqueuePos.load(std::memory_order_relaxed); }
+    static uint32_t getRejectedFull() { return fullCount.load(std::memory_order_relaxed); }
+
+    // Consumer side (controller task only)
+    static bool dequeue(PDUCommand& command);
+    static void complete(const PDUCommand& command, CommandStatus status);
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        PDUCommand command;
+    };
+
+    struct Result {
+        std::atomic<uint32_t> ticket;
+        CommandStatus status;
+    };
+
+    static Cell cells[COMMAND_QUEUE_SIZE];
+    static std::atomic<uint32_t> enqueuePos;
+    static uint32_t dequeuePos;
+    static std::atomic<uint32_t> fullCount;
+    static Result results[COMMAND_RESULT_SLOTS];
+};
+
+#endif // PDU_COMMAND_QUEUE_H
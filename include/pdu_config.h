@@ -19,6 +19,9 @@
 #define AP_PASSWORD "password123"
 #define HTTP_USERNAME "admin"
 #define HTTP_PASSWORD "password"
+#define SESSION_TABLE_SIZE 8        // Concurrent authenticated sessions
+#define SESSION_TIMEOUT 1800000UL    // Session idle expiry (30 minutes)
+#define SESSION_COOKIE "PDUSESSION"  // Session cookie name
 
 // Pin Definitions
 #define F1_PIN 14     // Fuse ind CH1 (input)
@@ -38,14 +41,132 @@
 // Timing Constants
 #define CH1_PULSE 100           // 100ms pulse for CH1
 #define CH1_OFF_TIME 50         // 50ms off time for CH1
-#define CH_ACTIVATE_DELAY 10000 // 10s before other channels
+#define CH_ACTIVATE_DELAY 10000 // Worst-case wait before other channels (sequence timeout)
 #define RELAY_DELAY 50          // 50ms after relay on
-#define TEMP_CHECK_INTERVAL 1000 // Temperature check interval (1 second)
+#define TEMP_CHECK_INTERVAL 1000 // Temperature check interval when approaching the threshold (1 second)
 #define DEBOUNCE_DELAY 150      // Debounce period (ms)
 #define MAX_VP_RESETS 3        // Maximum number of VP reset attempts
+#define VP_RETRY_DELAY 30000   // CH1 off time before a VP reset attempt (ms)
+
+// Power-Up Sequence Defaults (CH2-CH4, see SequenceStep)
+#define SEQ_DEFAULT_STABLE_MS 500   // CH1 ON with VP LOW for this long before a channel starts
+#define SEQ_DEFAULT_STAGGER_MS 200  // Default delay of CH3/CH4 after the previous channel (inrush)
+
+// Adaptive Sensor Sampling (temperature and battery share one schedule)
+#define TEMP_SLOW_INTERVAL 5000     // Check interval far from the threshold and stable (ms)
+#define TEMP_SLOW_BITS 9            // DS18B20 resolution when far (0.5 degC, 94 ms conversion)
+#define TEMP_NORMAL_BITS 11         // Resolution when approaching (0.125 degC, 375 ms)
+#define TEMP_FAST_BITS 12           // Resolution near the threshold, back-to-back (0.0625 degC, 750 ms)
+#define TEMP_FAR_MARGIN 10.0f       // Projected reading this far below the threshold is "far" (degC)
+#define TEMP_NEAR_MARGIN 3.0f       // Projected reading within this of the threshold is "near" (degC)
+#define TEMP_MARGIN_HYST 1.0f       // Extra margin needed before slowing down again (degC)
+#define TEMP_LOOKAHEAD 30000        // Readings are projected this far ahead along the rise rate (ms)
+#define TEMP_STABLE_RATE 0.05f      // Faster change than this is not "stable" (degC/s)
+#define TEMP_RATE_SMOOTHING 0.25f   // Weight of the newest rate in the smoothed rate
+#define BATTERY_STABLE_STEP 0.2f    // Battery change between samples that is not "stable" (V)
 
 // Default Values
 #define DEFAULT_TEMP_THRESHOLD 65.0f  // Default temperature threshold (°C)
 #define DEFAULT_TIME_THRESHOLD 300000  // Default time threshold (ms)
 
+// Logging Configuration
+#ifndef PDU_LOG_LEVEL
+#define PDU_LOG_LEVEL PDU_LOG_LEVEL_INFO  // Compile-time log level filter
+#endif
+#define LOG_BUFFER_SIZE 2048    // Ring buffer size for pending log output (bytes)
+#define LOG_LINE_MAX 128        // Maximum length of a single log message
+#define LOG_DRAIN_INTERVAL 20   // Drain task poll interval when idle (ms)
+#define LOG_TASK_STACK 2048     // Drain task stack size (bytes)
+#define WEB_INIT_TASK_STACK 4096 // Background Wi-Fi/HTTP start-up task stack size (bytes)
+
+// Heap Configuration
+#ifndef PDU_NO_STRING
+#define PDU_NO_STRING 0         // 1 = Arduino String is a compile error in firmware sources
+#endif
+#ifndef PDU_HEAP_TRACE
+#define PDU_HEAP_TRACE 0        // 1 = count loop-task allocations (link with -Wl,--wrap=malloc,...)
+#endif
+#ifndef PDU_MICROBENCH
+#define PDU_MICROBENCH 0        // 1 = build the microbenchmark suite and the GET_BENCH command
+#endif
+#define JSON_BUFFER_SIZE 512    // HTTP response buffer; larger responses are sent chunked
+#define SERIAL_LINE_MAX (RULES_MAX_SOURCE + 16)  // Longest serial command line (bytes)
+
+// Event Log Configuration
+#define EVENT_LOG_SIZE 256          // Number of input/output events kept in RAM
+#define EVENT_MAX_PER_REQUEST 64    // Maximum events returned per /api/events call
+
+// Rules Engine Configuration
+#define RULES_MAX_SOURCE 512        // Maximum rule program text length (bytes, persisted)
+#define RULES_MAX_CODE 128          // Maximum bytecode instructions (bounds tick cost)
+#define RULES_MAX_CONSTANTS 32      // Maximum numeric constants per program
+#define RULES_MAX_RULES 16          // Maximum rules per program
+#define RULES_MAX_STATE 16          // Maximum hysteresis/timer primitives per program
+#define RULES_MAX_STACK 16          // Evaluation stack depth and maximum ( / ! nesting
+
+// Fault Journal Configuration
+#define JOURNAL_PARTITION "journal" // Data partition label (see partitions.csv)
+#define JOURNAL_SECTOR_SIZE 4096    // Flash erase unit (bytes)
+#define JOURNAL_MAX_SECTORS 64      // Largest partition used (sectors)
+#define JOURNAL_QUEUE_SIZE 16       // Records waiting for the writer task
+#define JOURNAL_TAIL_CACHE 32       // Most recent records served from RAM
+#define JOURNAL_MAX_PER_REQUEST 32  // Maximum records returned per /api/journal call
+#define JOURNAL_POLL_INTERVAL 50    // Writer task poll interval when idle (ms)
+#define JOURNAL_TASK_STACK 3072     // Writer task stack size (bytes)
+
+// Warm Restart Configuration (state kept in RTC memory across resets)
+#define WARM_BOOT_LIMIT 3           // Consecutive warm restarts before falling back to a cold start
+#define WARM_STABLE_TIME 60000      // Uptime after which a restart no longer counts as consecutive (ms)
+#define WARM_SAVE_INTERVAL 100      // Runtime block refresh while nothing changes (ms; restored timers lag by up to this)
+
+// Parked Mode Configuration (sleep after an IGN-off shutdown)
+#define PARK_WAKE_PIN IGN_PIN       // Wake-up input; deep sleep needs an RTC GPIO, otherwise light sleep is used
+#define PARK_DELAY 10000            // Relay OFF with IGN LOW this long before sleeping (ms)
+#define PARK_WAKE_INTERVAL 3600000  // Default timer wake-up to check the battery (ms, 0 = IGN only)
+#define PARK_LOW_BATTERY 11.8f      // Battery voltage journaled as low during a parked check (V)
+#define PARK_FLUSH_TIMEOUT 500      // Longest wait for the journal writer before sleeping (ms)
+#define PARK_ACTIVE_CURRENT 110000  // Estimated supply current, awake with the access point up (uA)
+#define PARK_AWAKE_CURRENT 40000    // Estimated supply current, awake with the radio off (uA)
+#define PARK_LIGHT_CURRENT 1500     // Estimated supply current in light sleep (uA)
+#define PARK_DEEP_CURRENT 150       // Estimated supply current in deep sleep, outputs held (uA)
+
+// Trace Recorder Configuration
+#define TRACE_BUFFER_SIZE 8192      // Recorded inputs and commands (bytes, RAM)
+#define TRACE_ADC_DEADBAND 4        // Battery ADC change (raw counts) worth a new record
+#define TRACE_HEX_LINE 24           // Trace bytes per GET_TRACE line
+
+// Microbenchmark Configuration (PDU_MICROBENCH builds)
+#define BENCH_MIN_TIME 200          // Timed run per case (ms)
+#define BENCH_REPEATS 25            // Timed batches per case; the fastest is reported
+#define BENCH_STACK_PROBE 4096      // Stack painted below the harness to find a case's depth (bytes)
+#define BENCH_STACK_GUARD 256       // Unpainted gap below the harness's own frame (bytes)
+
+// Modbus TCP Configuration
+#define MODBUS_PORT 502             // Modbus TCP listening port
+#define MODBUS_MAX_CLIENTS 4        // Concurrent Modbus connections
+#define MODBUS_IDLE_TIMEOUT 60000   // Connections silent this long are closed (ms)
+#define MODBUS_POLL_INTERVAL 5      // Server task poll interval when idle (ms)
+#define MODBUS_TASK_STACK 4096      // Server task stack size (bytes)
+
+// MQTT Telemetry Configuration (station mode, off until a broker is set with SET_MQTT)
+#define STA_SSID ""                 // Network joined for MQTT; the access point stays up
+#define STA_PASSWORD ""
+#define MQTT_BROKER_MAX 64          // Broker host name or address, including the terminator
+#define MQTT_DEFAULT_PORT 1883      // Broker port until one is set
+#define MQTT_TOPIC_PREFIX "pdu/"    // Batches go to <prefix><client id>/telemetry
+#define MQTT_KEEPALIVE 60           // Keep-alive announced to the broker (s)
+#define MQTT_RETRY_INTERVAL 5000    // Wait between network / broker connection attempts (ms)
+#define MQTT_ACK_TIMEOUT 10000      // CONNACK / PUBACK wait before reconnecting (ms)
+#define MQTT_POLL_INTERVAL 20       // Publisher task poll interval (ms)
+#define MQTT_TASK_STACK 4096        // Publisher task stack size (bytes)
+#define TELEMETRY_SAMPLE_INTERVAL 1000  // Status sample period (ms)
+#define TELEMETRY_BATCH_PERIOD 60000    // Default longest time a batch stays open (ms)
+#define TELEMETRY_BATCH_SAMPLES 60      // Default samples per batch
+#define TELEMETRY_BATCH_MAX 1024        // Encoded batch size limit; a full batch is closed early (bytes)
+#define TELEMETRY_SPOOL_SIZE 16384      // Batches kept while the broker is unreachable (bytes, oldest dropped)
+
+// Command Queue Configuration
+#define COMMAND_QUEUE_SIZE 16       // Commands waiting for the controller (power of two)
+#define COMMAND_RESULT_SLOTS 32     // Completed command results kept for polling (power of two)
+
 #endif // PDU_CONFIG_H
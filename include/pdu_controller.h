@@ -15,15 +15,52 @@
 #define PDU_CONTROLLER_H
 
 #include <Arduino.h>
+#include <atomic>
 #include <OneWire.h>
 #include <DallasTemperature.h>
 #include <Preferences.h>
 #include "pdu_config.h"
+#include "pdu_event_log.h"
+#include "pdu_rules.h"
+#include "pdu_journal.h"
+#include "pdu_trace.h"
+
+struct PDUCommand;
+struct WarmSettings;
+struct WarmRuntime;
+
+// Power-up profile entry for one of CH2-CH4
+struct SequenceStep {
+    uint32_t delayMs;     // Wait after all dependencies are ON
+    uint32_t stableMs;    // Require CH1 ON and VP LOW for this long (0 = no condition)
+    uint32_t timeoutMs;   // Ignore stableMs this long after sequence start (0 = never)
+    uint8_t dependsOn;    // Channels that must be ON first (bit0 = CH1 ... bit3 = CH4)
+};
+
+#define SEQ_STEP_COUNT 3  // Sequenced channels (CH2-CH4); CH1 always starts first
+
+// Status as served to clients, refreshed at the end of every update(). Values are
+// rounded to the precision they are reported with, so only visible changes count.
+struct PDUStatus {
+    uint8_t fuses[4];       // F1-F4 pin levels
+    uint8_t ign;
+    uint8_t relay;          // Relay output state
+    uint8_t vpLocked;
+    uint8_t channels[4];    // 1 = ON
+    float temp;
+    float tempThreshold;
+    float battery;
+    uint32_t timeThreshold;
+    uint32_t vpTrips;
+    uint32_t vpTripLatencyUs;       // ISR entry to CH1 cut (interrupt dispatch not included)
+    uint32_t vpTripMaxLatencyUs;
+};
 
 class PDUController {
 public:
     PDUController();
     void begin();
+    void beginSensors();
     void update();
     
     // Channel Control
@@ -32,6 +69,10 @@ public:
     void setChannel(uint8_t channel, bool state);
     bool getChannelState(uint8_t channel) const;
     void handleVPFault();
+    bool isCh1Locked() const { return vpResetAttempts > MAX_VP_RESETS; }
+    void clearVpLockout();
+    bool isSequenceRunning() const { return seqPhase != SEQ_IDLE; }
+    unsigned long getLastSequenceTime() const { return lastSequenceTime; }
     
     // Settings
     void setTempThreshold(float temp);
@@ -40,14 +81,43 @@ public:
     float getTempThreshold() const { return tempThreshold; }
     unsigned long getTimeThreshold() const { return timeThreshold; }
     bool getRelayFlag() const { return relayFlag; }
+    bool getParkEnabled() const { return parkEnabled; }
+    uint32_t getParkWakeInterval() const { return parkWakeInterval; }
+    bool setSequenceStep(uint8_t channel, const SequenceStep& step);
+    bool isSequenceStepValid(uint8_t channel, const SequenceStep& step) const;
+    const SequenceStep& getSequenceStep(uint8_t channel) const { return sequenceProfile[channel - 2]; }
+
+    // Rules (replace the built-in temperature/IGN-off shutdown while loaded)
+    bool loadRules(const char* source, char* error, size_t errorSize);
+    const PDURulesEngine& getRules() const { return rules; }
+
+    // Trace recording (inputs, samples and commands for host replay)
+    void startTrace();
+    void stopTrace();
     
     // Status
     float getCurrentTemp() const { return currentTemp; }
     float getBatteryVoltage() const { return batteryVoltage; }
+    float sampleBattery();      // Reads the battery input now instead of with the next temperature sample
     bool getRelayState() const { return relayState; }
+    uint32_t getRelayOnTime() const { return relayOnTime; }     // micros() when the relay last switched ON
+    uint32_t getVpTripCount() const { return vpTripCount; }
+    uint32_t getLastVpTripTime() const { return vpTripTime; }
+    uint32_t getLastVpTripLatency() const { return vpTripLatency; }
+    uint32_t getMaxVpTripLatency() const { return maxVpTripLatency; }
+    uint32_t getLastTickTime() const { return lastTickUs; }
+    uint32_t getMaxTickTime() const { return maxTickUs; }
+    uint32_t getSampleInterval() const;
+    uint8_t getSampleResolution() const;
+    float getTempRate() const { return tempRate; }
     void printStatus() const;
+    const PDUStatus& getStatus() const { return status; }
+    uint32_t getStateVersion() const { return stateVersion; }   // Bumped whenever getStatus() changes
+    void readStatus(PDUStatus& out, uint32_t& version) const;   // Consistent copy for other tasks
 
 private:
+    friend class PDUMicrobench;     // Drains the command queue outside update()
+
     // Hardware interfaces
     OneWire oneWire;
     DallasTemperature sensors;
@@ -55,7 +125,10 @@ private:
 
     // State variables
     bool relayState;
+    uint32_t relayOnTime;
     bool relayFlag;
+    bool parkEnabled;
+    uint32_t parkWakeInterval;
     float currentTemp;
     float tempThreshold;
     unsigned long timeThreshold;
@@ -63,21 +136,84 @@ private:
     float batteryVoltage;
     unsigned long ignLowStartTime;
     unsigned long lastTempCheckTime;
+    bool sensorsReady;
     unsigned long lastStableTime;
     int lastStableState;
+    uint16_t batteryAdc;
+
+    // Adaptive sampling: conversions run in the background, the level sets interval and resolution
+    enum SampleLevel { SAMPLE_SLOW, SAMPLE_NORMAL, SAMPLE_FAST };
+    SampleLevel sampleLevel;
+    bool conversionPending;
+    bool tempValid;
+    unsigned long conversionStartTime;
+    float tempRate;         // Smoothed rate of change (degC/s)
     
     // VP monitoring state
     int lastVpPinState;
     int lastCh1PinState;
     unsigned long lastNormalOpTime;
     bool faultHandlingInProgress;
+    unsigned long vpFaultStartTime;
+
+    // VP fast-trip state (written from the VP_PIN interrupt)
+    volatile bool vpTripPending;
+    volatile uint32_t vpTripTime;
+    volatile uint32_t vpTripLatency;            // ISR entry to CH1 write, excludes interrupt dispatch
+    volatile uint32_t vpTripCount;
+    uint32_t maxVpTripLatency;
+
+    // Power-up sequencer state
+    enum SequencePhase { SEQ_IDLE, SEQ_RELAY, SEQ_CH1_PULSE, SEQ_CH1_OFF, SEQ_CHANNELS };
+    SequenceStep sequenceProfile[SEQ_STEP_COUNT];
+    SequencePhase seqPhase;
+    unsigned long seqPhaseTime;
+    unsigned long seqStartTime;
+    unsigned long seqUpTime[4];     // Time each channel came up, relative to seqStartTime
+    uint8_t seqPendingMask;
+    bool vpLowValid;
+    unsigned long vpLowSince;
+    unsigned long lastSequenceTime;
+
+    PDURulesEngine rules;
+    uint8_t ruleHeldOff;            // Channels held off by the last evaluation; skipped by the sequencer
+    uint32_t lastTickUs;
+    uint32_t maxTickUs;
+
+    // Trace state: last event log entry and sample values already recorded
+    uint32_t traceEventSeq;
+    float traceTemp;
+    uint16_t traceBatteryAdc;
+
+    PDUStatus status;
+    uint32_t stateVersion;
+    std::atomic<uint32_t> statusSeq;    // Odd while updateStatus() is writing status
 
     // Private methods
-    void initPins();
+    void initPins(uint8_t outputsOn);
+    void writeOutput(uint8_t pin, uint8_t level);
     void loadSettings();
     void saveSettings();
+    void applyWarmSettings(const WarmSettings& settings);
+    void mirrorSettings();
+    void restoreRuntime(const WarmRuntime& runtime);
+    void saveWarmState();
     int debounceIgn();
     void updateSensors();
+    void updateStatus();
+    void selectSampleLevel(float previousBattery);
+    void traceInputs();
+    void processCommands();
+    bool applyCommand(const PDUCommand& command, bool& settingsChanged);
+    bool updateSequenceStep(uint8_t channel, const SequenceStep& step);
+    void startVPRecovery();
+    bool evaluateRules(int ignState);
+    void journalShutdown(JournalEventType reason, int ignState);
+    void runSequencer();
+    void setSequencePhase(SequencePhase phase);
+    static int channelPin(uint8_t channel);
+    static bool isProfileValid(const SequenceStep* profile);
+    static void IRAM_ATTR vpFaultIsr(void* arg);
 };
 
 #endif // PDU_CONTROLLER_H
@@ -0,0 +1,51 @@
+/*
+ * PDU Event Log Header
+ *
+ * This header defines the PDUEventLog class which captures input edges
+ * (fuses, IGN, VP) and output changes (channels, relay) as microsecond
+ * timestamped events in a lock-free ring buffer. Events can be written
+ * from interrupt handlers and read incrementally by sequence number for
+ * post-mortem analysis of electrical faults.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_EVENT_LOG_H
+#define PDU_EVENT_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "pdu_config.h"
+
+struct PDUEvent {
+    uint32_t seq;
+    uint32_t timestampUs;
+    uint8_t pin;
+    uint8_t level;
+};
+
+class PDUEventLog {
+public:
+    static void begin();
+    static void IRAM_ATTR record(uint8_t pin, uint8_t level);
+    static size_t read(uint32_t since, PDUEvent* out, size_t maxEvents, uint32_t& next);
+    static uint32_t getNextSeq() { return writeSeq.load(); }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq;  // seq + 1 once the slot is fully written
+        uint32_t timestampUs;
+        uint8_t pin;
+        uint8_t level;
+    };
+
+    static Slot slots[EVENT_LOG_SIZE];
+    static std::atomic<uint32_t> writeSeq;
+
+    static void IRAM_ATTR edgeIsr(void* arg);
+};
+
+#endif // PDU_EVENT_LOG_H
@@ -0,0 +1,50 @@
+/*
+ * PDU Heap Telemetry Header
+ *
+ * This header defines the PDUHeap class which reports free heap, largest
+ * free block and minimum-ever free heap, and counts the allocations made by
+ * the main loop task in each loop() iteration. Allocation counting needs
+ * PDU_HEAP_TRACE and the linker wrapping malloc/calloc/realloc (see
+ * platformio.ini); without it the counters stay at zero.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_HEAP_H
+#define PDU_HEAP_H
+
+#include <Arduino.h>
+#include "pdu_config.h"
+
+class PDUHeap {
+public:
+    static void begin();        // Count allocations made by the calling (loop) task
+    static void beginTick();
+    static void endTick();
+    static void countAllocation();
+
+    static uint32_t getFree() { return ESP.getFreeHeap(); }
+    static uint32_t getLargestBlock() { return ESP.getMaxAllocHeap(); }
+    static uint32_t getMinFree() { return ESP.getMinFreeHeap(); }
+    static bool isTracing() { return PDU_HEAP_TRACE; }
+
+    static uint32_t getAllocCount() { return allocCount; }
+    static uint32_t getLastTickAllocs() { return lastTickAllocs; }
+    static uint32_t getMaxTickAllocs() { return maxTickAllocs; }
+    static uint32_t getAllocTicks() { return allocTicks; }
+    static uint32_t getTickCount() { return tickCount; }
+
+private:
+    static TaskHandle_t loopTask;
+    static volatile uint32_t allocCount;
+    static uint32_t tickStartCount;
+    static uint32_t lastTickAllocs;
+    static uint32_t maxTickAllocs;
+    static uint32_t allocTicks;     // Ticks that allocated at least once
+    static uint32_t tickCount;
+};
+
+#endif // PDU_HEAP_H
@@ -0,0 +1,121 @@
+/*
+ * PDU Fault Journal Header
+ *
+ * This header defines the PDUJournal class, an append-only log of faults
+ * and shutdowns (VP trips, retries and lockouts, thermal trips, IGN
+ * timeouts, rule shutdowns, boots) kept on a dedicated flash partition so
+ * the history survives reboots and power loss.
+ *
+ * Records are 32 bytes with a CRC-32 and are written in order through the
+ * partition's sectors; when a sector is full the writer moves to the next
+ * one, which is always kept erased, and the oldest sector is erased in
+ * the background. Every sector is erased once per pass, so wear is spread
+ * evenly. A write cut short by a reset fails its CRC and is skipped.
+ *
+ * append() only copies into RAM: flash writes and erases happen in a
+ * low-priority writer task. That does not keep flash off the control
+ * path: while the SPI flash is written or erased the cache is disabled on
+ * both cores, so the loop task and the (non-IRAM) VP interrupt stall too,
+ * for tens of microseconds per record and tens of milliseconds per sector
+ * erase. Background erases are therefore only done while the relay is
+ * OFF (setEraseAllowed()); with the relay ON a sector is erased only when
+ * the writer needs it, at most once every SLOTS_PER_SECTOR records.
+ * The latest records are also kept in RAM for tail reads; older records
+ * are looked up by sequence number through a per-sector index.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_JOURNAL_H
+#define PDU_JOURNAL_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include "pdu_config.h"
+
+enum JournalEventType : uint8_t {
+    JOURNAL_BOOT = 1,           // value = reset reason
+    JOURNAL_VP_TRIP = 2,        // value = reset attempt, value2 = ISR latency (us, -1 = polled)
+    JOURNAL_VP_RETRY = 3,       // value = reset attempt
+    JOURNAL_VP_LOCKOUT = 4,     // value = reset attempts made
+    JOURNAL_VP_UNLOCK = 5,      // Lockout cleared by the operator
+    JOURNAL_THERMAL_TRIP = 6,   // value = temperature, value2 = threshold (0.01 degC)
+    JOURNAL_IGN_TIMEOUT = 7,    // value = ms since IGN went LOW, value2 = threshold (ms)
+    JOURNAL_RULES_TRIP = 8,     // value = temperature (0.01 degC), value2 = IGN level
+    JOURNAL_PARK = 9,           // value = 1 deep / 0 light sleep, value2 = battery (0.01 V)
+    JOURNAL_PARK_WAKE = 10,     // value = wake-to-relay latency (us), value2 = time parked (s)
+    JOURNAL_PARK_LOW_BATTERY = 11   // value = battery, value2 = PARK_LOW_BATTERY (0.01 V)
+};
+
+struct JournalRecord {
+    uint32_t seq;
+    uint32_t bootCount;
+    uint32_t timeMs;        // millis() when the event happened
+    uint8_t type;
+    uint8_t reserved[3];
+    int32_t value;
+    int32_t value2;
+    uint32_t reserved2;
+    uint32_t crc;           // CRC-32 of the bytes above
+};
+
+class PDUJournal {
+public:
+    static bool begin();
+    static uint32_t append(JournalEventType type, int32_t value = 0, int32_t value2 = 0);
+
+    static size_t read(uint32_t since, JournalRecord* out, size_t maxRecords, uint32_t& next);
+    static bool find(uint32_t seq, JournalRecord& out);
+    static const char* getTypeName(uint8_t type);
+
+    static bool isMounted() { return partition != nullptr; }
+    static uint32_t getNextSeq() { return nextSeq; }
+    static uint32_t getOldestSeq();
+    static uint32_t getBootCount() { return bootCount; }
+    static uint32_t getCapacity();
+    static uint32_t getEraseCount() { return eraseCount; }
+    static uint32_t getDroppedCount() { return droppedCount; }
+    static bool isFlushed() { return queueTail == queueHead && pendingErase == 0; }   // Safe to power down
+    static void setEraseAllowed(bool allowed) { eraseAllowed = allowed; }   // Background erases (relay OFF)
+
+    static uint32_t crc32(const uint8_t* data, size_t length);   // CRC-32 (IEEE 802.3)
+
+private:
+    static const uint32_t RECORD_SIZE = 32;
+    static const uint32_t SLOTS_PER_SECTOR = JOURNAL_SECTOR_SIZE / RECORD_SIZE;
+    static const uint32_t EMPTY_SECTOR = 0xFFFFFFFF;
+
+    static const esp_partition_t* partition;
+    static uint16_t sectorCount;
+    static uint32_t sectorFirstSeq[JOURNAL_MAX_SECTORS];  // EMPTY_SECTOR = no records
+    static uint64_t pendingErase;                         // Bit n = sector n must be erased
+    static uint16_t writeSector;
+    static uint16_t writeSlot;
+    static uint32_t nextSeq;
+    static uint32_t bootFirstSeq;   // First record appended since this boot
+    static uint32_t bootCount;
+    static uint32_t eraseCount;
+    static uint32_t droppedCount;
+    static volatile bool eraseAllowed;
+
+    // Records waiting for the writer task, and the most recent records for tail reads
+    static JournalRecord queue[JOURNAL_QUEUE_SIZE];
+    static volatile size_t queueHead;
+    static volatile size_t queueTail;
+    static JournalRecord tail[JOURNAL_TAIL_CACHE];
+    static portMUX_TYPE mux;
+
+    static void mount();
+    static bool readSlot(uint16_t sector, uint16_t slot, JournalRecord& record);
+    static bool isErased(const JournalRecord& record);
+    static bool isSectorErased(uint16_t sector);
+    static uint32_t store(JournalRecord& record);
+    static bool writeRecord(JournalRecord& record);
+    static void eraseSector(uint16_t sector);
+    static void writerTask(void* param);
+};
+
+#endif // PDU_JOURNAL_H
@@ -0,0 +1,70 @@
+/*
+ * PDU Logger Header
+ *
+ * This header defines the PDULogger class, a buffered logging facility
+ * that keeps UART output off the control path. Messages are formatted
+ * into a preallocated ring buffer and written to Serial by a low-priority
+ * drain task. When the buffer is full, messages are dropped and counted
+ * instead of blocking the caller.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_LOGGER_H
+#define PDU_LOGGER_H
+
+#include <Arduino.h>
+#include "pdu_config.h"
+
+// Log levels (compile-time filter, see PDU_LOG_LEVEL in pdu_config.h)
+#define PDU_LOG_LEVEL_NONE  0
+#define PDU_LOG_LEVEL_ERROR 1
+#define PDU_LOG_LEVEL_WARN  2
+#define PDU_LOG_LEVEL_INFO  3
+#define PDU_LOG_LEVEL_DEBUG 4
+
+class PDULogger {
+public:
+    static void begin();
+    static void log(const char* format, ...) __attribute__((format(printf, 1, 2)));
+    static uint32_t getDroppedCount();
+
+private:
+    static char buffer[LOG_BUFFER_SIZE];
+    static volatile size_t head;
+    static volatile size_t tail;
+    static volatile uint32_t droppedCount;
+    static portMUX_TYPE bufferMux;
+
+    static void write(const char* data, size_t length);
+    static void drainTask(void* param);
+};
+
+#if PDU_LOG_LEVEL >= PDU_LOG_LEVEL_ERROR
+#define LOG_ERROR(...) PDULogger::log(__VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if PDU_LOG_LEVEL >= PDU_LOG_LEVEL_WARN
+#define LOG_WARN(...) PDULogger::log(__VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if PDU_LOG_LEVEL >= PDU_LOG_LEVEL_INFO
+#define LOG_INFO(...) PDULogger::log(__VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if PDU_LOG_LEVEL >= PDU_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) PDULogger::log(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#endif // PDU_LOGGER_H
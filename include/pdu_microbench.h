@@ -0,0 +1,72 @@
+/*
+ * PDU Microbenchmark Header
+ *
+ * This header defines the PDUMicrobench class, a small suite that times
+ * the controller and protocol hot paths (update(), the status JSON, serial
+ * GET/SET handling, setChannel(), a telemetry sample) and reports ns/op,
+ * allocations/op and the deepest stack use of each case.
+ *
+ * Cases are timed with the CPU cycle counter: on the device through the
+ * GET_BENCH serial command, on the host by tools/bench/pdu_microbench,
+ * which keeps a baseline and fails on regressions. The suite runs in the
+ * calling task and holds it for a few hundred ms per case, so it is only
+ * built when PDU_MICROBENCH is set.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_MICROBENCH_H
+#define PDU_MICROBENCH_H
+
+#include <Arduino.h>
+#include "pdu_config.h"
+
+#if PDU_MICROBENCH
+
+class PDUController;
+class PDUWebServer;
+
+struct BenchResult {
+    const char* name;
+    uint32_t iterations;    // Operations per timed batch
+    float nsPerOp;          // Fastest of BENCH_REPEATS batches
+    float allocsPerOp;      // Loop-task allocations (counted when PDU_HEAP_TRACE is set)
+    uint32_t stackBytes;    // Deepest stack use below the harness (BENCH_STACK_GUARD at least)
+};
+
+class PDUMicrobench {
+public:
+    static const size_t CASE_COUNT = 6;
+
+    // Fills results[0..CASE_COUNT) and returns the number of cases run
+    static size_t run(PDUController& pdu, PDUWebServer& web, BenchResult* results,
+                      uint32_t minTimeMs = BENCH_MIN_TIME);
+
+private:
+    struct Case {
+        const char* name;
+        void (*op)();
+    };
+
+    static const Case cases[CASE_COUNT];
+    static PDUController* pdu;
+    static PDUWebServer* web;
+
+    static void measure(const Case& benchCase, uint32_t minTimeMs, BenchResult& result);
+    static uint32_t timeBatch(void (*op)(), uint32_t iterations);
+    static uint32_t measureStack(void (*op)());
+
+    static void opUpdate();
+    static void opStatusJson();
+    static void opSerialGet();
+    static void opSerialSet();
+    static void opSetChannel();
+    static void opTelemetrySample();
+};
+
+#endif // PDU_MICROBENCH
+
+#endif // PDU_MICROBENCH_H
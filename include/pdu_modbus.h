@@ -0,0 +1,125 @@
+/*
+ * PDU Modbus TCP Server Header
+ *
+ * This header defines the PDUModbusServer class which serves a fixed
+ * Modbus register map for SCADA/PLC integration, as a binary alternative
+ * to polling /api/status. The server runs in its own task and handles up
+ * to MODBUS_MAX_CLIENTS connections at once.
+ *
+ * Reads are answered from the controller's status snapshot (readStatus())
+ * without any text formatting. Writes are submitted to the command queue,
+ * so they are applied by the controller on its next tick, exactly like
+ * serial and HTTP commands; a full queue is reported as exception 06
+ * (server device busy).
+ *
+ * Register map (zero-based addresses, any unit id):
+ *
+ *   Coils (01 read, 05/15 write)
+ *     0-3   CH1-CH4 (1 = ON)
+ *     4     Relay: reads the relay output, writes the relay enable flag
+ *     5     CH1 VP lockout: reads 1 while locked, write 0 to clear
+ *   Discrete inputs (02)
+ *     0-3   F1-F4 fuse inputs (pin level)
+ *     4     IGN input (pin level)
+ *   Input registers (04)
+ *     0     Temperature (degC x 100, signed)
+ *     1     Battery voltage (V x 100)
+ *     2-3   VP trip count (32 bit, high word first)
+ *     4-5   Last VP trip latency (us, 32 bit, ISR entry to CH1 cut)
+ *     6-7   Worst VP trip latency (us, 32 bit, ISR entry to CH1 cut)
+ *     8-9   Status version, changes whenever any value above does (32 bit)
+ *   Holding registers (03 read, 06/16 write)
+ *     0     Temperature threshold (degC x 100, signed)
+ *     1     Time threshold (s)
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_MODBUS_H
+#define PDU_MODBUS_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "pdu_config.h"
+#include "pdu_controller.h"
+
+#define MODBUS_MBAP_SIZE 7      // Transaction id, protocol id, length, unit id
+#define MODBUS_ADU_MAX 260      // Largest Modbus TCP frame (bytes)
+
+enum ModbusCoil {
+    MB_COIL_CH1 = 0,            // CH2-CH4 follow
+    MB_COIL_RELAY = 4,
+    MB_COIL_VP_LOCK = 5,
+    MB_COIL_COUNT
+};
+
+enum ModbusDiscreteInput {
+    MB_INPUT_F1 = 0,            // F2-F4 follow
+    MB_INPUT_IGN = 4,
+    MB_INPUT_COUNT
+};
+
+enum ModbusInputRegister {
+    MB_IREG_TEMP = 0,
+    MB_IREG_BATTERY = 1,
+    MB_IREG_VP_TRIPS = 2,
+    MB_IREG_VP_LATENCY = 4,
+    MB_IREG_VP_MAX_LATENCY = 6,
+    MB_IREG_VERSION = 8,
+    MB_IREG_COUNT = 10
+};
+
+enum ModbusHoldingRegister {
+    MB_HREG_TEMP_THRESHOLD = 0,
+    MB_HREG_TIME_THRESHOLD = 1,
+    MB_HREG_COUNT
+};
+
+enum ModbusException : uint8_t {
+    MB_EX_NONE = 0,
+    MB_EX_ILLEGAL_FUNCTION = 0x01,
+    MB_EX_ILLEGAL_ADDRESS = 0x02,
+    MB_EX_ILLEGAL_VALUE = 0x03,
+    MB_EX_BUSY = 0x06
+};
+
+class PDUModbusServer {
+public:
+    PDUModbusServer(PDUController& pduController);
+    void begin();
+
+private:
+    struct Connection {
+        WiFiClient client;
+        bool active;
+        uint8_t frame[MODBUS_ADU_MAX];  // Received bytes; may hold more than one request
+        size_t length;
+        unsigned long lastActivity;
+    };
+
+    WiFiServer server;
+    PDUController& pdu;
+    Connection connections[MODBUS_MAX_CLIENTS];
+    uint8_t response[MODBUS_ADU_MAX];
+
+    static void serverTask(void* param);
+    void run();
+    void acceptClients();
+    Connection* findFreeSlot();
+    bool serviceConnection(Connection& connection);
+    void closeConnection(Connection& connection);
+
+    // Request PDU (function code first) in, response PDU out; returns its length
+    size_t handleRequest(const uint8_t* request, size_t length, uint8_t* reply);
+    ModbusException readBits(uint8_t function, uint16_t start, uint16_t count, uint8_t* reply, size_t& replyLength);
+    ModbusException readRegisters(uint8_t function, uint16_t start, uint16_t count, uint8_t* reply, size_t& replyLength);
+    ModbusException writeCoils(uint16_t start, uint16_t count, const uint8_t* values);
+    ModbusException writeRegisters(uint16_t start, uint16_t count, const uint8_t* values);
+    static bool getBit(const PDUStatus& status, uint8_t function, uint16_t address);
+    static uint16_t getRegister(const PDUStatus& status, uint32_t version, uint8_t function, uint16_t address);
+};
+
+#endif // PDU_MODBUS_H
@@ -0,0 +1,25 @@
+/*
+ * PDU String Guard
+ *
+ * Included last by every firmware source file. With PDU_NO_STRING set, any
+ * use of Arduino String in the firmware's own code becomes a compile error,
+ * so heap-allocating string building cannot creep back into the control
+ * loop, serial replies or HTTP handlers. Library calls that return String
+ * are still allowed as temporaries (e.g. server.arg("ch").toInt()).
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_NO_STRING_H
+#define PDU_NO_STRING_H
+
+#include "pdu_config.h"
+
+#if PDU_NO_STRING
+#pragma GCC poison String
+#endif
+
+#endif // PDU_NO_STRING_H
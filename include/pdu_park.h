@@ -0,0 +1,86 @@
+/*
+ * PDU Parked Mode Header
+ *
+ * This header defines the PDUParkMode class which puts the ESP32 to sleep
+ * while the vehicle is parked. Once the relay is OFF with IGN LOW for
+ * PARK_DELAY (normally after the IGN-off timeout), and nobody is connected
+ * to the access point, the radio is switched off and the chip sleeps until
+ * IGN goes HIGH again, or until the next battery check when a wake
+ * interval is set.
+ *
+ * Deep sleep is used when PARK_WAKE_PIN is an RTC GPIO (EXT0 wake-up). The
+ * outputs are held at their OFF levels and the controller resumes from the
+ * RTC memory copy of its state (see PDUWarmState). GPIO23, the IGN input
+ * of the current board, is not an RTC GPIO. On that board light sleep with
+ * a GPIO wake-up is used instead, which keeps RAM and the outputs as they
+ * are.
+ *
+ * A timer wake-up only samples the battery and goes straight back to
+ * sleep; the radio is brought back once IGN is HIGH and the relay decision
+ * has been taken. Sleep time, wake-ups and wake-to-relay latency are kept
+ * in RTC memory. The average supply current is estimated from those times
+ * and the PARK_*_CURRENT figures in pdu_config.h.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_PARK_H
+#define PDU_PARK_H
+
+#include <Arduino.h>
+#include "pdu_config.h"
+#include "pdu_controller.h"
+#include "pdu_web_server.h"
+
+// Parked-mode counters; survive deep sleep, cleared by any other reset
+struct ParkStats {
+    uint32_t parks;             // Times the unit went to sleep after a shutdown
+    uint32_t ignWakes;
+    uint32_t timerWakes;
+    uint64_t sleepUs;           // Total time asleep
+    uint64_t awakeUs;           // Total time awake for battery checks
+    uint32_t lastWakeToRelayUs; // IGN wake-up to relay ON (0 = none yet)
+    uint32_t maxWakeToRelayUs;
+    float battery;              // Last parked battery reading (V)
+};
+
+class PDUParkMode {
+public:
+    PDUParkMode(PDUController& pduController, PDUWebServer& webServer);
+    void begin();       // In setup(), after the first relay decision
+    void update();      // In loop(), after the controller's update()
+
+    // Woken up while parked and the radio is still off; setup() leaves the access point down
+    bool isResting() const { return resting; }
+
+    static bool usesDeepSleep();
+    static const ParkStats& getStats() { return stats; }
+    static uint32_t getEstimatedCurrent();      // Average while parked (uA, 0 = not parked yet)
+
+private:
+    PDUController& pdu;
+    PDUWebServer& web;
+    bool resting;
+    bool idle;                  // Relay OFF with IGN LOW
+    unsigned long idleSince;
+    bool awaitingRelay;         // Woken by IGN, relay not ON yet
+    uint32_t wakeUs;            // micros() at the last wake-up
+
+    static ParkStats stats;
+    static int64_t sleepStartUs;        // 0 = never slept since the last cold boot
+    static int64_t parkStartUs;
+    static bool lowBatteryReported;
+
+    void sleep();
+    void wake(bool byTimer, uint32_t wakeMicros);
+    void resume();
+    void checkBattery();
+    void recordWakeToRelay(uint32_t latencyUs);
+    static void holdOutputs(bool hold);
+    static int64_t clockMicros();
+};
+
+#endif // PDU_PARK_H
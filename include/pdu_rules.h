@@ -0,0 +1,151 @@
+/*
+ * PDU Rules Engine Header
+ *
+ * This header defines the PDURulesEngine class which compiles a small
+ * switching-policy language into bytecode and evaluates it once per tick.
+ * All storage is fixed-size, evaluation is a single pass over the code
+ * (no loops or jumps), so the cost per tick is bounded by program size.
+ *
+ * Language (one rule per line or separated by ';', '#' comments out the
+ * rest of the rule):
+ *
+ *   rule      := expr "->" actions [ "else" actions ]
+ *   expr      := term { "||" term }
+ *   term      := factor { "&&" factor }
+ *   factor    := unary [ "for" duration ]          (held true for duration)
+ *   unary     := "!" unary | "(" expr ")" | operand [ cmp operand [ "hyst" number ] ]
+ *   operand   := number | temp | bat | ign | vp | f1..f4 | ch1..ch4 | relay
+ *              | tempThreshold | timeThreshold
+ *   cmp       := ">" | ">=" | "<" | "<=" | "==" | "!="
+ *   duration  := number [ "ms" | "s" | "m" | "h" ]  (default ms)
+ *   actions   := ( "on" | "off" ) target { "," [ "on" | "off" ] target }
+ *   target    := ch1..ch4 | all | relay             ("off relay" only)
+ *
+ * Actions are level-held: the channels are kept in the "then" state while
+ * the rule is true and in the "else" state while it is false, and "off
+ * relay" holds the relay off while the rule is true. Later rules override
+ * earlier ones.
+ *
+ * Example:
+ *   temp > 55 hyst 2 -> off ch3 else on ch3
+ *   temp >= 65 hyst 2 -> off relay
+ *   !ign for 5m -> off ch2, ch3, ch4
+ *   !ign for 2h || (!ign && bat < 12.2) -> off relay
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_RULES_H
+#define PDU_RULES_H
+
+#include <Arduino.h>
+#include "pdu_config.h"
+
+enum RuleVariable : uint8_t {
+    RULE_VAR_TEMP, RULE_VAR_BAT, RULE_VAR_IGN, RULE_VAR_VP,
+    RULE_VAR_F1, RULE_VAR_F2, RULE_VAR_F3, RULE_VAR_F4,
+    RULE_VAR_CH1, RULE_VAR_CH2, RULE_VAR_CH3, RULE_VAR_CH4,
+    RULE_VAR_RELAY, RULE_VAR_TEMP_THRESHOLD, RULE_VAR_TIME_THRESHOLD,
+    RULE_VAR_COUNT
+};
+
+struct RuleInputs {
+    float values[RULE_VAR_COUNT];
+};
+
+struct RuleOutputs {
+    uint8_t channelsOn;    // Bit n-1 = CHn held on
+    uint8_t channelsOff;   // Bit n-1 = CHn held off
+    bool relayOff;         // Hold the relay off
+};
+
+class PDURulesEngine {
+public:
+    PDURulesEngine();
+
+    bool compile(const char* source, char* error, size_t errorSize);
+    void clear();
+    bool isLoaded() const { return program.ruleCount > 0; }
+    void evaluate(const RuleInputs& inputs, unsigned long now, RuleOutputs& outputs);
+
+    const char* getSource() const { return source; }
+    uint8_t getRuleCount() const { return program.ruleCount; }
+    uint8_t getCodeSize() const { return program.codeSize; }
+    uint32_t getLastEvalTime() const { return lastEvalUs; }
+    uint32_t getMaxEvalTime() const { return maxEvalUs; }
+
+private:
+    enum Opcode : uint8_t {
+        OP_CONST, OP_VAR, OP_GT, OP_GE, OP_LT, OP_LE, OP_EQ, OP_NE,
+        OP_HYST_GT, OP_HYST_LT, OP_AND, OP_OR, OP_NOT, OP_FOR, OP_RULE
+    };
+
+    struct Instruction {
+        uint8_t op;
+        uint8_t a;
+        uint8_t b;
+    };
+
+    struct Rule {
+        uint8_t thenOn;
+        uint8_t thenOff;
+        uint8_t elseOn;
+        uint8_t elseOff;
+        bool relayOff;
+    };
+
+    struct Program {
+        Instruction code[RULES_MAX_CODE];
+        float constants[RULES_MAX_CONSTANTS];
+        Rule rules[RULES_MAX_RULES];
+        uint8_t codeSize;
+        uint8_t constantCount;
+        uint8_t ruleCount;
+        uint8_t stateCount;
+    };
+
+    // Runtime state, reset whenever a program is loaded
+    struct State {
+        bool latched[RULES_MAX_STATE];
+        bool timerActive[RULES_MAX_STATE];
+        unsigned long timerStart[RULES_MAX_STATE];
+    };
+
+    // Compiler working state
+    struct Parser {
+        const char* pos;
+        const char* error;
+        int depth;
+        int maxDepth;
+        int nesting;        // Open '(' and '!' levels; bounds the parser's recursion
+    };
+
+    Program program;
+    Program scratch;
+    State state;
+    char source[RULES_MAX_SOURCE];
+    uint32_t lastEvalUs;
+    uint32_t maxEvalUs;
+
+    bool parseRule(Parser& p);
+    bool parseExpr(Parser& p);
+    bool parseTerm(Parser& p);
+    bool parseFactor(Parser& p);
+    bool parseUnary(Parser& p);
+    bool parseOperand(Parser& p);
+    bool parseActions(Parser& p, uint8_t& onMask, uint8_t& offMask, bool* relayOff);
+    bool parseDuration(Parser& p, float& ms);
+    bool emit(Parser& p, uint8_t op, uint8_t a = 0, uint8_t b = 0, int stackChange = 0);
+    bool addConstant(Parser& p, float value, uint8_t& index);
+
+    static bool fail(Parser& p, const char* message);
+    static void skipSpace(Parser& p);
+    static bool accept(Parser& p, const char* token);
+    static bool acceptWord(Parser& p, const char* word);
+    static int readVariable(Parser& p);
+};
+
+#endif // PDU_RULES_H
@@ -0,0 +1,50 @@
+/*
+ * PDU Session Table Header
+ *
+ * This header defines the PDUSessionTable class which keeps a small,
+ * fixed-size table of authenticated session tokens. A token is issued
+ * once after a successful basic-auth login and is then validated with a
+ * hash lookup and a constant-time compare, instead of decoding and
+ * checking the Authorization header on every request.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_SESSION_H
+#define PDU_SESSION_H
+
+#include <Arduino.h>
+#include "pdu_config.h"
+
+#define SESSION_TOKEN_BYTES 16
+#define SESSION_TOKEN_HEX_LENGTH (SESSION_TOKEN_BYTES * 2)
+
+class PDUSessionTable {
+public:
+    PDUSessionTable();
+
+    // Writes a new token as hex into tokenHex (SESSION_TOKEN_HEX_LENGTH + 1 bytes)
+    void create(char* tokenHex);
+    bool validate(const char* tokenHex);
+    void remove(const char* tokenHex);
+
+private:
+    struct Session {
+        uint8_t token[SESSION_TOKEN_BYTES];
+        unsigned long expiresAt;
+        bool active;
+    };
+
+    Session sessions[SESSION_TABLE_SIZE];
+
+    int find(const uint8_t* token);
+    bool isExpired(const Session& session) const;
+    static bool parseToken(const char* tokenHex, uint8_t* token);
+    static bool tokensEqual(const uint8_t* a, const uint8_t* b);
+    static uint8_t slotFor(const uint8_t* token);
+};
+
+#endif // PDU_SESSION_H
@@ -0,0 +1,157 @@
+/*
+ * PDU Telemetry Publisher Header
+ *
+ * This header defines the PDUTelemetry class which pushes the controller
+ * state to an MQTT broker over a station-mode connection, alongside the
+ * access point. It is off until a broker is set (SET_MQTT or /api/mqtt).
+ *
+ * update() samples the status snapshot every TELEMETRY_SAMPLE_INTERVAL in
+ * the loop task and picks up new event log entries. Samples and events are
+ * delta-encoded into a batch, which is closed after the configured number
+ * of samples or period and moved to a RAM spool. A publisher task sends
+ * the spooled batches as QoS 1 messages to <MQTT_TOPIC_PREFIX><id>/telemetry,
+ * one at a time, and drops a batch only once the broker has acknowledged it.
+ * While the broker or the network is unreachable batches stay in the spool;
+ * when it is full the oldest are dropped.
+ *
+ * Batch format (varint = unsigned LEB128, zigzag = signed varint):
+ *
+ *   Header    version (1 byte, TELEMETRY_FORMAT), batch number (varint,
+ *             counts from 0 every boot), boot count (varint), time of the
+ *             first sample (varint, millis()), sample interval (varint, ms)
+ *   Records until the end of the payload, told apart by the first byte:
+ *     0xxxxxxx  Sample. Bits say which fields follow; the others are
+ *               unchanged from the previous sample (all 0 before the first)
+ *                 bit 0  time since the previous sample (varint, ms; default
+ *                        the sample interval, the first sample's reference
+ *                        is the header time minus one interval)
+ *                 bit 1  flags XOR previous flags (varint, TelemetryFlag bits)
+ *                 bit 2  temperature change (zigzag, 0.01 degC)
+ *                 bit 3  battery change (zigzag, 0.01 V)
+ *                 bit 4  VP trip count change (varint)
+ *     10xxxxxL  Event log entry with level L: pin (varint), time since the
+ *               previous event (zigzag, us; the first event's reference is
+ *               the header time in us, wrapped to 32 bits)
+ *     11000000  Event log entries lost before the next event (varint count)
+ *
+ * A steady state sample is one byte, against a few hundred for a JSON
+ * message per reading. tools/mqtt/pdu_mqtt_sink decodes the batches.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_TELEMETRY_H
+#define PDU_TELEMETRY_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "pdu_config.h"
+#include "pdu_controller.h"
+
+#define TELEMETRY_FORMAT 1
+
+enum TelemetryFlag : uint16_t {
+    TELEMETRY_F1 = 1 << 0,      // F2-F4 follow (pin levels)
+    TELEMETRY_IGN = 1 << 4,
+    TELEMETRY_RELAY = 1 << 5,
+    TELEMETRY_VP_LOCKED = 1 << 6,
+    TELEMETRY_CH1 = 1 << 7      // CH2-CH4 follow (1 = ON)
+};
+
+enum TelemetryState {
+    TELEMETRY_OFF,              // No broker set
+    TELEMETRY_WAIT_WIFI,        // Radio off (parked) or station not connected
+    TELEMETRY_WAIT_BROKER,      // Connecting to the broker
+    TELEMETRY_CONNECTED
+};
+
+struct TelemetryConfig {
+    char broker[MQTT_BROKER_MAX];   // Host name or address, empty = off
+    uint16_t port;
+    uint32_t batchPeriod;           // Longest time a batch stays open (ms)
+    uint16_t batchSamples;          // Samples per batch
+};
+
+struct TelemetryStats {
+    uint32_t samples;               // Taken since boot
+    uint32_t events;
+    uint32_t batches;               // Closed and spooled
+    uint32_t published;             // Acknowledged by the broker
+    uint32_t publishedSamples;
+    uint32_t dropped;               // Dropped from a full spool
+    uint32_t payloadBytes;          // Batch bytes acknowledged
+    uint32_t wireBytes;             // All MQTT bytes sent, including resends and keep-alives
+    uint32_t connects;
+};
+
+class PDUTelemetry {
+public:
+    static void begin(PDUController& pdu);      // Loads the NVS settings and starts the publisher task
+    static void update();                       // In loop(), after the controller's update()
+
+    static bool configure(const TelemetryConfig& config);   // Validates, stores in NVS, reconnects
+    static void getConfig(TelemetryConfig& config);
+    static void getStats(TelemetryStats& out);                  // Consistent copy
+    static TelemetryState getState() { return state; }
+    static const char* getStateName(TelemetryState state);
+    static uint16_t getSpooledBatches() { return spoolCount; }
+    static uint32_t getSpooledBytes() { return spoolUsed; }
+    static const char* getClientId() { return clientId; }
+
+private:
+    friend class PDUMicrobench;     // Times takeSample() without the loop
+
+    struct Sample {
+        uint16_t flags;
+        int32_t temp;               // 0.01 degC
+        int32_t battery;            // 0.01 V
+        uint32_t vpTrips;
+    };
+
+    static PDUController* controller;
+    static TelemetryConfig config;
+    static volatile uint32_t configVersion;     // Bumped by configure(); the task reconnects
+    static volatile TelemetryState state;
+    static TelemetryStats stats;    // Publisher task counters are only written under mux
+    static char clientId[20];
+
+    // Open batch (loop task only)
+    static uint8_t batch[TELEMETRY_BATCH_MAX];
+    static size_t batchLength;
+    static uint16_t batchSampleCount;
+    static uint32_t batchNumber;
+    static unsigned long batchStart;
+    static unsigned long lastSampleTime;         // Scheduled time of the last sample
+    static unsigned long previousSampleTime;    // Time of the batch's previous sample
+    static uint32_t lastEventUs;
+    static uint32_t eventSeq;
+    static Sample previous;
+
+    // Closed batches: [length, samples (2 bytes each), payload] entries in a byte ring.
+    // The lock only covers offsets and counts; payloads are copied outside it, and a
+    // copy of an entry dropped for space meanwhile is detected by its batch number
+    static uint8_t spool[TELEMETRY_SPOOL_SIZE];
+    static size_t spoolHead;
+    static volatile size_t spoolUsed;
+    static volatile uint16_t spoolCount;
+    static uint32_t spoolFirst;                 // Batch number of the oldest entry
+    static portMUX_TYPE mux;
+
+    static void takeSample(unsigned long time);
+    static void addSample(unsigned long time);
+    static void addEvents(unsigned long time);
+    static void openBatch(unsigned long time);
+    static void closeBatch();
+    static void ensureSpace(size_t bytes, unsigned long time);
+    static void clear();
+    static void spoolCopy(size_t offset, uint8_t* data, size_t length, bool write);
+    static bool peekOldest(uint8_t* payload, size_t& length, uint16_t& samples, uint32_t& number);
+    static void dropOldest(uint32_t number);
+
+    static void publisherTask(void* param);
+};
+
+#endif // PDU_TELEMETRY_H
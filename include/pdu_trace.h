@@ -0,0 +1,77 @@
+/*
+ * PDU Trace Recorder Header
+ *
+ * This header defines the PDUTrace class which records everything the
+ * controller's decisions depend on (input edges, temperature and ADC
+ * samples, incoming commands) into a compact RAM buffer. A recording can
+ * be downloaded and replayed on the host (tools/replay) to reproduce a
+ * field problem and keep it as a regression test.
+ *
+ * Layout: "PDUT", a version byte, then records. Each record is a type
+ * byte, the time since the previous record in ms (LEB128 varint) and a
+ * type-specific payload:
+ *
+ *   TRACE_PIN    1 byte: pin | level << 7
+ *   TRACE_TEMP   int16 little endian, 1/16 degC (DS18B20 resolution)
+ *   TRACE_ADC    1 byte pin, uint16 little endian raw value
+ *   TRACE_CMD    varint length, command text in serial command syntax
+ *   TRACE_START  no payload; ends the start-up snapshot (inputs + settings)
+ *
+ * Recording stops when the buffer is full; the trace is then truncated
+ * but still replayable up to that point.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_TRACE_H
+#define PDU_TRACE_H
+
+#include <Arduino.h>
+#include "pdu_config.h"
+
+#define TRACE_MAGIC "PDUT"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 5
+
+enum TraceRecordType : uint8_t {
+    TRACE_PIN = 1,
+    TRACE_TEMP = 2,
+    TRACE_ADC = 3,
+    TRACE_CMD = 4,
+    TRACE_START = 5
+};
+
+class PDUTrace {
+public:
+    static void start(uint32_t timeMs);
+    static void stop() { recording = false; }
+    static bool isRecording() { return recording; }
+    static bool isTruncated() { return truncated; }
+
+    static void recordPin(uint32_t timeMs, uint8_t pin, uint8_t level);
+    static void recordTemperature(uint32_t timeMs, float celsius);
+    static void recordAnalog(uint32_t timeMs, uint8_t pin, uint16_t value);
+    static void recordStart(uint32_t timeMs);
+
+    // prefix + text; newlines in text are stored as ';' so the command stays one serial line
+    static void recordCommand(const char* prefix, const char* text = "");
+
+    static const uint8_t* getData() { return buffer; }
+    static size_t getSize() { return length; }
+
+private:
+    static uint8_t buffer[TRACE_BUFFER_SIZE];
+    static size_t length;
+    static uint32_t lastTimeMs;
+    static bool recording;
+    static bool truncated;
+
+    static bool beginRecord(uint8_t type, uint32_t timeMs, size_t payloadSize);
+    static void putVarint(uint32_t value);
+    static size_t varintSize(uint32_t value);
+};
+
+#endif // PDU_TRACE_H
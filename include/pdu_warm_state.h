@@ -0,0 +1,83 @@
+/*
+ * PDU Warm Restart State Header
+ *
+ * This header defines the PDUWarmState class which keeps a copy of the
+ * controller's state in RTC slow memory. That memory is not cleared by a
+ * watchdog, panic, software or brownout reset, nor by deep sleep (parked
+ * mode, see PDUParkMode), so after one of those the controller resumes
+ * where it was (outputs, IGN timer, VP retry state, power-up sequence
+ * step) instead of starting from all-off, and without reading settings
+ * from flash.
+ *
+ * Two blocks are kept, each with a magic number and a CRC-32:
+ *   - settings, mirrored from NVS whenever they are loaded or saved
+ *   - runtime state, checked at the end of every update() and rewritten
+ *     when it changed or WARM_SAVE_INTERVAL has passed
+ * On a power-on (cold) boot both are discarded. After WARM_BOOT_LIMIT warm
+ * restarts in a row the state is discarded too, so a state that makes the
+ * firmware crash cannot keep it in a restart loop.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef PDU_WARM_STATE_H
+#define PDU_WARM_STATE_H
+
+#include <Arduino.h>
+#include <esp_system.h>
+#include "pdu_config.h"
+#include "pdu_controller.h"
+
+// Settings as stored in NVS
+struct WarmSettings {
+    float tempThreshold;
+    uint32_t timeThreshold;
+    uint8_t relayFlag;
+    uint8_t vpLocked;
+    uint8_t parkEnabled;
+    uint32_t parkWakeInterval;
+    SequenceStep profile[SEQ_STEP_COUNT];
+    char rules[RULES_MAX_SOURCE];
+};
+
+// Runtime state. The times are saved as millis() values; loadRuntime() turns them into ages at
+// the last save, since the new boot's clock starts over. Fill with memset first: blocks are compared bytewise.
+struct WarmRuntime {
+    uint8_t outputs;            // Bit 0-3 = CH1-CH4 ON, bit 4 = relay ON
+    uint8_t ignState;           // Debounced IGN level
+    uint8_t seqPhase;
+    uint8_t seqPendingMask;
+    int8_t vpResetAttempts;
+    uint8_t vpRetryPending;     // CH1 is off waiting for a VP reset attempt
+    uint32_t ignStableTime;     // Debounced IGN level last changed (a time, or an age once loaded)
+    uint32_t seqStartTime;
+    uint32_t seqPhaseTime;
+    uint32_t seqUpTime[4];      // Relative to the sequence start
+    uint32_t vpFaultStartTime;
+    uint32_t vpTripCount;
+};
+
+class PDUWarmState {
+public:
+    // Decides warm or cold from the reset reason and the runtime block; call before anything else is restored
+    static bool begin();
+    static bool isWarmBoot() { return warmBoot; }
+    static uint8_t getWarmBoots() { return warmBoots; }    // Consecutive warm restarts so far
+    static esp_reset_reason_t getResetReason() { return resetReason; }
+    static const char* getResetReasonName(esp_reset_reason_t reason);
+
+    static bool loadSettings(WarmSettings& settings);
+    static void saveSettings(const WarmSettings& settings);
+    static bool loadRuntime(WarmRuntime& runtime);
+    static void saveRuntime(const WarmRuntime& runtime);
+
+private:
+    static bool warmBoot;
+    static uint8_t warmBoots;
+    static esp_reset_reason_t resetReason;
+};
+
+#endif // PDU_WARM_STATE_H
@@ -17,26 +17,67 @@
 #include "pdu_controller.h"
 #include "html_content.h"
 #include "pdu_config.h"
+#include "pdu_session.h"
 
 class PDUWebServer {
 public:
     PDUWebServer(PDUController& pduController);
     void begin();
+    void beginAsync();      // Also brings the access point back after suspend()
+    void suspend();         // Access point off (parked mode)
     void handleClient();
 
 private:
+    friend class PDUMicrobench;     // Times createJsonResponse() without a client
+
     WebServer server;
     PDUController& pdu;
+    volatile bool started;
+    bool listening;         // Routes set up and HTTP server started (kept across suspend())
+    PDUSessionTable sessions;
+    bool sessionAuthenticated;
+
+    // Fixed response buffer; responses that outgrow it are sent chunked
+    char jsonBuffer[JSON_BUFFER_SIZE];
+    size_t jsonLength;
+    int jsonCode;
+    bool jsonChunked;
+    uint32_t etagEpoch;     // Random per boot so state versions from before a reboot never match
 
     void setupRoutes();
     void handleRoot();
+    void handleApiLogin();
+    void handleApiLogout();
     void handleApiStatus();
     void handleApiControl();
     void handleApiSetTemp();
     void handleApiSetTime();
+    void handleApiEvents();
+    void handleApiGetSequence();
+    void handleApiSetSequence();
+    void handleApiBoot();
+    void handleApiHeap();
+    void handleApiGetPark();
+    void handleApiSetPark();
+    void handleApiGetMqtt();
+    void handleApiSetMqtt();
+    void handleApiGetRules();
+    void handleApiSetRules();
+    void handleApiJournal();
+    void handleApiGetTrace();
+    void handleApiSetTrace();
+    void handleApiCommand();
 
+    static void initTask(void* param);
     bool authenticate();
-    String createJsonResponse();
+    bool getSessionToken(char* tokenHex);
+    void issueSession(char* tokenHex);
+    void sendQueued(uint32_t ticket, const char* message);
+    void createJsonResponse(uint32_t fields);
+    void beginJson(int code = 200);
+    void appendJson(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void flushJson();
+    void sendJson();
 };
 
 #endif // PDU_WEB_SERVER_H
@@ -12,15 +12,58 @@
  */
 
 #include "SerialCommandHandler.h"
+#include "pdu_boot.h"
+#include "pdu_heap.h"
+#include "pdu_trace.h"
+#include "pdu_command_queue.h"
+#include "pdu_microbench.h"
+#include "pdu_warm_state.h"
+#include "pdu_park.h"
+#include "pdu_telemetry.h"
+#include "pdu_no_string.h"
 
-void SerialCommandHandler::handleCommand(const String& command, PDUController& pdu) {
-    if (command == "GET_STATUS") {
+char SerialCommandHandler::line[SERIAL_LINE_MAX];
+size_t SerialCommandHandler::lineLength = 0;
+bool SerialCommandHandler::lineOverflow = false;
+Print* SerialCommandHandler::output = &Serial;
+
+void SerialCommandHandler::poll(PDUController& pdu) {
+    // Assemble lines in a fixed buffer; never wait for the rest of a command
+    while (Serial.available() > 0) {
+        char c = Serial.read();
+        if (c != '\n') {
+            if (lineLength < sizeof(line) - 1) line[lineLength++] = c;
+            else lineOverflow = true;
+            continue;
+        }
+
+        // A cut-off line is never executed (a truncated SET_RULES would be stored as is)
+        if (lineOverflow) {
+            output->println("Line too long");
+            lineOverflow = false;
+            lineLength = 0;
+            continue;
+        }
+
+        // Trim surrounding whitespace (including the '\r' of CRLF terminals)
+        while (lineLength > 0 && isspace((unsigned char)line[lineLength - 1])) lineLength--;
+        line[lineLength] = '\0';
+        const char* command = line;
+        while (isspace((unsigned char)*command)) command++;
+
+        handleCommand(command, pdu);
+        lineLength = 0;
+    }
+}
+
+void SerialCommandHandler::handleCommand(const char* command, PDUController& pdu) {
+    if (strcmp(command, "GET_STATUS") == 0) {
         printStatus(pdu);
         return;
     }
 
     // Handle GET commands
-    if (command.startsWith("GET_")) {
+    if (strncmp(command, "GET_", 4) == 0) {
         handleGetCommand(command, pdu);
     }
     // Handle SET commands
@@ -29,70 +72,362 @@ void SerialCommandHandler::handleCommand(const String& command, PDUController& p
     }
 }
 
-void SerialCommandHandler::handleGetCommand(const String& command, PDUController& pdu) {
-    if (command == "GET_F1") Serial.println("F1:" + String(digitalRead(F1_PIN)));
-    else if (command == "GET_F2") Serial.println("F2:" + String(digitalRead(F2_PIN)));
-    else if (command == "GET_F3") Serial.println("F3:" + String(digitalRead(F3_PIN)));
-    else if (command == "GET_F4") Serial.println("F4:" + String(digitalRead(F4_PIN)));
-    else if (command == "GET_IGN") Serial.println("IGN:" + String(digitalRead(IGN_PIN)));
-    else if (command == "GET_TEMP") Serial.println("TEMP:" + String(pdu.getCurrentTemp(), 2));
-    else if (command == "GET_BAT") Serial.println("BAT:" + String(pdu.getBatteryVoltage(), 2));
-    else if (command == "GET_RELAY") Serial.println("RELAY:" + String(pdu.getRelayFlag() ? "1" : "0"));
-    else if (command == "GET_CH1") Serial.println("CH1:" + String(pdu.getChannelState(1) ? "1" : "0"));
-    else if (command == "GET_CH2") Serial.println("CH2:" + String(pdu.getChannelState(2) ? "1" : "0"));
-    else if (command == "GET_CH3") Serial.println("CH3:" + String(pdu.getChannelState(3) ? "1" : "0"));
-    else if (command == "GET_CH4") Serial.println("CH4:" + String(pdu.getChannelState(4) ? "1" : "0"));
+void SerialCommandHandler::handleGetCommand(const char* command, PDUController& pdu) {
+    if (strncmp(command, "GET_EVENTS", 10) == 0) {
+        printEvents(command);
+        return;
+    }
+    if (strcmp(command, "GET_SEQ") == 0) {
+        printSequence(pdu);
+        return;
+    }
+    if (strcmp(command, "GET_RULES") == 0) {
+        printRules(pdu);
+        return;
+    }
+    if (strcmp(command, "GET_HEAP") == 0) {
+        printHeap();
+        return;
+    }
+    if (strncmp(command, "GET_JOURNAL", 11) == 0) {
+        printJournal(command);
+        return;
+    }
+    if (strcmp(command, "GET_PARK") == 0) {
+        printPark(pdu);
+        return;
+    }
+    if (strcmp(command, "GET_MQTT") == 0) {
+        printMqtt();
+        return;
+    }
+    if (strcmp(command, "GET_TRACE") == 0) {
+        printTrace(true);
+        return;
+    }
+#if PDU_MICROBENCH
+    if (strcmp(command, "GET_BENCH") == 0) {
+        printBench(pdu);
+        return;
+    }
+#endif
+    if (strcmp(command, "GET_BOOT") == 0) {
+        for (int phase = 0; phase < BOOT_PHASE_COUNT; phase++) {
+            output->printf("BOOT_%s:%lu\r\n", PDUBoot::getPhaseName((BootPhase)phase),
+                          (unsigned long)PDUBoot::getPhaseTime((BootPhase)phase));
+        }
+        output->printf("BOOT_RESET:%s,%d,%u\r\n", PDUWarmState::getResetReasonName(PDUWarmState::getResetReason()),
+                       PDUWarmState::isWarmBoot() ? 1 : 0, PDUWarmState::getWarmBoots());
+        return;
+    }
+
+    const char* name = command + 4;
+    if (strcmp(name, "F1") == 0) output->printf("F1:%d\r\n", digitalRead(F1_PIN));
+    else if (strcmp(name, "F2") == 0) output->printf("F2:%d\r\n", digitalRead(F2_PIN));
+    else if (strcmp(name, "F3") == 0) output->printf("F3:%d\r\n", digitalRead(F3_PIN));
+    else if (strcmp(name, "F4") == 0) output->printf("F4:%d\r\n", digitalRead(F4_PIN));
+    else if (strcmp(name, "IGN") == 0) output->printf("IGN:%d\r\n", digitalRead(IGN_PIN));
+    else if (strcmp(name, "TEMP") == 0) output->printf("TEMP:%.2f\r\n", pdu.getCurrentTemp());
+    else if (strcmp(name, "BAT") == 0) output->printf("BAT:%.2f\r\n", pdu.getBatteryVoltage());
+    else if (strcmp(name, "RELAY") == 0) output->printf("RELAY:%d\r\n", pdu.getRelayFlag() ? 1 : 0);
+    else if (strcmp(name, "CH1") == 0) output->printf("CH1:%d\r\n", pdu.getChannelState(1) ? 1 : 0);
+    else if (strcmp(name, "CH2") == 0) output->printf("CH2:%d\r\n", pdu.getChannelState(2) ? 1 : 0);
+    else if (strcmp(name, "CH3") == 0) output->printf("CH3:%d\r\n", pdu.getChannelState(3) ? 1 : 0);
+    else if (strcmp(name, "CH4") == 0) output->printf("CH4:%d\r\n", pdu.getChannelState(4) ? 1 : 0);
+    else if (strcmp(name, "VPTRIP") == 0) output->printf("VPTRIP:%lu,%lu,%lu\r\n",
+                                                        (unsigned long)pdu.getVpTripCount(),
+                                                        (unsigned long)pdu.getLastVpTripLatency(),
+                                                        (unsigned long)pdu.getMaxVpTripLatency());
 }
 
-void SerialCommandHandler::handleSetCommand(const String& command, PDUController& pdu) {
-    int spaceIndex = command.indexOf(':');
-    if (spaceIndex <= 0) {
-        Serial.println("Invalid command format");
+void SerialCommandHandler::handleSetCommand(const char* command, PDUController& pdu) {
+    const char* separator = strchr(command, ':');
+    if (separator == nullptr || separator == command) {
+        output->println("Invalid command format");
         return;
     }
 
-    String cmd = command.substring(0, spaceIndex);
-    String valueStr = command.substring(spaceIndex + 1);
-    int value = valueStr.toInt();
+    // cmd is the text before ':' (not terminated), valueStr the text after it
+    const char* cmd = command;
+    size_t cmdLength = separator - command;
+    const char* valueStr = separator + 1;
+    int value = atoi(valueStr);
+
+    // Settings and channel commands are part of a trace recording (SET_TRACE and SET_MQTT are not)
+    bool traceCommand = cmdLength == 9 && strncmp(cmd, "SET_TRACE", 9) == 0;
+    bool mqttCommand = cmdLength == 8 && strncmp(cmd, "SET_MQTT", 8) == 0;
+    if (!traceCommand && !mqttCommand) PDUTrace::recordCommand(command);
 
-    if (cmd.startsWith("SET_CH") && cmd.length() == 7) {
+    if (traceCommand) {
+        // SET_TRACE:1 starts a new recording, SET_TRACE:0 stops it
+        if (value == 1) pdu.startTrace();
+        else pdu.stopTrace();
+        printTrace(false);
+    }
+    else if (cmdLength == 7 && strncmp(cmd, "SET_CH", 6) == 0) {
         int channel = cmd[6] - '0';
         if (channel >= 1 && channel <= 4) {
-            pdu.setChannel(channel, value == 0);
-            Serial.println(cmd.substring(4) + ":" + String(pdu.getChannelState(channel) ? "1" : "0"));
+            submitted(PDUCommandQueue::setChannel(channel, value == 0, reportCommand, &pdu));
+        }
+    }
+    else if (cmdLength == 8 && strncmp(cmd, "SET_SEQ", 7) == 0) {
+        // SET_SEQ<ch>:<delay>,<deps>,<stable>,<timeout>
+        int channel = cmd[7] - '0';
+        unsigned long delayMs, deps, stableMs, timeoutMs;
+        if (sscanf(valueStr, "%lu,%lu,%lu,%lu", &delayMs, &deps, &stableMs, &timeoutMs) != 4) {
+            output->println("Invalid sequence format");
+            return;
         }
+        // Range-checked before narrowing: 256 must not turn into "no dependencies"
+        if (deps > 0x0F) {
+            output->println("Invalid sequence step");
+            return;
+        }
+        SequenceStep step;
+        step.delayMs = delayMs;
+        step.stableMs = stableMs;
+        step.timeoutMs = timeoutMs;
+        step.dependsOn = deps;
+        if (pdu.isSequenceStepValid(channel, step)) {
+            submitted(PDUCommandQueue::setSequenceStep(channel, step, reportCommand, &pdu));
+        }
+        else output->println("Invalid sequence step");
+    }
+    else if (cmdLength == 9 && strncmp(cmd, "SET_RULES", 9) == 0) {
+        // SET_RULES:<rule>;<rule>;...  (empty restores the built-in policy)
+        char error[64];
+        if (pdu.loadRules(valueStr, error, sizeof(error))) printRules(pdu);
+        else output->printf("RULES_ERROR:%s\r\n", error);
+    }
+    else if (cmdLength == 10 && strncmp(cmd, "SET_VPLOCK", 10) == 0) {
+        // SET_VPLOCK:0 clears a CH1 lockout after VP faults
+        if (value == 0) submitted(PDUCommandQueue::clearVpLockout(reportCommand, &pdu));
+        else output->printf("VPLOCK:%d\r\n", pdu.isCh1Locked() ? 1 : 0);
     }
-    else if (cmd == "SET_RELAY") {
-        pdu.setRelayFlag(value == 1);
-        Serial.println("RELAY:" + String(pdu.getRelayFlag() ? "1" : "0"));
+    else if (cmdLength == 8 && strncmp(cmd, "SET_PARK", 8) == 0) {
+        // SET_PARK:<0|1>[,<wake interval, minutes (0 = IGN only)>]
+        const char* comma = strchr(valueStr, ',');
+        uint32_t interval = comma != nullptr ? atof(comma + 1) * 60000 + 0.5 : pdu.getParkWakeInterval();
+        submitted(PDUCommandQueue::setParkMode(value == 1, interval, reportCommand, &pdu));
     }
-    else if (cmd == "SET_TSTemp") {
-        pdu.setTempThreshold(value);
-        Serial.println("TSTEMP:" + String(pdu.getTempThreshold()));
+    else if (mqttCommand) {
+        // SET_MQTT:<broker>[,<port>[,<batch period, s>[,<batch samples>]]]  (empty or 0 switches it off)
+        TelemetryConfig config;
+        PDUTelemetry::getConfig(config);
+        size_t brokerLength = strcspn(valueStr, ",");
+        if (brokerLength >= sizeof(config.broker)) brokerLength = sizeof(config.broker) - 1;
+        memcpy(config.broker, valueStr, brokerLength);
+        config.broker[brokerLength] = '\0';
+        if (strcmp(config.broker, "0") == 0) config.broker[0] = '\0';
+
+        // Values that are not given keep their current setting
+        unsigned int port = config.port;
+        float periodS = config.batchPeriod / 1000.0f;
+        unsigned int samples = config.batchSamples;
+        sscanf(valueStr + brokerLength, ",%u,%f,%u", &port, &periodS, &samples);
+        config.port = port <= 0xFFFF ? port : 0;
+        config.batchPeriod = periodS > 0 ? periodS * 1000 + 0.5f : 0;
+        config.batchSamples = samples <= 0xFFFF ? samples : 0;
+        if (PDUTelemetry::configure(config)) printMqtt();
+        else output->println("Invalid MQTT settings");
+    }
+    else if (cmdLength == 9 && strncmp(cmd, "SET_RELAY", 9) == 0) {
+        submitted(PDUCommandQueue::setRelayFlag(value == 1, reportCommand, &pdu));
+    }
+    else if (cmdLength == 10 && strncmp(cmd, "SET_TSTemp", 10) == 0) {
+        submitted(PDUCommandQueue::setTempThreshold(atof(valueStr), reportCommand, &pdu));
     }
-    else if (cmd == "SET_TSTime") {
-        pdu.setTimeThreshold(value * 60000);
-        Serial.println("TSTOFF:" + String(value));
+    else if (cmdLength == 10 && strncmp(cmd, "SET_TSTime", 10) == 0) {
+        submitted(PDUCommandQueue::setTimeThreshold(atof(valueStr) * 60000 + 0.5, reportCommand, &pdu));
     }
     else {
-        Serial.println("Unknown command");
+        output->println("Unknown command");
+    }
+}
+
+void SerialCommandHandler::submitted(uint32_t ticket) {
+    if (ticket == 0) output->println("Command queue full");
+}
+
+// Runs on the controller once the command's batch is applied; replies show the resulting state
+void SerialCommandHandler::reportCommand(const PDUCommand& command, CommandStatus status, void* context) {
+    PDUController& pdu = *static_cast<PDUController*>(context);
+    switch (command.type) {
+        case CMD_SET_CHANNEL:
+            output->printf("CH%d:%d\r\n", command.channel, pdu.getChannelState(command.channel) ? 1 : 0);
+            break;
+        case CMD_SET_RELAY_FLAG:
+            output->printf("RELAY:%d\r\n", pdu.getRelayFlag() ? 1 : 0);
+            break;
+        case CMD_SET_TEMP_THRESHOLD:
+            output->printf("TSTEMP:%.2f\r\n", pdu.getTempThreshold());
+            break;
+        case CMD_SET_TIME_THRESHOLD:
+            output->printf("TSTOFF:%lu\r\n", pdu.getTimeThreshold() / 60000);
+            break;
+        case CMD_SET_SEQUENCE:
+            if (status == CMD_REJECTED) output->println("Invalid sequence step");
+            else printSequence(pdu);
+            break;
+        case CMD_CLEAR_VP_LOCK:
+            output->printf("VPLOCK:%d\r\n", pdu.isCh1Locked() ? 1 : 0);
+            break;
+        case CMD_SET_PARK_MODE:
+            printPark(pdu);
+            break;
+    }
+}
+
+#if PDU_MICROBENCH
+extern PDUWebServer webServer;
+
+void SerialCommandHandler::printBench(PDUController& pdu) {
+    // Holds the loop task (and the control loop with it) for a few hundred ms per case
+    BenchResult results[PDUMicrobench::CASE_COUNT];
+    size_t count = PDUMicrobench::run(pdu, webServer, results);
+    for (size_t i = 0; i < count; i++) {
+        output->printf("BENCH:%s,%.1f,%.3f,%lu,%lu\r\n", results[i].name, results[i].nsPerOp,
+                       results[i].allocsPerOp, (unsigned long)results[i].stackBytes,
+                       (unsigned long)results[i].iterations);
     }
 }
+#endif
+
+void SerialCommandHandler::printPark(PDUController& pdu) {
+    const ParkStats& stats = PDUParkMode::getStats();
+    output->printf("PARK:%d,%.9g,%s\r\n", pdu.getParkEnabled() ? 1 : 0, pdu.getParkWakeInterval() / 60000.0,
+                   PDUParkMode::usesDeepSleep() ? "deep" : "light");
+    output->printf("PARK_STATS:%lu,%lu,%lu,%lu,%lu,%.2f\r\n", (unsigned long)stats.parks,
+                   (unsigned long)stats.ignWakes, (unsigned long)stats.timerWakes,
+                   (unsigned long)(stats.sleepUs / 1000000), (unsigned long)(stats.awakeUs / 1000000), stats.battery);
+    output->printf("PARK_CURRENT:%lu,%lu\r\n", (unsigned long)PDUParkMode::getEstimatedCurrent(),
+                   (unsigned long)PARK_ACTIVE_CURRENT);
+    output->printf("PARK_LATENCY:%lu,%lu\r\n", (unsigned long)stats.lastWakeToRelayUs,
+                   (unsigned long)stats.maxWakeToRelayUs);
+}
+
+void SerialCommandHandler::printMqtt() {
+    TelemetryConfig config;
+    PDUTelemetry::getConfig(config);
+    TelemetryStats stats;
+    PDUTelemetry::getStats(stats);
+    output->printf("MQTT:%s,%u,%.9g,%u,%s,%s\r\n", config.broker, config.port, config.batchPeriod / 1000.0,
+                   config.batchSamples, PDUTelemetry::getStateName(PDUTelemetry::getState()),
+                   PDUTelemetry::getClientId());
+    output->printf("MQTT_STATS:%lu,%lu,%lu,%lu,%u,%lu,%lu,%lu\r\n", (unsigned long)stats.samples,
+                   (unsigned long)stats.events, (unsigned long)stats.batches, (unsigned long)stats.published,
+                   PDUTelemetry::getSpooledBatches(), (unsigned long)PDUTelemetry::getSpooledBytes(),
+                   (unsigned long)stats.dropped, (unsigned long)stats.connects);
+    output->printf("MQTT_BYTES:%lu,%lu,%.2f\r\n", (unsigned long)stats.payloadBytes, (unsigned long)stats.wireBytes,
+                   stats.publishedSamples > 0 ? (float)stats.wireBytes / stats.publishedSamples : 0.0f);
+}
 
 void SerialCommandHandler::printStatus(PDUController& pdu) {
-    Serial.println("System Status:");
-    Serial.println("F1:" + String(digitalRead(F1_PIN)));
-    Serial.println("F2:" + String(digitalRead(F2_PIN)));
-    Serial.println("F3:" + String(digitalRead(F3_PIN)));
-    Serial.println("F4:" + String(digitalRead(F4_PIN)));
-    Serial.println("IGN:" + String(digitalRead(IGN_PIN)));
-    Serial.println("TEMP:" + String(pdu.getCurrentTemp(), 2));
-    Serial.println("BAT:" + String(pdu.getBatteryVoltage(), 2));
-    Serial.println("CH1:" + String(pdu.getChannelState(1) ? "1" : "0"));
-    Serial.println("CH2:" + String(pdu.getChannelState(2) ? "1" : "0"));
-    Serial.println("CH3:" + String(pdu.getChannelState(3) ? "1" : "0"));
-    Serial.println("CH4:" + String(pdu.getChannelState(4) ? "1" : "0"));
-    Serial.println("RELAY:" + String(pdu.getRelayFlag() ? "1" : "0"));
-    Serial.println("TEMP_THRESH:" + String(pdu.getTempThreshold()));
-    Serial.println("TIME_THRESH_MIN:" + String(pdu.getTimeThreshold() / 60000.0));
+    output->println("System Status:");
+    output->printf("F1:%d\r\n", digitalRead(F1_PIN));
+    output->printf("F2:%d\r\n", digitalRead(F2_PIN));
+    output->printf("F3:%d\r\n", digitalRead(F3_PIN));
+    output->printf("F4:%d\r\n", digitalRead(F4_PIN));
+    output->printf("IGN:%d\r\n", digitalRead(IGN_PIN));
+    output->printf("TEMP:%.2f\r\n", pdu.getCurrentTemp());
+    output->printf("BAT:%.2f\r\n", pdu.getBatteryVoltage());
+    output->printf("CH1:%d\r\n", pdu.getChannelState(1) ? 1 : 0);
+    output->printf("CH2:%d\r\n", pdu.getChannelState(2) ? 1 : 0);
+    output->printf("CH3:%d\r\n", pdu.getChannelState(3) ? 1 : 0);
+    output->printf("CH4:%d\r\n", pdu.getChannelState(4) ? 1 : 0);
+    output->printf("RELAY:%d\r\n", pdu.getRelayFlag() ? 1 : 0);
+    output->printf("TEMP_THRESH:%.2f\r\n", pdu.getTempThreshold());
+    output->printf("TIME_THRESH_MIN:%.2f\r\n", pdu.getTimeThreshold() / 60000.0);
+    output->printf("TEMP_SAMPLE:%lu,%u,%.3f\r\n", (unsigned long)pdu.getSampleInterval(),
+                  pdu.getSampleResolution(), pdu.getTempRate());
+}
+
+void SerialCommandHandler::printEvents(const char* command) {
+    // GET_EVENTS returns everything still buffered, GET_EVENTS:<seq> resumes from seq
+    const char* separator = strchr(command, ':');
+    uint32_t since = separator ? strtoul(separator + 1, nullptr, 10) : 0;
+
+    PDUEvent events[EVENT_MAX_PER_REQUEST];
+    uint32_t next;
+    size_t count = PDUEventLog::read(since, events, EVENT_MAX_PER_REQUEST, next);
+    for (size_t i = 0; i < count; i++) {
+        output->printf("EVT:%lu,%lu,%u,%u\r\n", (unsigned long)events[i].seq,
+                      (unsigned long)events[i].timestampUs, events[i].pin, events[i].level);
+    }
+    output->printf("EVENTS_NEXT:%lu\r\n", (unsigned long)next);
+}
+
+void SerialCommandHandler::printSequence(PDUController& pdu) {
+    for (uint8_t channel = 2; channel <= 4; channel++) {
+        const SequenceStep& step = pdu.getSequenceStep(channel);
+        output->printf("SEQ%u:%lu,%u,%lu,%lu\r\n", channel, (unsigned long)step.delayMs, step.dependsOn,
+                      (unsigned long)step.stableMs, (unsigned long)step.timeoutMs);
+    }
+    output->printf("SEQ_LAST_MS:%lu\r\n", pdu.getLastSequenceTime());
+}
+
+void SerialCommandHandler::printRules(PDUController& pdu) {
+    const PDURulesEngine& rules = pdu.getRules();
+    output->printf("RULES:%u,%u\r\n", rules.getRuleCount(), rules.getCodeSize());
+    output->printf("RULES_EVAL_US:%lu,%lu\r\n", (unsigned long)rules.getLastEvalTime(),
+                  (unsigned long)rules.getMaxEvalTime());
+    output->printf("TICK_US:%lu,%lu\r\n", (unsigned long)pdu.getLastTickTime(),
+                  (unsigned long)pdu.getMaxTickTime());
+
+    // One line on the wire: rule separators are sent back as ';'
+    output->print("RULES_SRC:");
+    for (const char* c = rules.getSource(); *c; c++) {
+        output->print(*c == '\n' ? ';' : *c == '\r' ? ' ' : *c);
+    }
+    output->println();
+}
+
+void SerialCommandHandler::printHeap() {
+    output->printf("HEAP:%lu,%lu,%lu\r\n", (unsigned long)PDUHeap::getFree(),
+                  (unsigned long)PDUHeap::getLargestBlock(), (unsigned long)PDUHeap::getMinFree());
+    output->printf("ALLOCS:%lu,%lu,%lu,%lu,%lu\r\n", (unsigned long)PDUHeap::getAllocCount(),
+                  (unsigned long)PDUHeap::getLastTickAllocs(), (unsigned long)PDUHeap::getMaxTickAllocs(),
+                  (unsigned long)PDUHeap::getAllocTicks(), (unsigned long)PDUHeap::getTickCount());
+}
+
+void SerialCommandHandler::printJournal(const char* command) {
+    // GET_JOURNAL returns the latest records, GET_JOURNAL:<seq> resumes from seq
+    const char* separator = strchr(command, ':');
+    uint32_t next = PDUJournal::getNextSeq();
+    uint32_t since = separator ? strtoul(separator + 1, nullptr, 10)
+                               : (next > JOURNAL_MAX_PER_REQUEST ? next - JOURNAL_MAX_PER_REQUEST : 0);
+
+    output->printf("JOURNAL:%d,%lu,%lu,%lu,%lu,%lu\r\n", PDUJournal::isMounted() ? 1 : 0,
+                  (unsigned long)PDUJournal::getOldestSeq(), (unsigned long)next,
+                  (unsigned long)PDUJournal::getCapacity(), (unsigned long)PDUJournal::getEraseCount(),
+                  (unsigned long)PDUJournal::getDroppedCount());
+
+    JournalRecord records[JOURNAL_MAX_PER_REQUEST];
+    size_t count = PDUJournal::read(since, records, JOURNAL_MAX_PER_REQUEST, next);
+    for (size_t i = 0; i < count; i++) {
+        const JournalRecord& record = records[i];
+        output->printf("JRN:%lu,%lu,%lu,%s,%ld,%ld\r\n", (unsigned long)record.seq,
+                      (unsigned long)record.bootCount, (unsigned long)record.timeMs,
+                      PDUJournal::getTypeName(record.type), (long)record.value, (long)record.value2);
+    }
+    output->printf("JOURNAL_NEXT:%lu\r\n", (unsigned long)next);
+}
+
+void SerialCommandHandler::printTrace(bool withData) {
+    output->printf("TRACE_INFO:%u,%d,%d\r\n", (unsigned)PDUTrace::getSize(), PDUTrace::isRecording() ? 1 : 0,
+                  PDUTrace::isTruncated() ? 1 : 0);
+    if (!withData) return;
+
+    // Hex lines short enough for output->printf's stack buffer
+    const uint8_t* data = PDUTrace::getData();
+    size_t size = PDUTrace::getSize();
+    char hex[TRACE_HEX_LINE * 2 + 1];
+    for (size_t offset = 0; offset < size; offset += TRACE_HEX_LINE) {
+        size_t count = size - offset < TRACE_HEX_LINE ? size - offset : TRACE_HEX_LINE;
+        for (size_t i = 0; i < count; i++) {
+            snprintf(&hex[i * 2], 3, "%02x", data[offset + i]);
+        }
+        output->printf("TRACE:%s\r\n", hex);
+    }
+    output->println("TRACE_END");
 }
@@ -20,39 +20,64 @@
 #include "pdu_controller.h"
 #include "pdu_web_server.h"
 #include "SerialCommandHandler.h"
+#include "pdu_logger.h"
+#include "pdu_boot.h"
+#include "pdu_heap.h"
+#include "pdu_journal.h"
+#include "pdu_modbus.h"
+#include "pdu_park.h"
+#include "pdu_telemetry.h"
+#include "pdu_no_string.h"
 
 // Global objects
 PDUController pdu;
 PDUWebServer webServer(pdu);
+PDUModbusServer modbusServer(pdu);
+PDUParkMode parkMode(pdu, webServer);
 
 void setup() {
     Serial.begin(115200);
+    PDULogger::begin();
+    PDUHeap::begin();
     
-    // Initialize PDU controller
+    // Safe outputs and settings, then the first IGN/relay decision before anything slow
     pdu.begin();
+    parkMode.begin();   // Releases outputs held through deep sleep before they are switched
+    pdu.update();
+    PDUBoot::mark(BOOT_FIRST_DECISION);
+
+    // Partition scan; records appended so far are kept and written after the BOOT record
+    PDUJournal::begin();
+    
+    pdu.beginSensors();
     
-    // Start Access Point
-    WiFi.softAP(AP_SSID, AP_PASSWORD);
-    IPAddress IP = WiFi.softAPIP();
-    Serial.print("AP IP address: ");
-    Serial.println(IP);
-
-    // Initialize web server
-    webServer.begin();
-    Serial.println("HTTP server started");
+    // Start Access Point and web server in the background; after a parked wake-up, once IGN is HIGH
+    if (!parkMode.isResting()) webServer.beginAsync();
+
+    // Modbus TCP task; it starts listening once the access point is up
+    modbusServer.begin();
+
+    // MQTT publisher task; idle until a broker is set
+    PDUTelemetry::begin(pdu);
 }
 
 void loop() {
+    PDUHeap::beginTick();
+
     // Handle web client requests
     webServer.handleClient();
+
+    // Handle serial commands
+    SerialCommandHandler::poll(pdu);
     
-    // Update PDU state (temperature, voltage, etc)
+    // Apply queued commands, then update PDU state (temperature, voltage, etc)
     pdu.update();
 
-    // Handle serial commands
-    if (Serial.available() > 0) {
-        String command = Serial.readStringUntil('\n');
-        command.trim();
-        SerialCommandHandler::handleCommand(command, pdu);
-    }
+    // Sample the new state into the telemetry batch
+    PDUTelemetry::update();
+
+    // Sleep while parked (IGN LOW, relay OFF)
+    parkMode.update();
+
+    PDUHeap::endTick();
 }
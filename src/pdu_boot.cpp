@@ -0,0 +1,27 @@
+/*
+ * PDU Boot Timing Implementation
+ *
+ * This file holds the boot phase timestamps and their report names.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_boot.h"
+#include "pdu_no_string.h"
+
+volatile uint32_t PDUBoot::phaseTimes[BOOT_PHASE_COUNT];
+
+const char* PDUBoot::getPhaseName(BootPhase phase) {
+    switch (phase) {
+        case BOOT_OUTPUTS_SAFE: return "outputsSafe";
+        case BOOT_SETTINGS_LOADED: return "settingsLoaded";
+        case BOOT_FIRST_DECISION: return "firstDecision";
+        case BOOT_SENSORS_READY: return "sensorsReady";
+        case BOOT_WIFI_READY: return "wifiReady";
+        case BOOT_HTTP_READY: return "httpReady";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,190 @@
+/*
+ * PDU Command Queue Implementation
+ *
+ * This file implements the multi-producer command queue. A cell's
+ * sequence holds the base position of the round it is free for, and that
+ * base + 1 once a producer has filled it, so the zeroed arrays are already
+ * a valid empty queue. Results are published the same way as event log
+ * slots: the ticket is cleared, the status written, then the ticket stored
+ * again, and readers discard a copy whose ticket changed while reading.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_command_queue.h"
+#include "pdu_no_string.h"
+
+static_assert((COMMAND_QUEUE_SIZE & (COMMAND_QUEUE_SIZE - 1)) == 0, "COMMAND_QUEUE_SIZE must be a power of two");
+static_assert((COMMAND_RESULT_SLOTS & (COMMAND_RESULT_SLOTS - 1)) == 0, "COMMAND_RESULT_SLOTS must be a power of two");
+
+static const uint32_t QUEUE_MASK = COMMAND_QUEUE_SIZE - 1;
+static const uint32_t RESULT_MASK = COMMAND_RESULT_SLOTS - 1;
+
+PDUCommandQueue::Cell PDUCommandQueue::cells[COMMAND_QUEUE_SIZE];
+std::atomic<uint32_t> PDUCommandQueue::enqueuePos(0);
+uint32_t PDUCommandQueue::dequeuePos = 0;
+std::atomic<uint32_t> PDUCommandQueue::fullCount(0);
+PDUCommandQueue::Result PDUCommandQueue::results[COMMAND_RESULT_SLOTS];
+
+uint32_t PDUCommandQueue::submit(PDUCommand& command) {
+    uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+        cell = &cells[pos & QUEUE_MASK];
+        uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - (pos & ~QUEUE_MASK));
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // Cell still holds a command from the previous round: the controller is behind
+            fullCount.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    command.ticket = pos + 1;
+    cell->command = command;
+    cell->sequence.store((pos & ~QUEUE_MASK) + 1, std::memory_order_release);
+    return command.ticket;
+}
+
+// Claims count consecutive cells with one compare-and-swap, so either every command
+// is queued or none is (a multi-register write never ends up partly applied)
+uint32_t PDUCommandQueue::submitAll(PDUCommand* commands, size_t count) {
+    if (count == 0 || count > COMMAND_QUEUE_SIZE) return 0;
+
+    uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        bool claimed = false;
+        size_t i = 0;
+        for (; i < count; i++) {
+            uint32_t cellPos = pos + i;
+            uint32_t seq = cells[cellPos & QUEUE_MASK].sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - (cellPos & ~QUEUE_MASK));
+            if (diff < 0) {
+                fullCount.fetch_add(1, std::memory_order_relaxed);
+                return 0;
+            }
+            if (diff > 0) break;    // Another producer got there first
+        }
+        if (i == count) claimed = enqueuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed);
+        if (claimed) break;
+        pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t cellPos = pos + i;
+        Cell& cell = cells[cellPos & QUEUE_MASK];
+        commands[i].ticket = cellPos + 1;
+        cell.command = commands[i];
+        cell.sequence.store((cellPos & ~QUEUE_MASK) + 1, std::memory_order_release);
+    }
+    return commands[count - 1].ticket;
+}
+
+bool PDUCommandQueue::dequeue(PDUCommand& command) {
+    Cell& cell = cells[dequeuePos & QUEUE_MASK];
+    uint32_t base = dequeuePos & ~QUEUE_MASK;
+    if (cell.sequence.load(std::memory_order_acquire) != base + 1) return false;
+
+    command = cell.command;
+    cell.sequence.store(base + COMMAND_QUEUE_SIZE, std::memory_order_release);
+    dequeuePos++;
+    return true;
+}
+
+void PDUCommandQueue::complete(const PDUCommand& command, CommandStatus status) {
+    Result& result = results[command.ticket & RESULT_MASK];
+    result.ticket.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    result.status = status;
+    result.ticket.store(command.ticket, std::memory_order_release);
+
+    if (command.callback) command.callback(command, status, command.context);
+}
+
+CommandStatus PDUCommandQueue::getResult(uint32_t ticket) {
+    uint32_t issued = enqueuePos.load(std::memory_order_acquire);
+    if (ticket == 0 || (int32_t)(ticket - issued) > 0) return CMD_UNKNOWN;
+
+    const Result& result = results[ticket & RESULT_MASK];
+    uint32_t tag = result.ticket.load(std::memory_order_acquire);
+    if (tag == ticket) {
+        CommandStatus status = result.status;
+        if (result.ticket.load(std::memory_order_acquire) == ticket) return status;
+        return CMD_UNKNOWN;
+    }
+
+    // Results are completed in ticket order, so an older ticket in the slot means not done yet
+    return (int32_t)(ticket - tag) > 0 ? CMD_PENDING : CMD_UNKNOWN;
+}
+
+const char* PDUCommandQueue::getStatusName(CommandStatus status) {
+    switch (status) {
+        case CMD_PENDING: return "pending";
+        case CMD_APPLIED: return "applied";
+        case CMD_SUPERSEDED: return "superseded";
+        case CMD_REJECTED: return "rejected";
+        default: return "unknown";
+    }
+}
+
+PDUCommand PDUCommandQueue::makeCommand(CommandType type, CommandCallback callback, void* context) {
+    PDUCommand command = {};
+    command.type = type;
+    command.callback = callback;
+    command.context = context;
+    return command;
+}
+
+uint32_t PDUCommandQueue::setChannel(uint8_t channel, bool on, CommandCallback callback, void* context) {
+    if (channel < 1 || channel > 4) return 0;
+    PDUCommand command = makeCommand(CMD_SET_CHANNEL, callback, context);
+    command.channel = channel;
+    command.state = on;
+    return submit(command);
+}
+
+uint32_t PDUCommandQueue::setRelayFlag(bool on, CommandCallback callback, void* context) {
+    PDUCommand command = makeCommand(CMD_SET_RELAY_FLAG, callback, context);
+    command.state = on;
+    return submit(command);
+}
+
+uint32_t PDUCommandQueue::setTempThreshold(float celsius, CommandCallback callback, void* context) {
+    PDUCommand command = makeCommand(CMD_SET_TEMP_THRESHOLD, callback, context);
+    command.temperature = celsius;
+    return submit(command);
+}
+
+uint32_t PDUCommandQueue::setTimeThreshold(uint32_t ms, CommandCallback callback, void* context) {
+    PDUCommand command = makeCommand(CMD_SET_TIME_THRESHOLD, callback, context);
+    command.timeMs = ms;
+    return submit(command);
+}
+
+uint32_t PDUCommandQueue::setSequenceStep(uint8_t channel, const SequenceStep& step,
+                                          CommandCallback callback, void* context) {
+    if (channel < 2 || channel > 4) return 0;
+    PDUCommand command = makeCommand(CMD_SET_SEQUENCE, callback, context);
+    command.channel = channel;
+    command.step = step;
+    return submit(command);
+}
+
+uint32_t PDUCommandQueue::clearVpLockout(CommandCallback callback, void* context) {
+    PDUCommand command = makeCommand(CMD_CLEAR_VP_LOCK, callback, context);
+    return submit(command);
+}
+
+uint32_t PDUCommandQueue::setParkMode(bool enabled, uint32_t wakeIntervalMs, CommandCallback callback, void* context) {
+    PDUCommand command = makeCommand(CMD_SET_PARK_MODE, callback, context);
+    command.state = enabled;
+    command.timeMs = wakeIntervalMs;
+    return submit(command);
+}
@@ -12,12 +12,21 @@
  */
 
 #include "pdu_controller.h"
+#include "pdu_logger.h"
+#include "pdu_boot.h"
+#include "pdu_journal.h"
+#include "pdu_command_queue.h"
+#include "pdu_warm_state.h"
+#include "pdu_no_string.h"
 
 PDUController::PDUController() 
     : oneWire(TEMP_PIN)
     , sensors(&oneWire)
     , relayState(false)
+    , relayOnTime(0)
     , relayFlag(true)
+    , parkEnabled(false)
+    , parkWakeInterval(PARK_WAKE_INTERVAL)
     , currentTemp(0.0f)
     , tempThreshold(DEFAULT_TEMP_THRESHOLD)
     , timeThreshold(DEFAULT_TIME_THRESHOLD)
@@ -25,22 +34,86 @@ PDUController::PDUController()
     , batteryVoltage(0.0f)
     , ignLowStartTime(0)
     , lastTempCheckTime(0)
+    , sensorsReady(false)
     , lastStableTime(0)
     , lastStableState(LOW)
+    , batteryAdc(0)
+    , sampleLevel(SAMPLE_NORMAL)
+    , conversionPending(false)
+    , tempValid(false)
+    , conversionStartTime(0)
+    , tempRate(0.0f)
     , lastVpPinState(-1)
     , lastCh1PinState(-1)
     , lastNormalOpTime(0)
     , faultHandlingInProgress(false)
+    , vpFaultStartTime(0)
+    , vpTripPending(false)
+    , vpTripTime(0)
+    , vpTripLatency(0)
+    , vpTripCount(0)
+    , maxVpTripLatency(0)
+    , seqPhase(SEQ_IDLE)
+    , seqPhaseTime(0)
+    , seqStartTime(0)
+    , seqUpTime{0, 0, 0, 0}
+    , seqPendingMask(0)
+    , vpLowValid(false)
+    , vpLowSince(0)
+    , lastSequenceTime(0)
+    , ruleHeldOff(0)
+    , lastTickUs(0)
+    , maxTickUs(0)
+    , traceEventSeq(0)
+    , traceTemp(0.0f)
+    , traceBatteryAdc(0)
+    , stateVersion(0)
+    , statusSeq(0)
 {
+    // Default profile: CH2 once CH1 is stable, then CH3 after CH2 and CH4 after CH3, each
+    // SEQ_DEFAULT_STAGGER_MS later to spread inrush (also on the timeout fallback)
+    for (uint8_t i = 0; i < SEQ_STEP_COUNT; i++) {
+        sequenceProfile[i].delayMs = i == 0 ? 0 : SEQ_DEFAULT_STAGGER_MS;
+        sequenceProfile[i].stableMs = SEQ_DEFAULT_STABLE_MS;
+        sequenceProfile[i].timeoutMs = CH_ACTIVATE_DELAY;
+        sequenceProfile[i].dependsOn = 1 << i;     // CH2 on CH1, CH3 on CH2, CH4 on CH3
+    }
+    memset(&status, 0, sizeof(status));
 }
 
 void PDUController::begin() {
-    initPins();
+    // Only what the first relay decision needs; sensors follow in beginSensors()
+    WarmRuntime runtime;
+    bool warm = PDUWarmState::begin() && PDUWarmState::loadRuntime(runtime);
+    initPins(warm ? runtime.outputs : 0);   // After a warm restart the outputs never glitch OFF
+    PDUBoot::mark(BOOT_OUTPUTS_SAFE);
+
+    // Settings come from RTC memory when it still holds them, otherwise from flash
+    WarmSettings settings;
+    if (PDUWarmState::loadSettings(settings)) {
+        applyWarmSettings(settings);
+    } else {
+        loadSettings();
+    }
+    if (warm) restoreRuntime(runtime);
+    PDUBoot::mark(BOOT_SETTINGS_LOADED);
+    PDUEventLog::begin();
+
+    // Cut CH1 straight from the interrupt instead of waiting for the next loop() poll
+    attachInterruptArg(digitalPinToInterrupt(VP_PIN), vpFaultIsr, this, CHANGE);
+}
+
+void PDUController::beginSensors() {
     sensors.begin();
-    loadSettings();
+    sensors.setWaitForConversion(false);  // Conversions are collected by later update() calls
+    sensors.setAutoSaveScratchPad(false); // Resolution changes: no EEPROM write, no 20 ms wait
+    sensors.setResolution(getSampleResolution());
+    sensorsReady = true;
+    lastTempCheckTime = millis() - TEMP_CHECK_INTERVAL;  // Start a conversion on the next update()
+    PDUBoot::mark(BOOT_SENSORS_READY);
 }
 
-void PDUController::initPins() {
+void PDUController::initPins(uint8_t outputsOn) {
     pinMode(F1_PIN, INPUT);
     pinMode(F2_PIN, INPUT);
     pinMode(F3_PIN, INPUT);
@@ -53,74 +126,200 @@ void PDUController::initPins() {
     pinMode(CH4_PIN, OUTPUT);
     pinMode(RELAY_PIN, OUTPUT);
 
-    // Initialize all channels to OFF
-    digitalWrite(CH1_PIN, HIGH);
-    digitalWrite(CH2_PIN, HIGH);
-    digitalWrite(CH3_PIN, HIGH);
-    digitalWrite(CH4_PIN, HIGH);
-    digitalWrite(RELAY_PIN, LOW);
+    // Channels are active LOW; everything starts OFF unless restored ON (bit 0-3 CH1-CH4, bit 4 relay)
+    digitalWrite(CH1_PIN, (outputsOn & 0x01) ? LOW : HIGH);
+    digitalWrite(CH2_PIN, (outputsOn & 0x02) ? LOW : HIGH);
+    digitalWrite(CH3_PIN, (outputsOn & 0x04) ? LOW : HIGH);
+    digitalWrite(CH4_PIN, (outputsOn & 0x08) ? LOW : HIGH);
+    digitalWrite(RELAY_PIN, (outputsOn & 0x10) ? HIGH : LOW);
 }
 
 void PDUController::turnOnSequence() {
-    // Start with relay on
-    digitalWrite(RELAY_PIN, HIGH);
-    delay(RELAY_DELAY);
+    // Start with relay on; the rest of the sequence is stepped by runSequencer()
+    writeOutput(RELAY_PIN, HIGH);
+    relayState = true;
+    relayOnTime = micros();
+    seqStartTime = millis();
+    seqPendingMask = 0;
+    vpLowValid = false;
+    setSequencePhase(SEQ_RELAY);
+}
+
+void PDUController::setSequencePhase(SequencePhase phase) {
+    seqPhase = phase;
+    seqPhaseTime = millis();
+}
+
+void PDUController::runSequencer() {
+    if (seqPhase == SEQ_IDLE) return;
+
+    unsigned long now = millis();
+    unsigned long elapsed = now - seqPhaseTime;
 
     // CH1 edge control sequence
-    digitalWrite(CH1_PIN, LOW);   // Turn on CH1
-    delay(CH1_PULSE);            // Wait 100ms
-    digitalWrite(CH1_PIN, HIGH);  // Turn off CH1
-    delay(CH1_OFF_TIME);         // Wait 50ms
-    digitalWrite(CH1_PIN, LOW);   // Turn on CH1 again
-    
-    delay(CH_ACTIVATE_DELAY);    // Wait before other channels
+    switch (seqPhase) {
+        case SEQ_RELAY:
+            if (elapsed < RELAY_DELAY) return;
+            if (isCh1Locked()) {
+                // CH1 stays off after a VP lockout; the other channels start on their timeouts
+                seqUpTime[0] = now - seqStartTime;
+                seqPendingMask = 0x0E;
+                setSequencePhase(SEQ_CHANNELS);
+                return;
+            }
+            writeOutput(CH1_PIN, LOW);   // Turn on CH1
+            setSequencePhase(SEQ_CH1_PULSE);
+            return;
+        case SEQ_CH1_PULSE:
+            if (elapsed < CH1_PULSE) return;
+            writeOutput(CH1_PIN, HIGH);  // Turn off CH1
+            setSequencePhase(SEQ_CH1_OFF);
+            return;
+        case SEQ_CH1_OFF:
+            if (elapsed < CH1_OFF_TIME) return;
+            // A VP trip during the edge pulse leaves CH1 to the VP retry; the rest time out as on lockout
+            if (!faultHandlingInProgress && !vpTripPending && !isCh1Locked()) {
+                writeOutput(CH1_PIN, LOW);   // Turn on CH1 again
+            }
+            seqUpTime[0] = now - seqStartTime;
+            seqPendingMask = 0x0E;
+            setSequencePhase(SEQ_CHANNELS);
+            return;
+        default:
+            break;
+    }
 
-    // Turn on other channels
-    digitalWrite(CH2_PIN, LOW);
-    digitalWrite(CH3_PIN, LOW);
-    digitalWrite(CH4_PIN, LOW);
+    // Track how long CH1 has been ON with VP LOW
+    if (digitalRead(CH1_PIN) == LOW && digitalRead(VP_PIN) == LOW) {
+        if (!vpLowValid) {
+            vpLowValid = true;
+            vpLowSince = now;
+        }
+    } else {
+        vpLowValid = false;
+    }
 
-    relayState = true;
-    Serial.println("Full sequence completed: CH1 edge control + other channels");
+    // Bring up each remaining channel as soon as its own conditions hold
+    unsigned long sinceStart = now - seqStartTime;
+    for (uint8_t channel = 2; channel <= 4; channel++) {
+        uint8_t bit = 1 << (channel - 1);
+        if (!(seqPendingMask & bit)) continue;
+
+        const SequenceStep& step = sequenceProfile[channel - 2];
+        if (step.dependsOn & seqPendingMask) continue;
+
+        unsigned long depsUpTime = seqUpTime[0];
+        for (uint8_t i = 1; i < 4; i++) {
+            if ((step.dependsOn & (1 << i)) && seqUpTime[i] > depsUpTime) depsUpTime = seqUpTime[i];
+        }
+        if (sinceStart - depsUpTime < step.delayMs) continue;
+
+        bool stable = step.stableMs == 0 || (vpLowValid && now - vpLowSince >= step.stableMs);
+        bool timedOut = step.timeoutMs > 0 && sinceStart >= step.timeoutMs;
+        if (!stable && !timedOut) continue;
+
+        // A channel a rule holds off counts as up for its dependents but is not switched on
+        if (!(ruleHeldOff & bit)) writeOutput(channelPin(channel), LOW);
+        seqUpTime[channel - 1] = sinceStart;
+        seqPendingMask &= ~bit;
+    }
+
+    if (seqPendingMask == 0) {
+        lastSequenceTime = sinceStart;
+        seqPhase = SEQ_IDLE;
+        LOG_INFO("Full sequence completed in %lu ms: CH1 edge control + other channels", sinceStart);
+    }
+}
+
+bool PDUController::isProfileValid(const SequenceStep* profile) {
+    // Every channel must be reachable: resolve dependencies until nothing changes
+    uint8_t pending = 0x0E;
+    for (uint8_t pass = 0; pass < SEQ_STEP_COUNT; pass++) {
+        for (uint8_t channel = 2; channel <= 4; channel++) {
+            uint8_t bit = 1 << (channel - 1);
+            uint8_t deps = profile[channel - 2].dependsOn;
+            if ((deps & bit) || (deps & ~0x0F)) return false;
+            if ((pending & bit) && !(deps & pending)) pending &= ~bit;
+        }
+    }
+    return pending == 0;
+}
+
+bool PDUController::isSequenceStepValid(uint8_t channel, const SequenceStep& step) const {
+    if (channel < 2 || channel > 4) return false;
+
+    SequenceStep profile[SEQ_STEP_COUNT];
+    memcpy(profile, sequenceProfile, sizeof(profile));
+    profile[channel - 2] = step;
+    return isProfileValid(profile);
+}
+
+bool PDUController::updateSequenceStep(uint8_t channel, const SequenceStep& step) {
+    if (!isSequenceStepValid(channel, step)) return false;
+    sequenceProfile[channel - 2] = step;
+    return true;
+}
+
+bool PDUController::setSequenceStep(uint8_t channel, const SequenceStep& step) {
+    if (!updateSequenceStep(channel, step)) return false;
+    saveSettings();
+    return true;
 }
 
 void PDUController::turnOffSequence() {
-    digitalWrite(CH1_PIN, HIGH);
-    digitalWrite(CH2_PIN, HIGH);
-    digitalWrite(CH3_PIN, HIGH);
-    digitalWrite(CH4_PIN, HIGH);
-    digitalWrite(RELAY_PIN, LOW);
+    seqPhase = SEQ_IDLE;
+    faultHandlingInProgress = false;    // A pending CH1 retry must not outlive the shutdown
+    writeOutput(CH1_PIN, HIGH);
+    writeOutput(CH2_PIN, HIGH);
+    writeOutput(CH3_PIN, HIGH);
+    writeOutput(CH4_PIN, HIGH);
+    writeOutput(RELAY_PIN, LOW);
     relayState = false;
 }
 
-void PDUController::setChannel(uint8_t channel, bool state) {
-    if (channel < 1 || channel > 4) return;
-    
-    int pin;
+void PDUController::writeOutput(uint8_t pin, uint8_t level) {
+    digitalWrite(pin, level);
+    PDUEventLog::record(pin, level);
+}
+
+int PDUController::channelPin(uint8_t channel) {
     switch(channel) {
-        case 1: pin = CH1_PIN; break;
-        case 2: pin = CH2_PIN; break;
-        case 3: pin = CH3_PIN; break;
-        case 4: pin = CH4_PIN; break;
-        default: return;
+        case 1: return CH1_PIN;
+        case 2: return CH2_PIN;
+        case 3: return CH3_PIN;
+        case 4: return CH4_PIN;
+        default: return -1;
     }
-    
-    digitalWrite(pin, state ? LOW : HIGH);
+}
+
+void PDUController::setChannel(uint8_t channel, bool state) {
+    if (channel < 1 || channel > 4) return;
+    writeOutput(channelPin(channel), state ? LOW : HIGH);
 }
 
 bool PDUController::getChannelState(uint8_t channel) const {
     if (channel < 1 || channel > 4) return false;
-    
-    int pin;
-    switch(channel) {
-        case 1: pin = CH1_PIN; break;
-        case 2: pin = CH2_PIN; break;
-        case 3: pin = CH3_PIN; break;
-        case 4: pin = CH4_PIN; break;
-        default: return false;
-    }
-    
-    return digitalRead(pin) == LOW;
+    return digitalRead(channelPin(channel)) == LOW;
+}
+
+void IRAM_ATTR PDUController::vpFaultIsr(void* arg) {
+    PDUController* pdu = static_cast<PDUController*>(arg);
+    // The edge itself cannot be timestamped in software: the latency below runs from
+    // handler entry to the CH1 write and leaves out interrupt dispatch (measure that
+    // edge-to-cut on a scope)
+    uint32_t entryTime = micros();
+    int vpLevel = digitalRead(VP_PIN);
+    PDUEventLog::record(VP_PIN, vpLevel);
+
+    // GPIO36 can raise spurious edges while the ADC/WiFi is active, so confirm the level
+    if (vpLevel != HIGH || digitalRead(CH1_PIN) != LOW) return;
+
+    digitalWrite(CH1_PIN, HIGH);
+    pdu->vpTripLatency = micros() - entryTime;
+    PDUEventLog::record(CH1_PIN, HIGH);
+    pdu->vpTripTime = entryTime;
+    pdu->vpTripCount = pdu->vpTripCount + 1;
+    pdu->vpTripPending = true;
 }
 
 void PDUController::handleVPFault() {
@@ -130,72 +329,113 @@ void PDUController::handleVPFault() {
     
     // Report state changes
     if (currentVpPin != lastVpPinState || currentCh1Pin != lastCh1PinState) {
-        Serial.println("Status Update:");
-        Serial.println("VP_PIN State: " + String(currentVpPin ? "HIGH (Fault)" : "LOW (Normal)"));
-        Serial.println("CH1_PIN State: " + String(currentCh1Pin ? "HIGH (OFF)" : "LOW (ON)"));
-        Serial.println("Current Reset Attempts: " + String(vpResetAttempts));
+        LOG_INFO("Status Update:");
+        LOG_INFO("VP_PIN State: %s", currentVpPin ? "HIGH (Fault)" : "LOW (Normal)");
+        LOG_INFO("CH1_PIN State: %s", currentCh1Pin ? "HIGH (OFF)" : "LOW (ON)");
+        LOG_INFO("Current Reset Attempts: %d", vpResetAttempts);
         lastVpPinState = currentVpPin;
         lastCh1PinState = currentCh1Pin;
     }
+
+    // Deferred handling of a trip taken in the ISR (CH1 is already OFF)
+    if (vpTripPending) {
+        vpTripPending = false;
+        uint32_t latency = vpTripLatency;
+        if (latency > maxVpTripLatency) maxVpTripLatency = latency;
+        LOG_WARN("FAULT DETECTED: VP_PIN went HIGH while CH1 was ON (CH1 cut %lu us after ISR entry)",
+                 (unsigned long)latency);
+        PDUJournal::append(JOURNAL_VP_TRIP, vpResetAttempts, latency);
+        startVPRecovery();
+        return;
+    }
+
+    // Retry CH1 once the off period has elapsed, without blocking the loop; never while
+    // the relay is OFF or the power-up sequence owns CH1 (edge-control pulse)
+    if (faultHandlingInProgress) {
+        if (millis() - vpFaultStartTime >= VP_RETRY_DELAY && relayState && seqPhase == SEQ_IDLE) {
+            setChannel(1, true);
+            LOG_INFO("CH1 turned back ON");
+
+            vpResetAttempts++;
+            LOG_INFO("Reset attempt %d of %d", vpResetAttempts, MAX_VP_RESETS);
+            PDUJournal::append(JOURNAL_VP_RETRY, vpResetAttempts);
+
+            faultHandlingInProgress = false;
+        }
+        return;
+    }
     
-    // VP_PIN fault handling for CH1 only
+    // Polled fallback for VP_PIN fault handling on CH1 (e.g. VP already HIGH when CH1 turns on)
     if (!currentCh1Pin) {  // If CH1 is ON (LOW)
         if (currentVpPin == HIGH) {  // Fault detected
-            // If we've reached max attempts, permanently disable CH1
-            if (vpResetAttempts > MAX_VP_RESETS) {
-                Serial.println("CRITICAL: Maximum reset attempts reached!");
-                // Permanent shutdown of CH1
-                setChannel(1, false);
-                Serial.println("VP fault: Maximum reset attempts reached. CH1 locked and saved to flash memory.");
-                Serial.println("Manual intervention required to reset CH1");
-                saveSettings();
-            }
-            if (!faultHandlingInProgress && vpResetAttempts <= MAX_VP_RESETS) {
-                faultHandlingInProgress = true;
-                Serial.println("FAULT DETECTED: VP_PIN is HIGH while CH1 is ON");
-                
-                // Immediately turn CH1 OFF
-                setChannel(1, false);
-                Serial.println("CH1 turned OFF, waiting 30 seconds before reset...");
-                
-                // Wait 30 seconds
-                delay(30000);
-                
-                // Turn CH1 back ON
-                setChannel(1, true);
-                Serial.println("CH1 turned back ON");
-                
-                // Increment reset counter
-                vpResetAttempts++;
-                Serial.println("Reset attempt " + String(vpResetAttempts) + " of " + String(MAX_VP_RESETS));
-                
-                faultHandlingInProgress = false;
-            }
-            
+            LOG_WARN("FAULT DETECTED: VP_PIN is HIGH while CH1 is ON");
+            setChannel(1, false);
+            PDUJournal::append(JOURNAL_VP_TRIP, vpResetAttempts, -1);
+            startVPRecovery();
         } else {
             // If CH1 is ON but VP_PIN is LOW (normal operation)
             if (millis() - lastNormalOpTime >= 50000) {  // Print every 50 seconds during normal operation
-                Serial.println("Normal Operation: CH1 is ON, VP_PIN is LOW (no fault)");
+                LOG_INFO("Normal Operation: CH1 is ON, VP_PIN is LOW (no fault)");
                 lastNormalOpTime = millis();
             }
         }
     }
 }
 
+void PDUController::startVPRecovery() {
+    // If we've reached max attempts, leave CH1 permanently disabled
+    if (vpResetAttempts > MAX_VP_RESETS) {
+        LOG_ERROR("CRITICAL: Maximum reset attempts reached!");
+        LOG_ERROR("VP fault: Maximum reset attempts reached. CH1 locked and saved to flash memory.");
+        LOG_ERROR("Manual intervention required to reset CH1");
+        PDUJournal::append(JOURNAL_VP_LOCKOUT, vpResetAttempts - 1);
+        saveSettings();
+        return;
+    }
+
+    faultHandlingInProgress = true;
+    vpFaultStartTime = millis();
+    LOG_WARN("CH1 turned OFF, waiting %d seconds before reset...", VP_RETRY_DELAY / 1000);
+}
+
+void PDUController::clearVpLockout() {
+    if (!isCh1Locked()) return;
+
+    // CH1 is not switched back on here; the next power-up sequence (or SET_CH1) does that
+    vpResetAttempts = 1;
+    faultHandlingInProgress = false;
+    saveSettings();
+    PDUJournal::append(JOURNAL_VP_UNLOCK);
+    LOG_INFO("VP lockout cleared, CH1 enabled again");
+}
+
 void PDUController::update() {
+    uint32_t tickStart = micros();
+    if (PDUTrace::isRecording()) traceInputs();
+    processCommands();
     updateSensors();
     handleVPFault();
+    runSequencer();
     
     int ignState = debounceIgn();
     
     if (relayFlag) {
-        bool tempCondition = currentTemp >= tempThreshold;
-        bool timeCondition = (ignState == LOW) && 
-                           (millis() - lastStableTime >= timeThreshold);
+        bool shutdown;
+        JournalEventType reason = JOURNAL_RULES_TRIP;
+        if (rules.isLoaded()) {
+            shutdown = evaluateRules(ignState);
+        } else {
+            bool tempCondition = currentTemp >= tempThreshold;
+            bool timeCondition = (ignState == LOW) && 
+                               (millis() - lastStableTime >= timeThreshold);
+            shutdown = tempCondition || timeCondition;
+            reason = tempCondition ? JOURNAL_THERMAL_TRIP : JOURNAL_IGN_TIMEOUT;
+        }
 
-        if (tempCondition || timeCondition) {
+        if (shutdown) {
             if (relayState) {
                 turnOffSequence();
+                journalShutdown(reason, ignState);
             }
         } else if (ignState == HIGH && !relayState) {
             turnOnSequence();
@@ -203,18 +443,344 @@ void PDUController::update() {
     } else if (relayState) {
         turnOffSequence();
     }
+
+    // A sector erase stalls both cores (flash cache off); keep it to relay-OFF periods
+    PDUJournal::setEraseAllowed(!relayState);
+
+    updateStatus();
+    saveWarmState();
+
+    lastTickUs = micros() - tickStart;
+    if (lastTickUs > maxTickUs) maxTickUs = lastTickUs;
+}
+
+void PDUController::journalShutdown(JournalEventType reason, int ignState) {
+    int32_t temp = lroundf(currentTemp * 100);
+    switch (reason) {
+        case JOURNAL_THERMAL_TRIP:
+            PDUJournal::append(reason, temp, lroundf(tempThreshold * 100));
+            break;
+        case JOURNAL_IGN_TIMEOUT:
+            PDUJournal::append(reason, millis() - lastStableTime, timeThreshold);
+            break;
+        default:
+            PDUJournal::append(reason, temp, ignState);
+            break;
+    }
+}
+
+bool PDUController::evaluateRules(int ignState) {
+    RuleInputs inputs;
+    float* values = inputs.values;
+    values[RULE_VAR_TEMP] = currentTemp;
+    values[RULE_VAR_BAT] = batteryVoltage;
+    values[RULE_VAR_IGN] = ignState == HIGH;
+    values[RULE_VAR_VP] = digitalRead(VP_PIN) == HIGH;
+    values[RULE_VAR_F1] = digitalRead(F1_PIN) == HIGH;
+    values[RULE_VAR_F2] = digitalRead(F2_PIN) == HIGH;
+    values[RULE_VAR_F3] = digitalRead(F3_PIN) == HIGH;
+    values[RULE_VAR_F4] = digitalRead(F4_PIN) == HIGH;
+    for (uint8_t channel = 1; channel <= 4; channel++) {
+        values[RULE_VAR_CH1 + channel - 1] = getChannelState(channel);
+    }
+    values[RULE_VAR_RELAY] = relayState;
+    values[RULE_VAR_TEMP_THRESHOLD] = tempThreshold;
+    values[RULE_VAR_TIME_THRESHOLD] = timeThreshold;
+
+    RuleOutputs outputs;
+    rules.evaluate(inputs, millis(), outputs);
+    ruleHeldOff = outputs.channelsOff;
+
+    // Channel states are re-asserted every tick, so a restart of the power-up sequence or
+    // a manual command cannot undo a rule that still holds
+    if (!relayState || seqPhase != SEQ_IDLE || !(outputs.channelsOn | outputs.channelsOff)) {
+        return outputs.relayOff;
+    }
+
+    for (uint8_t channel = 1; channel <= 4; channel++) {
+        uint8_t bit = 1 << (channel - 1);
+        bool state = getChannelState(channel);
+        if ((outputs.channelsOff & bit) && state) {
+            setChannel(channel, false);
+            LOG_INFO("Rule: CH%d OFF", channel);
+        } else if ((outputs.channelsOn & bit) && !state) {
+            // Rules never override VP fault handling on CH1
+            if (channel == 1 && (faultHandlingInProgress || isCh1Locked())) continue;
+            setChannel(channel, true);
+            LOG_INFO("Rule: CH%d ON", channel);
+        }
+    }
+    return outputs.relayOff;
+}
+
+bool PDUController::loadRules(const char* source, char* error, size_t errorSize) {
+    if (!rules.compile(source, error, errorSize)) return false;
+
+    ruleHeldOff = 0;
+    saveSettings();
+    LOG_INFO("Rules loaded: %u rules, %u instructions", rules.getRuleCount(), rules.getCodeSize());
+    return true;
+}
+
+// Commands of the same kind for the same target within one batch: the last one wins
+static bool isSameTarget(const PDUCommand& a, const PDUCommand& b) {
+    if (a.type != b.type) return false;
+    if (a.type == CMD_SET_CHANNEL || a.type == CMD_SET_SEQUENCE) return a.channel == b.channel;
+    return true;
+}
+
+void PDUController::processCommands() {
+    PDUCommand batch[COMMAND_QUEUE_SIZE];
+    CommandStatus status[COMMAND_QUEUE_SIZE];
+    size_t count = 0;
+    while (count < COMMAND_QUEUE_SIZE && PDUCommandQueue::dequeue(batch[count])) count++;
+    if (count == 0) return;
+
+    bool settingsChanged = false;
+    for (size_t i = 0; i < count; i++) {
+        status[i] = CMD_SUPERSEDED;
+        bool superseded = false;
+        for (size_t j = i + 1; j < count && !superseded; j++) {
+            superseded = isSameTarget(batch[i], batch[j]);
+        }
+        if (!superseded) status[i] = applyCommand(batch[i], settingsChanged) ? CMD_APPLIED : CMD_REJECTED;
+    }
+
+    // One flash write for the whole batch
+    if (settingsChanged) saveSettings();
+
+    // Callbacks run after the batch so replies report the final state
+    for (size_t i = 0; i < count; i++) PDUCommandQueue::complete(batch[i], status[i]);
+}
+
+bool PDUController::applyCommand(const PDUCommand& command, bool& settingsChanged) {
+    switch (command.type) {
+        case CMD_SET_CHANNEL:
+            if (command.channel < 1 || command.channel > 4) return false;
+            setChannel(command.channel, command.state);
+            return true;
+        case CMD_SET_RELAY_FLAG:
+            relayFlag = command.state;
+            settingsChanged = true;
+            return true;
+        case CMD_SET_TEMP_THRESHOLD:
+            tempThreshold = command.temperature;
+            settingsChanged = true;
+            return true;
+        case CMD_SET_TIME_THRESHOLD:
+            timeThreshold = command.timeMs;
+            settingsChanged = true;
+            return true;
+        case CMD_SET_SEQUENCE:
+            if (!updateSequenceStep(command.channel, command.step)) return false;
+            settingsChanged = true;
+            return true;
+        case CMD_CLEAR_VP_LOCK:
+            clearVpLockout();
+            return true;
+        case CMD_SET_PARK_MODE:
+            parkEnabled = command.state;
+            parkWakeInterval = command.timeMs;
+            settingsChanged = true;
+            return true;
+    }
+    return false;
+}
+
+static float roundHundredths(float value) {
+    return roundf(value * 100.0f) / 100.0f;
+}
+
+void PDUController::updateStatus() {
+    PDUStatus next;
+    memset(&next, 0, sizeof(next));  // Padding too, so the snapshots can be compared with memcmp
+    next.fuses[0] = digitalRead(F1_PIN);
+    next.fuses[1] = digitalRead(F2_PIN);
+    next.fuses[2] = digitalRead(F3_PIN);
+    next.fuses[3] = digitalRead(F4_PIN);
+    next.ign = digitalRead(IGN_PIN);
+    next.relay = relayState ? 1 : 0;
+    next.vpLocked = isCh1Locked() ? 1 : 0;
+    for (uint8_t channel = 1; channel <= 4; channel++) next.channels[channel - 1] = getChannelState(channel) ? 1 : 0;
+    next.temp = roundHundredths(currentTemp);
+    next.tempThreshold = roundHundredths(tempThreshold);
+    next.battery = roundHundredths(batteryVoltage);
+    next.timeThreshold = timeThreshold;
+    next.vpTrips = vpTripCount;
+    next.vpTripLatencyUs = vpTripLatency;
+    next.vpTripMaxLatencyUs = maxVpTripLatency;
+
+    if (memcmp(&next, &status, sizeof(status)) == 0) return;
+
+    // Published like a seqlock so readStatus() never sees half of an update
+    uint32_t seq = statusSeq.load(std::memory_order_relaxed);
+    statusSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    status = next;
+    stateVersion++;
+    statusSeq.store(seq + 2, std::memory_order_release);
+}
+
+void PDUController::readStatus(PDUStatus& out, uint32_t& version) const {
+    for (;;) {
+        uint32_t seq = statusSeq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            taskYIELD();
+            continue;
+        }
+        out = status;
+        version = stateVersion;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (statusSeq.load(std::memory_order_relaxed) == seq) return;
+    }
+}
+
+uint32_t PDUController::getSampleInterval() const {
+    static const uint32_t intervals[] = { TEMP_SLOW_INTERVAL, TEMP_CHECK_INTERVAL, 0 };
+    return intervals[sampleLevel];
+}
+
+uint8_t PDUController::getSampleResolution() const {
+    static const uint8_t bits[] = { TEMP_SLOW_BITS, TEMP_NORMAL_BITS, TEMP_FAST_BITS };
+    return bits[sampleLevel];
 }
 
 void PDUController::updateSensors() {
-    if (millis() - lastTempCheckTime >= TEMP_CHECK_INTERVAL) {
+    if (!sensorsReady) return;
+
+    // Start a conversion once the interval since the last reading has passed
+    unsigned long now = millis();
+    if (!conversionPending) {
+        if (now - lastTempCheckTime < getSampleInterval()) return;
         sensors.requestTemperatures();
-        currentTemp = sensors.getTempCByIndex(0);
+        conversionStartTime = now;
+        conversionPending = true;
+        return;
+    }
+
+    // Collect it once the sensor has had its conversion time; the loop never waits on the bus
+    if (now - conversionStartTime < (unsigned long)sensors.millisToWaitForConversion(getSampleResolution())) return;
+    conversionPending = false;
+
+    float previousTemp = currentTemp;
+    float previousBattery = batteryVoltage;
+    currentTemp = sensors.getTempCByIndex(0);
+
+    sampleBattery();
 
-        int batValue = analogRead(BAT_PIN);
-        batteryVoltage = (batValue * 3.3 / 1024.0) * 3.3;
+    if (currentTemp == DEVICE_DISCONNECTED_C) {
+        tempValid = false;
+    } else {
+        if (tempValid && now != lastTempCheckTime) {
+            float rate = (currentTemp - previousTemp) * 1000.0f / (now - lastTempCheckTime);
+            tempRate += TEMP_RATE_SMOOTHING * (rate - tempRate);
+        }
+        tempValid = true;
+    }
+    lastTempCheckTime = now;
+    selectSampleLevel(previousBattery);
+
+    if (PDUTrace::isRecording()) {
+        if (currentTemp != traceTemp) {
+            PDUTrace::recordTemperature(lastTempCheckTime, currentTemp);
+            traceTemp = currentTemp;
+        }
+        if (abs((int)batteryAdc - (int)traceBatteryAdc) >= TRACE_ADC_DEADBAND) {
+            PDUTrace::recordAnalog(lastTempCheckTime, BAT_PIN, batteryAdc);
+            traceBatteryAdc = batteryAdc;
+        }
+    }
+}
+
+float PDUController::sampleBattery() {
+    batteryAdc = analogRead(BAT_PIN);
+    batteryVoltage = (batteryAdc * 3.3 / 1024.0) * 3.3;
+    return batteryVoltage;
+}
+
+void PDUController::selectSampleLevel(float previousBattery) {
+    // Margin to the threshold from the reading projected along the current rise rate
+    float projected = currentTemp + (tempRate > 0 ? tempRate : 0) * (TEMP_LOOKAHEAD / 1000.0f);
+    float margin = tempThreshold - projected;
+
+    SampleLevel level = margin <= TEMP_NEAR_MARGIN ? SAMPLE_FAST
+                      : margin <= TEMP_FAR_MARGIN ? SAMPLE_NORMAL : SAMPLE_SLOW;
 
-        lastTempCheckTime = millis();
+    // Slowing down needs extra margin so a reading on a boundary does not flip the resolution
+    if (level < sampleLevel) {
+        float settled = margin - TEMP_MARGIN_HYST;
+        level = settled <= TEMP_NEAR_MARGIN ? SAMPLE_FAST
+              : settled <= TEMP_FAR_MARGIN ? SAMPLE_NORMAL : SAMPLE_SLOW;
+        if (level > sampleLevel) level = sampleLevel;
     }
+
+    // Slow sampling only while readings are steady; rules may use thresholds of their own
+    if (level == SAMPLE_SLOW && (!tempValid || rules.isLoaded() || fabsf(tempRate) >= TEMP_STABLE_RATE ||
+                                 fabsf(batteryVoltage - previousBattery) >= BATTERY_STABLE_STEP)) {
+        level = SAMPLE_NORMAL;
+    }
+
+    if (level == sampleLevel) return;
+    sampleLevel = level;
+    sensors.setResolution(getSampleResolution());
+    LOG_DEBUG("Sampling every %lu ms at %u bits (%.2f degC/s)", (unsigned long)getSampleInterval(),
+              getSampleResolution(), tempRate);
+}
+
+void PDUController::startTrace() {
+    // Snapshot inputs and settings so a replay can boot into the same configuration
+    uint32_t now = millis();
+    PDUTrace::start(now);
+    traceEventSeq = PDUEventLog::getNextSeq();
+    traceTemp = currentTemp;
+    traceBatteryAdc = batteryAdc;
+
+    static const uint8_t INPUT_PINS[] = { F1_PIN, F2_PIN, F3_PIN, F4_PIN, IGN_PIN, VP_PIN };
+    for (uint8_t pin : INPUT_PINS) PDUTrace::recordPin(now, pin, digitalRead(pin));
+    PDUTrace::recordTemperature(now, currentTemp);
+    PDUTrace::recordAnalog(now, BAT_PIN, batteryAdc);
+
+    char command[64];
+    snprintf(command, sizeof(command), "SET_TSTemp:%.9g", tempThreshold);
+    PDUTrace::recordCommand(command);
+    snprintf(command, sizeof(command), "SET_TSTime:%.9g", timeThreshold / 60000.0);
+    PDUTrace::recordCommand(command);
+    snprintf(command, sizeof(command), "SET_RELAY:%d", relayFlag ? 1 : 0);
+    PDUTrace::recordCommand(command);
+    snprintf(command, sizeof(command), "SET_PARK:%d,%.9g", parkEnabled ? 1 : 0, parkWakeInterval / 60000.0);
+    PDUTrace::recordCommand(command);
+    for (uint8_t channel = 2; channel <= 4; channel++) {
+        const SequenceStep& step = sequenceProfile[channel - 2];
+        snprintf(command, sizeof(command), "SET_SEQ%u:%lu,%u,%lu,%lu", channel, (unsigned long)step.delayMs,
+                 step.dependsOn, (unsigned long)step.stableMs, (unsigned long)step.timeoutMs);
+        PDUTrace::recordCommand(command);
+    }
+    PDUTrace::recordCommand("SET_RULES:", rules.getSource());
+    PDUTrace::recordStart(now);
+    LOG_INFO("Trace recording started");
+}
+
+void PDUController::stopTrace() {
+    PDUTrace::stop();
+    LOG_INFO("Trace recording stopped (%u bytes)", (unsigned)PDUTrace::getSize());
+}
+
+void PDUController::traceInputs() {
+    // Input edges come from the event log, which already timestamps them in the ISRs
+    PDUEvent events[16];
+    uint32_t nowMs = millis();
+    uint32_t nowUs = micros();
+    size_t count;
+    do {
+        count = PDUEventLog::read(traceEventSeq, events, 16, traceEventSeq);
+        for (size_t i = 0; i < count; i++) {
+            uint8_t pin = events[i].pin;
+            if (pin != F1_PIN && pin != F2_PIN && pin != F3_PIN && pin != F4_PIN &&
+                pin != IGN_PIN && pin != VP_PIN) continue;
+            uint32_t ageMs = (nowUs - events[i].timestampUs) / 1000;
+            PDUTrace::recordPin(nowMs - ageMs, pin, events[i].level);
+        }
+    } while (count == 16);
 }
 
 int PDUController::debounceIgn() {
@@ -237,7 +803,31 @@ void PDUController::loadSettings() {
         timeThreshold = preferences.getULong("timeThresh", DEFAULT_TIME_THRESHOLD);
         relayFlag = preferences.getBool("relayFlag", true);
     }
+    parkEnabled = preferences.getBool("parkMode", false);
+    parkWakeInterval = preferences.getULong("parkWake", PARK_WAKE_INTERVAL);
+
+    // A VP lockout survives reboots until it is cleared
+    if (preferences.getBool("vpLocked", false)) {
+        vpResetAttempts = MAX_VP_RESETS + 1;
+        LOG_WARN("CH1 locked out after VP faults (restored from flash)");
+    }
+
+    SequenceStep profile[SEQ_STEP_COUNT];
+    if (preferences.getBytesLength("seqProfile") == sizeof(profile)) {
+        preferences.getBytes("seqProfile", profile, sizeof(profile));
+        if (isProfileValid(profile)) memcpy(sequenceProfile, profile, sizeof(sequenceProfile));
+    }
+
+    if (preferences.isKey("rules")) {
+        char source[RULES_MAX_SOURCE];
+        char error[64];
+        if (preferences.getString("rules", source, sizeof(source)) > 0 &&
+            !rules.compile(source, error, sizeof(error))) {
+            LOG_ERROR("Stored rules rejected: %s", error);
+        }
+    }
     preferences.end();
+    mirrorSettings();
 }
 
 void PDUController::saveSettings() {
@@ -245,7 +835,85 @@ void PDUController::saveSettings() {
     preferences.putFloat("tempThresh", tempThreshold);
     preferences.putULong("timeThresh", timeThreshold);
     preferences.putBool("relayFlag", relayFlag);
+    preferences.putBool("parkMode", parkEnabled);
+    preferences.putULong("parkWake", parkWakeInterval);
+    preferences.putBool("vpLocked", isCh1Locked());
+    preferences.putBytes("seqProfile", sequenceProfile, sizeof(sequenceProfile));
+    preferences.putString("rules", rules.getSource());
     preferences.end();
+    mirrorSettings();
+}
+
+void PDUController::applyWarmSettings(const WarmSettings& settings) {
+    tempThreshold = settings.tempThreshold;
+    timeThreshold = settings.timeThreshold;
+    relayFlag = settings.relayFlag != 0;
+    parkEnabled = settings.parkEnabled != 0;
+    parkWakeInterval = settings.parkWakeInterval;
+    if (settings.vpLocked) vpResetAttempts = MAX_VP_RESETS + 1;
+    if (isProfileValid(settings.profile)) memcpy(sequenceProfile, settings.profile, sizeof(sequenceProfile));
+
+    char error[64];
+    if (settings.rules[0] != '\0' && !rules.compile(settings.rules, error, sizeof(error))) {
+        LOG_ERROR("Warm rules rejected: %s", error);
+    }
+}
+
+void PDUController::mirrorSettings() {
+    // Same content as the NVS namespace, so a warm restart can skip flash entirely
+    WarmSettings settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.tempThreshold = tempThreshold;
+    settings.timeThreshold = timeThreshold;
+    settings.relayFlag = relayFlag ? 1 : 0;
+    settings.parkEnabled = parkEnabled ? 1 : 0;
+    settings.parkWakeInterval = parkWakeInterval;
+    settings.vpLocked = isCh1Locked() ? 1 : 0;
+    memcpy(settings.profile, sequenceProfile, sizeof(settings.profile));
+    snprintf(settings.rules, sizeof(settings.rules), "%s", rules.getSource());
+    PDUWarmState::saveSettings(settings);
+}
+
+void PDUController::restoreRuntime(const WarmRuntime& runtime) {
+    // Times come back as ages (see loadRuntime())
+    unsigned long now = millis();
+    relayState = (runtime.outputs & 0x10) != 0;
+    lastStableState = runtime.ignState;
+    lastStableTime = now - runtime.ignStableTime;
+
+    // The sequence resumes at the step it was on; the CH1 stability window starts over
+    seqPhase = (SequencePhase)runtime.seqPhase;
+    seqStartTime = now - runtime.seqStartTime;
+    seqPhaseTime = now - runtime.seqPhaseTime;
+    for (uint8_t i = 0; i < 4; i++) seqUpTime[i] = runtime.seqUpTime[i];
+    seqPendingMask = runtime.seqPendingMask;
+    vpLowValid = false;
+
+    vpResetAttempts = runtime.vpResetAttempts;
+    faultHandlingInProgress = runtime.vpRetryPending != 0;
+    vpFaultStartTime = now - runtime.vpFaultStartTime;
+    vpTripCount = runtime.vpTripCount;
+    LOG_INFO("Restored outputs 0x%02X, sequence phase %u", runtime.outputs, runtime.seqPhase);
+}
+
+void PDUController::saveWarmState() {
+    WarmRuntime runtime;
+    memset(&runtime, 0, sizeof(runtime));  // Padding too; saveRuntime() compares bytewise
+    // Output levels from the snapshot updateStatus() has just taken
+    for (uint8_t i = 0; i < 4; i++) runtime.outputs |= status.channels[i] << i;
+    if (relayState) runtime.outputs |= 0x10;
+    runtime.ignState = lastStableState;
+    runtime.seqPhase = seqPhase;
+    runtime.seqPendingMask = seqPendingMask;
+    runtime.vpResetAttempts = vpResetAttempts;
+    runtime.vpRetryPending = faultHandlingInProgress ? 1 : 0;
+    runtime.ignStableTime = lastStableTime;
+    runtime.seqStartTime = seqStartTime;
+    runtime.seqPhaseTime = seqPhaseTime;
+    for (uint8_t i = 0; i < 4; i++) runtime.seqUpTime[i] = seqUpTime[i];
+    runtime.vpFaultStartTime = vpFaultStartTime;
+    runtime.vpTripCount = vpTripCount;
+    PDUWarmState::saveRuntime(runtime);
 }
 
 void PDUController::setTempThreshold(float temp) {
@@ -264,13 +932,12 @@ void PDUController::setRelayFlag(bool state) {
 }
 
 void PDUController::printStatus() const {
-    Serial.println("System Status:");
-    Serial.println("Temperature: " + String(currentTemp, 2) + "°C");
-    Serial.println("Battery: " + String(batteryVoltage, 2) + "V");
-    Serial.println("Relay: " + String(relayState ? "ON" : "OFF"));
-    Serial.println("Channels:");
+    LOG_INFO("System Status:");
+    LOG_INFO("Temperature: %.2f°C", currentTemp);
+    LOG_INFO("Battery: %.2fV", batteryVoltage);
+    LOG_INFO("Relay: %s", relayState ? "ON" : "OFF");
+    LOG_INFO("Channels:");
     for (int i = 1; i <= 4; i++) {
-        Serial.println("CH" + String(i) + ": " + 
-                      String(getChannelState(i) ? "ON" : "OFF"));
+        LOG_INFO("CH%d: %s", i, getChannelState(i) ? "ON" : "OFF");
     }
 }
@@ -0,0 +1,72 @@
+/*
+ * PDU Event Log Implementation
+ *
+ * This file implements the edge-capture event journal. Writers claim a
+ * sequence number with an atomic increment and publish the slot once it
+ * is filled, so ISRs and tasks can record concurrently without locks.
+ * Readers skip slots that are still being written or were overwritten.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_event_log.h"
+#include "pdu_no_string.h"
+
+PDUEventLog::Slot PDUEventLog::slots[EVENT_LOG_SIZE];
+std::atomic<uint32_t> PDUEventLog::writeSeq(0);
+
+// VP_PIN is captured by the controller's fast-trip ISR (one handler per pin)
+static const uint8_t CAPTURE_PINS[] = { F1_PIN, F2_PIN, F3_PIN, F4_PIN, IGN_PIN };
+
+void PDUEventLog::begin() {
+    for (uint8_t pin : CAPTURE_PINS) {
+        attachInterruptArg(digitalPinToInterrupt(pin), edgeIsr,
+                           (void*)(uintptr_t)pin, CHANGE);
+    }
+}
+
+void IRAM_ATTR PDUEventLog::edgeIsr(void* arg) {
+    uint8_t pin = (uint8_t)(uintptr_t)arg;
+    record(pin, digitalRead(pin));
+}
+
+void IRAM_ATTR PDUEventLog::record(uint8_t pin, uint8_t level) {
+    uint32_t seq = writeSeq.fetch_add(1);
+    Slot& slot = slots[seq % EVENT_LOG_SIZE];
+
+    slot.seq.store(0, std::memory_order_relaxed);
+    slot.timestampUs = micros();
+    slot.pin = pin;
+    slot.level = level;
+    slot.seq.store(seq + 1, std::memory_order_release);
+}
+
+size_t PDUEventLog::read(uint32_t since, PDUEvent* out, size_t maxEvents, uint32_t& next) {
+    uint32_t end = writeSeq.load(std::memory_order_acquire);
+
+    // Older events have been overwritten; resume from the oldest one still held
+    if ((int32_t)(end - since) < 0) since = end;
+    else if (end - since > EVENT_LOG_SIZE) since = end - EVENT_LOG_SIZE;
+
+    size_t count = 0;
+    uint32_t seq = since;
+    for (; seq != end && count < maxEvents; seq++) {
+        const Slot& slot = slots[seq % EVENT_LOG_SIZE];
+        if (slot.seq.load(std::memory_order_acquire) != seq + 1) continue;
+
+        PDUEvent& event = out[count];
+        event.seq = seq;
+        event.timestampUs = slot.timestampUs;
+        event.pin = slot.pin;
+        event.level = slot.level;
+
+        // Discard the copy if a writer lapped us while reading
+        if (slot.seq.load(std::memory_order_acquire) == seq + 1) count++;
+    }
+
+    next = seq;
+    return count;
+}
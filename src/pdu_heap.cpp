@@ -0,0 +1,69 @@
+/*
+ * PDU Heap Telemetry Implementation
+ *
+ * This file implements the per-tick allocation counter. With PDU_HEAP_TRACE
+ * the build links with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc so
+ * every allocation passes through the wrappers below; only those made on
+ * the loop task are counted, so Wi-Fi and logger tasks do not skew the
+ * per-tick figures.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_heap.h"
+#include "pdu_no_string.h"
+
+TaskHandle_t PDUHeap::loopTask = nullptr;
+volatile uint32_t PDUHeap::allocCount = 0;
+uint32_t PDUHeap::tickStartCount = 0;
+uint32_t PDUHeap::lastTickAllocs = 0;
+uint32_t PDUHeap::maxTickAllocs = 0;
+uint32_t PDUHeap::allocTicks = 0;
+uint32_t PDUHeap::tickCount = 0;
+
+void PDUHeap::begin() {
+    loopTask = xTaskGetCurrentTaskHandle();
+}
+
+void IRAM_ATTR PDUHeap::countAllocation() {
+    if (loopTask && xTaskGetCurrentTaskHandle() == loopTask) allocCount = allocCount + 1;
+}
+
+void PDUHeap::beginTick() {
+    tickStartCount = allocCount;
+}
+
+void PDUHeap::endTick() {
+    lastTickAllocs = allocCount - tickStartCount;
+    if (lastTickAllocs > maxTickAllocs) maxTickAllocs = lastTickAllocs;
+    if (lastTickAllocs > 0) allocTicks++;
+    tickCount++;
+}
+
+#if PDU_HEAP_TRACE
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* IRAM_ATTR __wrap_malloc(size_t size) {
+    PDUHeap::countAllocation();
+    return __real_malloc(size);
+}
+
+void* IRAM_ATTR __wrap_calloc(size_t count, size_t size) {
+    PDUHeap::countAllocation();
+    return __real_calloc(count, size);
+}
+
+void* IRAM_ATTR __wrap_realloc(void* ptr, size_t size) {
+    PDUHeap::countAllocation();
+    return __real_realloc(ptr, size);
+}
+
+}
+#endif
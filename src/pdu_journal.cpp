@@ -0,0 +1,341 @@
+/*
+ * PDU Fault Journal Implementation
+ *
+ * This file implements the flash fault journal. At boot the partition is
+ * scanned once: the first valid record of each sector gives the sector
+ * index, and the sector with the newest records is where writing resumes.
+ * The writer task owns all flash writes and erases; the loop task only
+ * touches the RAM queue, the tail cache and the sector index, all under
+ * a short critical section.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_journal.h"
+#include <esp_system.h>
+#include <esp_sleep.h>
+#include "pdu_logger.h"
+#include "pdu_no_string.h"
+
+static_assert(sizeof(JournalRecord) == 32, "journal records must stay 32 bytes");
+
+const esp_partition_t* PDUJournal::partition = nullptr;
+uint16_t PDUJournal::sectorCount = 0;
+uint32_t PDUJournal::sectorFirstSeq[JOURNAL_MAX_SECTORS];
+uint64_t PDUJournal::pendingErase = 0;
+uint16_t PDUJournal::writeSector = 0;
+uint16_t PDUJournal::writeSlot = 0;
+uint32_t PDUJournal::nextSeq = 1;
+uint32_t PDUJournal::bootFirstSeq = 1;
+uint32_t PDUJournal::bootCount = 0;
+uint32_t PDUJournal::eraseCount = 0;
+volatile bool PDUJournal::eraseAllowed = true;
+uint32_t PDUJournal::droppedCount = 0;
+JournalRecord PDUJournal::queue[JOURNAL_QUEUE_SIZE];
+volatile size_t PDUJournal::queueHead = 0;
+volatile size_t PDUJournal::queueTail = 0;
+JournalRecord PDUJournal::tail[JOURNAL_TAIL_CACHE];
+portMUX_TYPE PDUJournal::mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Parked mode wakes from deep sleep every PARK_WAKE_INTERVAL to check the battery; not worth a record each
+static bool isBootWorthRecording() {
+    return esp_reset_reason() != ESP_RST_DEEPSLEEP || esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER;
+}
+
+bool PDUJournal::begin() {
+    // begin() runs after the first relay decision; anything appended before it is only in
+    // the tail cache and is numbered again after the BOOT record once the partition is mounted
+    JournalRecord early[JOURNAL_TAIL_CACHE];
+    size_t earlyCount = 0;
+    for (uint32_t seq = nextSeq > JOURNAL_TAIL_CACHE ? nextSeq - JOURNAL_TAIL_CACHE : 1; seq < nextSeq; seq++) {
+        early[earlyCount++] = tail[seq % JOURNAL_TAIL_CACHE];
+    }
+    memset(tail, 0, sizeof(tail));
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, JOURNAL_PARTITION);
+    if (partition == nullptr || partition->size < 2 * JOURNAL_SECTOR_SIZE) {
+        partition = nullptr;
+        LOG_WARN("Fault journal: no '%s' partition, history is kept in RAM only", JOURNAL_PARTITION);
+        nextSeq = 1;
+        if (isBootWorthRecording()) append(JOURNAL_BOOT, esp_reset_reason());
+        for (size_t i = 0; i < earlyCount; i++) store(early[i]);
+        return false;
+    }
+
+    sectorCount = partition->size / JOURNAL_SECTOR_SIZE;
+    if (sectorCount > JOURNAL_MAX_SECTORS) sectorCount = JOURNAL_MAX_SECTORS;
+    mount();
+    xTaskCreate(writerTask, "pdu_journal", JOURNAL_TASK_STACK, nullptr, tskIDLE_PRIORITY + 1, nullptr);
+
+    if (isBootWorthRecording()) append(JOURNAL_BOOT, esp_reset_reason());
+    for (size_t i = 0; i < earlyCount; i++) store(early[i]);
+    LOG_INFO("Fault journal: boot %lu, %lu records kept, next seq %lu", (unsigned long)bootCount,
+             (unsigned long)(nextSeq - getOldestSeq()), (unsigned long)nextSeq);
+    return true;
+}
+
+void PDUJournal::mount() {
+    JournalRecord record;
+    int newest = -1;
+
+    for (uint16_t sector = 0; sector < sectorCount; sector++) {
+        sectorFirstSeq[sector] = EMPTY_SECTOR;
+        for (uint16_t slot = 0; slot < SLOTS_PER_SECTOR; slot++) {
+            if (readSlot(sector, slot, record)) {
+                sectorFirstSeq[sector] = record.seq;
+                break;
+            }
+            if (isErased(record)) break;  // Nothing was written after this slot
+        }
+        if (sectorFirstSeq[sector] != EMPTY_SECTOR &&
+            (newest < 0 || sectorFirstSeq[sector] > sectorFirstSeq[newest])) {
+            newest = sector;
+        }
+    }
+
+    if (newest < 0) {
+        // Blank (or foreign) partition: start over at sector 0
+        writeSector = 0;
+        writeSlot = 0;
+        nextSeq = 1;
+        bootCount = 1;
+        if (!isSectorErased(0)) pendingErase |= 1ULL;
+    } else {
+        // Resume after the last record of the newest sector; torn slots are skipped
+        writeSector = newest;
+        writeSlot = SLOTS_PER_SECTOR;
+        for (uint16_t slot = 0; slot < SLOTS_PER_SECTOR; slot++) {
+            if (readSlot(writeSector, slot, record)) {
+                nextSeq = record.seq + 1;
+                bootCount = record.bootCount + 1;
+            } else if (isErased(record)) {
+                writeSlot = slot;
+                break;
+            }
+        }
+    }
+    bootFirstSeq = nextSeq;
+
+    // The sector after the write position must be erased before it is needed
+    uint16_t spare = (writeSector + 1) % sectorCount;
+    if (sectorFirstSeq[spare] != EMPTY_SECTOR || !isSectorErased(spare)) {
+        sectorFirstSeq[spare] = EMPTY_SECTOR;
+        pendingErase |= 1ULL << spare;
+    }
+}
+
+uint32_t PDUJournal::append(JournalEventType type, int32_t value, int32_t value2) {
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timeMs = millis();
+    record.type = type;
+    record.value = value;
+    record.value2 = value2;
+    return store(record);
+}
+
+// Numbers the record and hands it to the writer; the time and values are kept as they are
+uint32_t PDUJournal::store(JournalRecord& record) {
+    portENTER_CRITICAL(&mux);
+    record.seq = nextSeq++;
+    record.bootCount = bootCount;
+    record.crc = crc32((const uint8_t*)&record, offsetof(JournalRecord, crc));
+    tail[record.seq % JOURNAL_TAIL_CACHE] = record;
+    if (partition != nullptr) {
+        if (queueHead - queueTail < JOURNAL_QUEUE_SIZE) {
+            queue[queueHead % JOURNAL_QUEUE_SIZE] = record;
+            queueHead = queueHead + 1;
+        } else {
+            droppedCount++;  // Writer is behind; the record is still in the tail cache
+        }
+    }
+    portEXIT_CRITICAL(&mux);
+    return record.seq;
+}
+
+uint32_t PDUJournal::getOldestSeq() {
+    uint32_t oldest = nextSeq > JOURNAL_TAIL_CACHE ? nextSeq - JOURNAL_TAIL_CACHE : 1;
+    if (oldest < bootFirstSeq) oldest = bootFirstSeq;
+
+    portENTER_CRITICAL(&mux);
+    for (uint16_t sector = 0; sector < sectorCount; sector++) {
+        if (sectorFirstSeq[sector] < oldest) oldest = sectorFirstSeq[sector];
+    }
+    portEXIT_CRITICAL(&mux);
+    return oldest;
+}
+
+uint32_t PDUJournal::getCapacity() {
+    // One sector is always kept erased for the next write
+    return partition != nullptr ? (sectorCount - 1) * SLOTS_PER_SECTOR : JOURNAL_TAIL_CACHE;
+}
+
+size_t PDUJournal::read(uint32_t since, JournalRecord* out, size_t maxRecords, uint32_t& next) {
+    uint32_t end = nextSeq;
+    uint32_t oldest = getOldestSeq();
+    if (since < oldest) since = oldest;
+    if (since > end) since = end;
+
+    // Sequence numbers lost to torn writes or a full queue are skipped
+    size_t count = 0;
+    uint32_t seq = since;
+    for (; seq != end && count < maxRecords; seq++) {
+        if (find(seq, out[count])) count++;
+    }
+    next = seq;
+    return count;
+}
+
+bool PDUJournal::find(uint32_t seq, JournalRecord& out) {
+    int sector = -1;
+    uint32_t firstSeq = 0;
+
+    portENTER_CRITICAL(&mux);
+    if (seq >= nextSeq) {
+        portEXIT_CRITICAL(&mux);
+        return false;
+    }
+    if (tail[seq % JOURNAL_TAIL_CACHE].seq == seq) {
+        out = tail[seq % JOURNAL_TAIL_CACHE];
+        portEXIT_CRITICAL(&mux);
+        return true;
+    }
+    for (uint16_t s = 0; s < sectorCount; s++) {
+        uint32_t first = sectorFirstSeq[s];
+        if (first != EMPTY_SECTOR && first <= seq && (sector < 0 || first > firstSeq)) {
+            sector = s;
+            firstSeq = first;
+        }
+    }
+    portEXIT_CRITICAL(&mux);
+    if (sector < 0) return false;
+
+    // Records are consecutive within a sector unless a write was torn
+    uint32_t slot = seq - firstSeq;
+    if (slot < SLOTS_PER_SECTOR && readSlot(sector, slot, out) && out.seq == seq) return true;
+    for (slot = 0; slot < SLOTS_PER_SECTOR; slot++) {
+        if (readSlot(sector, slot, out)) {
+            if (out.seq == seq) return true;
+        } else if (isErased(out)) {
+            break;
+        }
+    }
+    return false;
+}
+
+bool PDUJournal::readSlot(uint16_t sector, uint16_t slot, JournalRecord& record) {
+    uint32_t offset = sector * JOURNAL_SECTOR_SIZE + slot * RECORD_SIZE;
+    if (esp_partition_read(partition, offset, &record, RECORD_SIZE) != ESP_OK) {
+        memset(&record, 0, sizeof(record));
+        return false;
+    }
+    return record.crc == crc32((const uint8_t*)&record, offsetof(JournalRecord, crc));
+}
+
+bool PDUJournal::isErased(const JournalRecord& record) {
+    const uint8_t* bytes = (const uint8_t*)&record;
+    for (size_t i = 0; i < sizeof(record); i++) {
+        if (bytes[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+bool PDUJournal::isSectorErased(uint16_t sector) {
+    JournalRecord record;
+    for (uint16_t slot = 0; slot < SLOTS_PER_SECTOR; slot++) {
+        readSlot(sector, slot, record);
+        if (!isErased(record)) return false;
+    }
+    return true;
+}
+
+void PDUJournal::eraseSector(uint16_t sector) {
+    if (esp_partition_erase_range(partition, sector * JOURNAL_SECTOR_SIZE, JOURNAL_SECTOR_SIZE) != ESP_OK) {
+        LOG_ERROR("Fault journal: erase of sector %u failed", sector);
+        return;
+    }
+    portENTER_CRITICAL(&mux);
+    pendingErase &= ~(1ULL << sector);
+    eraseCount++;
+    portEXIT_CRITICAL(&mux);
+}
+
+bool PDUJournal::writeRecord(JournalRecord& record) {
+    if (writeSlot >= SLOTS_PER_SECTOR) {
+        // Move into the spare sector; the oldest sector becomes the new spare
+        uint16_t next = (writeSector + 1) % sectorCount;
+        uint16_t spare = (next + 1) % sectorCount;
+        if (pendingErase & (1ULL << next)) eraseSector(next);
+
+        portENTER_CRITICAL(&mux);
+        writeSector = next;
+        writeSlot = 0;
+        sectorFirstSeq[next] = EMPTY_SECTOR;
+        sectorFirstSeq[spare] = EMPTY_SECTOR;
+        pendingErase |= 1ULL << spare;
+        portEXIT_CRITICAL(&mux);
+    }
+    if (pendingErase & (1ULL << writeSector)) eraseSector(writeSector);
+
+    // Verify by reading back: a slot that was not cleanly erased is skipped
+    uint32_t offset = writeSector * JOURNAL_SECTOR_SIZE + writeSlot * RECORD_SIZE;
+    JournalRecord check;
+    bool written = esp_partition_write(partition, offset, &record, RECORD_SIZE) == ESP_OK &&
+                   readSlot(writeSector, writeSlot, check) && memcmp(&check, &record, RECORD_SIZE) == 0;
+
+    portENTER_CRITICAL(&mux);
+    if (written && sectorFirstSeq[writeSector] == EMPTY_SECTOR) sectorFirstSeq[writeSector] = record.seq;
+    writeSlot++;
+    portEXIT_CRITICAL(&mux);
+    return written;
+}
+
+void PDUJournal::writerTask(void* param) {
+    for (;;) {
+        // Only this task advances queueTail, so the slot is stable while it is written
+        while (queueTail != queueHead) {
+            JournalRecord& record = queue[queueTail % JOURNAL_QUEUE_SIZE];
+            if (!writeRecord(record) && !writeRecord(record)) {
+                LOG_ERROR("Fault journal: record %lu could not be written", (unsigned long)record.seq);
+            }
+            portENTER_CRITICAL(&mux);
+            queueTail = queueTail + 1;
+            portEXIT_CRITICAL(&mux);
+        }
+
+        // Erase ahead of need while nothing is waiting and an erase stall is harmless
+        for (uint16_t sector = 0; sector < sectorCount && queueTail == queueHead && eraseAllowed; sector++) {
+            if (pendingErase & (1ULL << sector)) eraseSector(sector);
+        }
+        vTaskDelay(pdMS_TO_TICKS(JOURNAL_POLL_INTERVAL));
+    }
+}
+
+uint32_t PDUJournal::crc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+const char* PDUJournal::getTypeName(uint8_t type) {
+    switch (type) {
+        case JOURNAL_BOOT: return "BOOT";
+        case JOURNAL_VP_TRIP: return "VP_TRIP";
+        case JOURNAL_VP_RETRY: return "VP_RETRY";
+        case JOURNAL_VP_LOCKOUT: return "VP_LOCKOUT";
+        case JOURNAL_VP_UNLOCK: return "VP_UNLOCK";
+        case JOURNAL_THERMAL_TRIP: return "THERMAL_TRIP";
+        case JOURNAL_IGN_TIMEOUT: return "IGN_TIMEOUT";
+        case JOURNAL_RULES_TRIP: return "RULES_TRIP";
+        case JOURNAL_PARK: return "PARK";
+        case JOURNAL_PARK_WAKE: return "PARK_WAKE";
+        case JOURNAL_PARK_LOW_BATTERY: return "PARK_LOW_BATTERY";
+        default: return "UNKNOWN";
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * PDU Logger Implementation
+ *
+ * This file implements the buffered logger. Callers format a message on
+ * their own stack and copy it into the ring buffer inside a short critical
+ * section; a low-priority task drains the buffer to the UART so that slow
+ * serial output never delays relay or fault decisions.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_logger.h"
+#include "pdu_no_string.h"
+
+char PDULogger::buffer[LOG_BUFFER_SIZE];
+volatile size_t PDULogger::head = 0;
+volatile size_t PDULogger::tail = 0;
+volatile uint32_t PDULogger::droppedCount = 0;
+portMUX_TYPE PDULogger::bufferMux = portMUX_INITIALIZER_UNLOCKED;
+
+void PDULogger::begin() {
+    xTaskCreate(drainTask, "pdu_log", LOG_TASK_STACK, nullptr, tskIDLE_PRIORITY + 1, nullptr);
+}
+
+void PDULogger::log(const char* format, ...) {
+    char line[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line) - 2, format, args);
+    va_end(args);
+
+    if (length < 0) return;
+    if (length > (int)sizeof(line) - 3) length = sizeof(line) - 3;
+    line[length++] = '\r';
+    line[length++] = '\n';
+    write(line, length);
+}
+
+uint32_t PDULogger::getDroppedCount() {
+    return droppedCount;
+}
+
+void PDULogger::write(const char* data, size_t length) {
+    portENTER_CRITICAL(&bufferMux);
+    size_t used = (head + LOG_BUFFER_SIZE - tail) % LOG_BUFFER_SIZE;
+    if (length > LOG_BUFFER_SIZE - 1 - used) {
+        // Never wait for the drain task: drop the whole message instead
+        droppedCount++;
+        portEXIT_CRITICAL(&bufferMux);
+        return;
+    }
+
+    size_t first = LOG_BUFFER_SIZE - head;
+    if (first > length) first = length;
+    memcpy(&buffer[head], data, first);
+    memcpy(&buffer[0], data + first, length - first);
+    head = (head + length) % LOG_BUFFER_SIZE;
+    portEXIT_CRITICAL(&bufferMux);
+}
+
+void PDULogger::drainTask(void* param) {
+    uint32_t reportedDrops = 0;
+
+    for (;;) {
+        size_t end = head;
+        size_t start = tail;
+
+        if (start == end) {
+            uint32_t drops = droppedCount;
+            if (drops != reportedDrops) {
+                Serial.printf("Log: %lu messages dropped\r\n", (unsigned long)(drops - reportedDrops));
+                reportedDrops = drops;
+            }
+            vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL));
+            continue;
+        }
+
+        // Producers only ever write past head, so [tail, head) is stable here
+        size_t chunk = (end > start) ? end - start : LOG_BUFFER_SIZE - start;
+        Serial.write((const uint8_t*)&buffer[start], chunk);
+
+        portENTER_CRITICAL(&bufferMux);
+        tail = (start + chunk) % LOG_BUFFER_SIZE;
+        portEXIT_CRITICAL(&bufferMux);
+    }
+}
@@ -0,0 +1,149 @@
+/*
+ * PDU Microbenchmark Implementation
+ *
+ * This file implements the benchmark suite. Each case is warmed up, run
+ * once over a painted stack region to find its depth, calibrated so a
+ * batch takes about BENCH_MIN_TIME / BENCH_REPEATS, then timed in
+ * BENCH_REPEATS batches. Serial replies go to a null sink so the UART does
+ * not dominate the serial cases.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_microbench.h"
+
+#if PDU_MICROBENCH
+
+#include "pdu_controller.h"
+#include "pdu_web_server.h"
+#include "pdu_heap.h"
+#include "pdu_telemetry.h"
+#include "SerialCommandHandler.h"
+#include "pdu_no_string.h"
+
+static const uint32_t STACK_PAINT = 0xA5A5A5A5;
+
+class NullPrint : public Print {
+public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t size) override { return size; }
+};
+
+static NullPrint nullOutput;
+
+PDUController* PDUMicrobench::pdu = nullptr;
+PDUWebServer* PDUMicrobench::web = nullptr;
+
+const PDUMicrobench::Case PDUMicrobench::cases[CASE_COUNT] = {
+    { "update", opUpdate },
+    { "status_json", opStatusJson },
+    { "serial_get", opSerialGet },
+    { "serial_set", opSerialSet },
+    { "set_channel", opSetChannel },
+    { "telemetry", opTelemetrySample },
+};
+
+void PDUMicrobench::opUpdate() {
+    pdu->update();
+}
+
+void PDUMicrobench::opStatusJson() {
+    web->createJsonResponse(0xFFFFFFFF);
+}
+
+void PDUMicrobench::opSerialGet() {
+    SerialCommandHandler::handleCommand("GET_TEMP", *pdu);
+}
+
+void PDUMicrobench::opSerialSet() {
+    // Queue, coalesce, apply and reply, as one tick would for a single command
+    SerialCommandHandler::handleCommand("SET_CH4:0", *pdu);
+    pdu->processCommands();
+}
+
+void PDUMicrobench::opSetChannel() {
+    pdu->setChannel(4, true);
+}
+
+void PDUMicrobench::opTelemetrySample() {
+    // Encoding and spooling one sample (the spool drops the oldest batches once full)
+    static unsigned long time = 0;
+    time += TELEMETRY_SAMPLE_INTERVAL;
+    PDUTelemetry::takeSample(time);
+}
+
+size_t PDUMicrobench::run(PDUController& controller, PDUWebServer& server, BenchResult* results,
+                          uint32_t minTimeMs) {
+    pdu = &controller;
+    web = &server;
+    SerialCommandHandler::setOutput(nullOutput);
+    for (size_t i = 0; i < CASE_COUNT; i++) measure(cases[i], minTimeMs, results[i]);
+    SerialCommandHandler::setOutput(Serial);
+    return CASE_COUNT;
+}
+
+uint32_t PDUMicrobench::timeBatch(void (*op)(), uint32_t iterations) {
+    uint32_t start = ESP.getCycleCount();
+    for (uint32_t i = 0; i < iterations; i++) op();
+    return ESP.getCycleCount() - start;
+}
+
+// Paints the stack below this frame, runs the case once and finds the deepest overwritten word.
+// Not inlined, so every case starts from the same stack depth.
+uint32_t __attribute__((noinline)) PDUMicrobench::measureStack(void (*op)()) {
+    uint32_t probe = BENCH_STACK_PROBE;
+    UBaseType_t freeStack = uxTaskGetStackHighWaterMark(nullptr);  // 0 where unknown (host)
+    if (freeStack > 0 && freeStack < probe + 2 * BENCH_STACK_GUARD) {
+        probe = freeStack > 3 * BENCH_STACK_GUARD ? freeStack - 2 * BENCH_STACK_GUARD : 0;
+    }
+
+    volatile uint32_t marker = 0;
+    uintptr_t base = (uintptr_t)&marker;
+    volatile uint32_t* top = (volatile uint32_t*)((base - BENCH_STACK_GUARD) & ~(uintptr_t)3);
+    volatile uint32_t* bottom = top - probe / 4;
+    for (volatile uint32_t* p = bottom; p < top; p++) *p = STACK_PAINT;
+
+    op();
+
+    volatile uint32_t* p = bottom;
+    while (p < top && *p == STACK_PAINT) p++;
+    return (uint32_t)(base - (uintptr_t)p);
+}
+
+void PDUMicrobench::measure(const Case& benchCase, uint32_t minTimeMs, BenchResult& result) {
+    for (int i = 0; i < 3; i++) benchCase.op();
+    result.name = benchCase.name;
+    result.stackBytes = measureStack(benchCase.op);
+
+    // Grow the batch until it is long enough to scale from, then size it for the target time
+    uint32_t mhz = getCpuFrequencyMhz();
+    uint64_t targetCycles = (uint64_t)minTimeMs * 1000 * mhz / BENCH_REPEATS;
+    uint32_t iterations = 1;
+    uint32_t cycles = timeBatch(benchCase.op, iterations);
+    while (cycles < targetCycles / 8 && iterations < (1UL << 24)) {
+        iterations *= 2;
+        cycles = timeBatch(benchCase.op, iterations);
+    }
+    if (cycles > 0) {
+        uint64_t scaled = targetCycles * iterations / cycles;
+        iterations = scaled < 1 ? 1 : scaled > (1UL << 24) ? (1UL << 24) : (uint32_t)scaled;
+    }
+
+    // The fastest batch is reported: other tasks can only make a batch slower
+    float best = 0;
+    uint32_t allocStart = PDUHeap::getAllocCount();
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+        float nsPerOp = timeBatch(benchCase.op, iterations) * 1000.0f / mhz / iterations;
+        if (repeat == 0 || nsPerOp < best) best = nsPerOp;
+    }
+    uint32_t allocs = PDUHeap::getAllocCount() - allocStart;
+
+    result.iterations = iterations;
+    result.nsPerOp = best;
+    result.allocsPerOp = (float)allocs / ((float)iterations * BENCH_REPEATS);
+}
+
+#endif // PDU_MICROBENCH
@@ -0,0 +1,387 @@
+/*
+ * PDU Modbus TCP Server Implementation
+ *
+ * This file implements the Modbus TCP server task. Each connection keeps
+ * its received bytes in a frame buffer; complete requests are answered in
+ * order, so clients may pipeline several requests. Connections that close
+ * or stay silent for MODBUS_IDLE_TIMEOUT free their slot.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_modbus.h"
+#include "pdu_boot.h"
+#include "pdu_logger.h"
+#include "pdu_trace.h"
+#include "pdu_command_queue.h"
+#include "pdu_no_string.h"
+
+static const uint16_t MAX_READ_BITS = 2000;
+static const uint16_t MAX_READ_REGISTERS = 125;
+static const uint16_t MAX_WRITE_COILS = 1968;
+static const uint16_t MAX_WRITE_REGISTERS = 123;
+
+static uint16_t getWord(const uint8_t* data) {
+    return (uint16_t)(data[0] << 8 | data[1]);
+}
+
+static void putWord(uint8_t* data, uint16_t value) {
+    data[0] = value >> 8;
+    data[1] = value & 0xFF;
+}
+
+// Hundredths in a signed register, saturated rather than wrapped
+static uint16_t toHundredths(float value) {
+    long scaled = lroundf(value * 100);
+    if (scaled > INT16_MAX) scaled = INT16_MAX;
+    if (scaled < INT16_MIN) scaled = INT16_MIN;
+    return (uint16_t)(int16_t)scaled;
+}
+
+// Runs on the controller task, so Modbus writes reach the trace in serial syntax
+// without this task touching the trace buffer
+static void traceWrite(const PDUCommand& command, CommandStatus status, void* context) {
+    if (status != CMD_APPLIED) return;     // Superseded or rejected writes changed nothing
+
+    char text[32];
+    switch (command.type) {
+        case CMD_SET_CHANNEL:
+            snprintf(text, sizeof(text), "SET_CH%d:%d", command.channel, command.state ? 0 : 1);
+            break;
+        case CMD_SET_RELAY_FLAG:
+            snprintf(text, sizeof(text), "SET_RELAY:%d", command.state ? 1 : 0);
+            break;
+        case CMD_SET_TEMP_THRESHOLD:
+            snprintf(text, sizeof(text), "SET_TSTemp:%.2f", command.temperature);
+            break;
+        case CMD_SET_TIME_THRESHOLD:
+            snprintf(text, sizeof(text), "SET_TSTime:%.6g", command.timeMs / 60000.0);
+            break;
+        case CMD_CLEAR_VP_LOCK:
+            snprintf(text, sizeof(text), "SET_VPLOCK:0");
+            break;
+        default:
+            return;
+    }
+    PDUTrace::recordCommand(text);
+}
+
+PDUModbusServer::PDUModbusServer(PDUController& pduController)
+    : server(MODBUS_PORT, MODBUS_MAX_CLIENTS)
+    , pdu(pduController)
+{
+    for (int i = 0; i < MODBUS_MAX_CLIENTS; i++) {
+        connections[i].active = false;
+        connections[i].length = 0;
+        connections[i].lastActivity = 0;
+    }
+}
+
+void PDUModbusServer::begin() {
+    xTaskCreate(serverTask, "pdu_modbus", MODBUS_TASK_STACK, this, tskIDLE_PRIORITY + 1, nullptr);
+}
+
+void PDUModbusServer::serverTask(void* param) {
+    static_cast<PDUModbusServer*>(param)->run();
+}
+
+void PDUModbusServer::run() {
+    // The access point is brought up by the web server's start-up task
+    while (PDUBoot::getPhaseTime(BOOT_WIFI_READY) == 0) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    server.begin();
+    server.setNoDelay(true);
+    LOG_INFO("Modbus TCP server started on port %d", MODBUS_PORT);
+
+    for (;;) {
+        acceptClients();
+        bool busy = false;
+        for (int i = 0; i < MODBUS_MAX_CLIENTS; i++) {
+            if (serviceConnection(connections[i])) busy = true;
+        }
+        if (!busy) vTaskDelay(pdMS_TO_TICKS(MODBUS_POLL_INTERVAL));
+    }
+}
+
+void PDUModbusServer::acceptClients() {
+    while (server.hasClient()) {
+        WiFiClient client = server.available();
+        Connection* slot = findFreeSlot();
+        if (slot == nullptr) {
+            client.stop();
+            LOG_WARN("Modbus: connection refused, %d clients already connected", MODBUS_MAX_CLIENTS);
+            continue;
+        }
+
+        slot->client = client;
+        slot->client.setNoDelay(true);
+        slot->active = true;
+        slot->length = 0;
+        slot->lastActivity = millis();
+        LOG_INFO("Modbus: client connected from %s", slot->client.remoteIP().toString().c_str());
+    }
+}
+
+PDUModbusServer::Connection* PDUModbusServer::findFreeSlot() {
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < MODBUS_MAX_CLIENTS; i++) {
+            if (!connections[i].active) return &connections[i];
+        }
+        // All taken: free slots whose peer has gone but that have not been serviced since
+        for (int i = 0; i < MODBUS_MAX_CLIENTS; i++) {
+            if (!connections[i].client.connected()) closeConnection(connections[i]);
+        }
+    }
+    return nullptr;
+}
+
+void PDUModbusServer::closeConnection(Connection& connection) {
+    connection.client.stop();
+    connection.active = false;
+    connection.length = 0;
+}
+
+bool PDUModbusServer::serviceConnection(Connection& connection) {
+    if (!connection.active) return false;
+
+    unsigned long now = millis();
+    int available = connection.client.available();
+    if (available <= 0) {
+        if (!connection.client.connected()) {
+            closeConnection(connection);
+        } else if (now - connection.lastActivity > MODBUS_IDLE_TIMEOUT) {
+            LOG_INFO("Modbus: closing idle connection");
+            closeConnection(connection);
+        }
+        return false;
+    }
+
+    size_t space = MODBUS_ADU_MAX - connection.length;
+    int received = connection.client.read(connection.frame + connection.length,
+                                          (size_t)available < space ? (size_t)available : space);
+    if (received <= 0) return false;
+    connection.length += received;
+    connection.lastActivity = now;
+
+    bool handled = false;
+    while (connection.length >= MODBUS_MBAP_SIZE) {
+        const uint8_t* frame = connection.frame;
+        uint16_t protocol = getWord(frame + 2);
+        uint16_t lengthField = getWord(frame + 4);  // Unit id + PDU
+        if (protocol != 0 || lengthField < 2 || lengthField > MODBUS_ADU_MAX - 6) {
+            // Not Modbus, or out of step with the stream: there is no way to resynchronize
+            LOG_WARN("Modbus: malformed frame header, closing connection");
+            closeConnection(connection);
+            return handled;
+        }
+
+        size_t frameLength = 6 + lengthField;
+        if (connection.length < frameLength) break;
+
+        size_t replyLength = handleRequest(frame + MODBUS_MBAP_SIZE, lengthField - 1, response + MODBUS_MBAP_SIZE);
+        memcpy(response, frame, 4);                 // Transaction and protocol id
+        putWord(response + 4, replyLength + 1);
+        response[6] = frame[6];                     // Unit id
+        connection.client.write(response, MODBUS_MBAP_SIZE + replyLength);
+
+        connection.length -= frameLength;
+        memmove(connection.frame, connection.frame + frameLength, connection.length);
+        handled = true;
+    }
+    return handled;
+}
+
+size_t PDUModbusServer::handleRequest(const uint8_t* request, size_t length, uint8_t* reply) {
+    uint8_t function = request[0];
+    size_t replyLength = 0;
+    ModbusException exception = MB_EX_NONE;
+
+    switch (function) {
+        case 0x01:  // Read coils
+        case 0x02:  // Read discrete inputs
+        case 0x03:  // Read holding registers
+        case 0x04:  // Read input registers
+            if (length != 5) {
+                exception = MB_EX_ILLEGAL_VALUE;
+            } else if (function <= 0x02) {
+                exception = readBits(function, getWord(request + 1), getWord(request + 3), reply, replyLength);
+            } else {
+                exception = readRegisters(function, getWord(request + 1), getWord(request + 3), reply, replyLength);
+            }
+            break;
+
+        case 0x05: {  // Write single coil: 0xFF00 = ON, 0x0000 = OFF
+            uint16_t value = length == 5 ? getWord(request + 3) : 0;
+            if (length != 5 || (value != 0xFF00 && value != 0x0000)) {
+                exception = MB_EX_ILLEGAL_VALUE;
+                break;
+            }
+            uint8_t bit = value ? 1 : 0;
+            exception = writeCoils(getWord(request + 1), 1, &bit);
+            replyLength = 5;
+            break;
+        }
+
+        case 0x06:  // Write single register
+            if (length != 5) {
+                exception = MB_EX_ILLEGAL_VALUE;
+                break;
+            }
+            exception = writeRegisters(getWord(request + 1), 1, request + 3);
+            replyLength = 5;
+            break;
+
+        case 0x0F:    // Write multiple coils
+        case 0x10: {  // Write multiple registers
+            uint16_t count = length >= 6 ? getWord(request + 3) : 0;
+            uint16_t maxCount = function == 0x0F ? MAX_WRITE_COILS : MAX_WRITE_REGISTERS;
+            size_t byteCount = function == 0x0F ? (count + 7) / 8 : count * 2;
+            if (count < 1 || count > maxCount || request[5] != byteCount || length != 6 + byteCount) {
+                exception = MB_EX_ILLEGAL_VALUE;
+                break;
+            }
+            exception = function == 0x0F ? writeCoils(getWord(request + 1), count, request + 6)
+                                         : writeRegisters(getWord(request + 1), count, request + 6);
+            replyLength = 5;
+            break;
+        }
+
+        default:
+            exception = MB_EX_ILLEGAL_FUNCTION;
+            break;
+    }
+
+    if (exception != MB_EX_NONE) {
+        reply[0] = function | 0x80;
+        reply[1] = exception;
+        return 2;
+    }
+
+    // Write replies echo the function, start address and value or count
+    if (function >= 0x05) memcpy(reply, request, replyLength);
+    return replyLength;
+}
+
+ModbusException PDUModbusServer::readBits(uint8_t function, uint16_t start, uint16_t count,
+                                          uint8_t* reply, size_t& replyLength) {
+    uint16_t limit = function == 0x01 ? (uint16_t)MB_COIL_COUNT : (uint16_t)MB_INPUT_COUNT;
+    if (count < 1 || count > MAX_READ_BITS) return MB_EX_ILLEGAL_VALUE;
+    if ((uint32_t)start + count > limit) return MB_EX_ILLEGAL_ADDRESS;
+
+    PDUStatus status;
+    uint32_t version;
+    pdu.readStatus(status, version);
+
+    uint8_t byteCount = (count + 7) / 8;
+    reply[0] = function;
+    reply[1] = byteCount;
+    memset(reply + 2, 0, byteCount);
+    for (uint16_t i = 0; i < count; i++) {
+        if (getBit(status, function, start + i)) reply[2 + i / 8] |= 1 << (i % 8);
+    }
+    replyLength = 2 + byteCount;
+    return MB_EX_NONE;
+}
+
+ModbusException PDUModbusServer::readRegisters(uint8_t function, uint16_t start, uint16_t count,
+                                               uint8_t* reply, size_t& replyLength) {
+    uint16_t limit = function == 0x03 ? (uint16_t)MB_HREG_COUNT : (uint16_t)MB_IREG_COUNT;
+    if (count < 1 || count > MAX_READ_REGISTERS) return MB_EX_ILLEGAL_VALUE;
+    if ((uint32_t)start + count > limit) return MB_EX_ILLEGAL_ADDRESS;
+
+    PDUStatus status;
+    uint32_t version;
+    pdu.readStatus(status, version);
+
+    reply[0] = function;
+    reply[1] = count * 2;
+    for (uint16_t i = 0; i < count; i++) {
+        putWord(reply + 2 + i * 2, getRegister(status, version, function, start + i));
+    }
+    replyLength = 2 + count * 2;
+    return MB_EX_NONE;
+}
+
+bool PDUModbusServer::getBit(const PDUStatus& status, uint8_t function, uint16_t address) {
+    if (function == 0x01) {
+        if (address < MB_COIL_RELAY) return status.channels[address - MB_COIL_CH1];
+        return address == MB_COIL_RELAY ? status.relay : status.vpLocked;
+    }
+    if (address < MB_INPUT_IGN) return status.fuses[address - MB_INPUT_F1];
+    return status.ign;
+}
+
+uint16_t PDUModbusServer::getRegister(const PDUStatus& status, uint32_t version, uint8_t function,
+                                      uint16_t address) {
+    if (function == 0x03) {
+        if (address == MB_HREG_TEMP_THRESHOLD) return toHundredths(status.tempThreshold);
+        uint32_t seconds = status.timeThreshold / 1000;
+        return seconds > 0xFFFF ? 0xFFFF : seconds;
+    }
+
+    switch (address) {
+        case MB_IREG_TEMP:
+            return toHundredths(status.temp);
+        case MB_IREG_BATTERY:
+            return (uint16_t)lroundf(status.battery * 100);
+        default: {
+            // 32-bit values, high word first
+            const uint32_t values[] = { status.vpTrips, status.vpTripLatencyUs, status.vpTripMaxLatencyUs, version };
+            uint16_t offset = address - MB_IREG_VP_TRIPS;
+            uint32_t value = values[offset / 2];
+            return offset % 2 == 0 ? value >> 16 : value & 0xFFFF;
+        }
+    }
+}
+
+ModbusException PDUModbusServer::writeCoils(uint16_t start, uint16_t count, const uint8_t* values) {
+    if ((uint32_t)start + count > MB_COIL_COUNT) return MB_EX_ILLEGAL_ADDRESS;
+
+    // Validate the whole request before queueing any of it
+    for (uint16_t i = 0; i < count; i++) {
+        bool on = (values[i / 8] >> (i % 8)) & 1;
+        if (start + i == MB_COIL_VP_LOCK && on) return MB_EX_ILLEGAL_VALUE;
+    }
+
+    PDUCommand commands[MB_COIL_COUNT];
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t address = start + i;
+        bool on = (values[i / 8] >> (i % 8)) & 1;
+        PDUCommand& command = commands[i];
+        if (address < MB_COIL_RELAY) {
+            command = PDUCommandQueue::makeCommand(CMD_SET_CHANNEL, traceWrite);
+            command.channel = address - MB_COIL_CH1 + 1;
+            command.state = on;
+        } else if (address == MB_COIL_RELAY) {
+            command = PDUCommandQueue::makeCommand(CMD_SET_RELAY_FLAG, traceWrite);
+            command.state = on;
+        } else {
+            command = PDUCommandQueue::makeCommand(CMD_CLEAR_VP_LOCK, traceWrite);
+        }
+    }
+
+    // All or nothing: a busy reply must not hide a write that was partly queued
+    return PDUCommandQueue::submitAll(commands, count) != 0 ? MB_EX_NONE : MB_EX_BUSY;
+}
+
+ModbusException PDUModbusServer::writeRegisters(uint16_t start, uint16_t count, const uint8_t* values) {
+    if ((uint32_t)start + count > MB_HREG_COUNT) return MB_EX_ILLEGAL_ADDRESS;
+
+    PDUCommand commands[MB_HREG_COUNT];
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t value = getWord(values + i * 2);
+        PDUCommand& command = commands[i];
+        if (start + i == MB_HREG_TEMP_THRESHOLD) {
+            command = PDUCommandQueue::makeCommand(CMD_SET_TEMP_THRESHOLD, traceWrite);
+            command.temperature = (int16_t)value / 100.0f;
+        } else {
+            command = PDUCommandQueue::makeCommand(CMD_SET_TIME_THRESHOLD, traceWrite);
+            command.timeMs = value * 1000UL;
+        }
+    }
+    return PDUCommandQueue::submitAll(commands, count) != 0 ? MB_EX_NONE : MB_EX_BUSY;
+}
@@ -0,0 +1,184 @@
+/*
+ * PDU Parked Mode Implementation
+ *
+ * This file implements parked mode: the decision to sleep, the wake-up
+ * sources, the battery check on timer wake-ups and the statistics. Wake-up
+ * from deep sleep is a reboot; begin() picks it up before the first relay
+ * decision, with the controller already restored from RTC memory.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_park.h"
+#include <esp_system.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <driver/rtc_io.h>
+#include <sys/time.h>
+#include "pdu_logger.h"
+#include "pdu_journal.h"
+#include "pdu_trace.h"
+#include "pdu_no_string.h"
+
+RTC_DATA_ATTR ParkStats PDUParkMode::stats;
+RTC_DATA_ATTR int64_t PDUParkMode::sleepStartUs = 0;
+RTC_DATA_ATTR int64_t PDUParkMode::parkStartUs = 0;
+RTC_DATA_ATTR bool PDUParkMode::lowBatteryReported = false;
+
+PDUParkMode::PDUParkMode(PDUController& pduController, PDUWebServer& webServer)
+    : pdu(pduController)
+    , web(webServer)
+    , resting(false)
+    , idle(false)
+    , idleSince(0)
+    , awaitingRelay(false)
+    , wakeUs(0)
+{
+}
+
+bool PDUParkMode::usesDeepSleep() {
+    return rtc_gpio_is_valid_gpio((gpio_num_t)PARK_WAKE_PIN);
+}
+
+// System time keeps running through deep sleep, unlike micros()
+int64_t PDUParkMode::clockMicros() {
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+void PDUParkMode::holdOutputs(bool hold) {
+    static const uint8_t OUTPUT_PINS[] = { CH1_PIN, CH2_PIN, CH3_PIN, CH4_PIN, RELAY_PIN };
+    for (uint8_t pin : OUTPUT_PINS) {
+        if (hold) gpio_hold_en((gpio_num_t)pin);
+        else gpio_hold_dis((gpio_num_t)pin);
+    }
+    if (hold) gpio_deep_sleep_hold_en();
+    else gpio_deep_sleep_hold_dis();
+}
+
+void PDUParkMode::begin() {
+    // Only a wake-up from our own deep sleep; any other reset starts unparked
+    if (esp_reset_reason() != ESP_RST_DEEPSLEEP || sleepStartUs == 0) return;
+
+    // initPins() has driven the same OFF levels the pads were held at
+    holdOutputs(false);
+    wake(esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER, 0);
+}
+
+void PDUParkMode::update() {
+    if (awaitingRelay && pdu.getRelayState()) recordWakeToRelay(pdu.getRelayOnTime() - wakeUs);
+
+    bool parked = pdu.getParkEnabled() && !pdu.getRelayState() && digitalRead(IGN_PIN) == LOW;
+    if (!parked) {
+        idle = false;
+        if (resting) resume();
+        return;
+    }
+
+    // Woken up for a battery check: straight back to sleep while IGN stays LOW
+    if (resting) {
+        checkBattery();
+        sleep();
+        return;
+    }
+
+    if (!idle) {
+        idle = true;
+        idleSince = millis();
+        return;
+    }
+
+    // Stay up while someone is connected to the access point or a trace is recorded
+    if (millis() - idleSince < PARK_DELAY || WiFi.softAPgetStationNum() > 0 || PDUTrace::isRecording()) return;
+    sleep();
+}
+
+void PDUParkMode::sleep() {
+    bool deep = usesDeepSleep();
+    if (resting) {
+        stats.awakeUs += micros() - wakeUs;
+    } else {
+        stats.parks++;
+        parkStartUs = clockMicros();
+        lowBatteryReported = false;
+        stats.battery = pdu.sampleBattery();
+        LOG_INFO("Parked: %s sleep until IGN, battery %.2f V", deep ? "deep" : "light", stats.battery);
+        PDUJournal::append(JOURNAL_PARK, deep ? 1 : 0, lroundf(stats.battery * 100));
+        web.suspend();
+    }
+    awaitingRelay = false;
+
+    // A record or sector erase cut short by deep sleep would be lost
+    unsigned long flushStart = millis();
+    while (!PDUJournal::isFlushed() && millis() - flushStart < PARK_FLUSH_TIMEOUT) delay(10);
+
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+    uint32_t interval = pdu.getParkWakeInterval();
+    if (interval > 0) esp_sleep_enable_timer_wakeup((uint64_t)interval * 1000);
+    Serial.flush();
+    sleepStartUs = clockMicros();
+
+    if (deep) {
+        // The pads would float while the chip is off; CH1-CH4 are active LOW
+        esp_sleep_enable_ext0_wakeup((gpio_num_t)PARK_WAKE_PIN, HIGH);
+        holdOutputs(true);
+        esp_deep_sleep_start();     // Resumes in begin() after the reboot
+    }
+
+    gpio_wakeup_enable((gpio_num_t)PARK_WAKE_PIN, GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    esp_light_sleep_start();
+    gpio_wakeup_disable((gpio_num_t)PARK_WAKE_PIN);
+    wake(esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER, micros());
+}
+
+void PDUParkMode::wake(bool byTimer, uint32_t wakeMicros) {
+    stats.sleepUs += clockMicros() - sleepStartUs;
+    resting = true;
+    idle = false;
+    wakeUs = wakeMicros;
+    if (byTimer) {
+        stats.timerWakes++;
+    } else {
+        stats.ignWakes++;
+        awaitingRelay = true;
+    }
+}
+
+void PDUParkMode::resume() {
+    // The relay decision has been taken by now; the radio can take its time
+    resting = false;
+    web.beginAsync();
+    LOG_INFO("Leaving parked mode");
+}
+
+void PDUParkMode::checkBattery() {
+    stats.battery = pdu.sampleBattery();
+    if (stats.battery >= PARK_LOW_BATTERY || lowBatteryReported) return;
+
+    lowBatteryReported = true;
+    LOG_WARN("Parked: battery low (%.2f V)", stats.battery);
+    PDUJournal::append(JOURNAL_PARK_LOW_BATTERY, lroundf(stats.battery * 100), lroundf(PARK_LOW_BATTERY * 100));
+}
+
+void PDUParkMode::recordWakeToRelay(uint32_t latencyUs) {
+    awaitingRelay = false;
+    stats.lastWakeToRelayUs = latencyUs;
+    if (latencyUs > stats.maxWakeToRelayUs) stats.maxWakeToRelayUs = latencyUs;
+
+    uint32_t parkedS = (clockMicros() - parkStartUs) / 1000000;
+    LOG_INFO("Relay ON %lu us after the IGN wake-up (parked %lu s)", (unsigned long)latencyUs,
+             (unsigned long)parkedS);
+    PDUJournal::append(JOURNAL_PARK_WAKE, latencyUs, parkedS);
+}
+
+uint32_t PDUParkMode::getEstimatedCurrent() {
+    uint64_t total = stats.sleepUs + stats.awakeUs;
+    if (total == 0) return 0;
+    double sleepCurrent = usesDeepSleep() ? PARK_DEEP_CURRENT : PARK_LIGHT_CURRENT;
+    return (stats.sleepUs * sleepCurrent + stats.awakeUs * (double)PARK_AWAKE_CURRENT) / total;
+}
@@ -0,0 +1,387 @@
+/*
+ * PDU Rules Engine Implementation
+ *
+ * This file implements the rule compiler and the bytecode evaluator. The
+ * compiler is a recursive-descent parser that emits stack-machine code into
+ * a scratch program, which only replaces the running program once the whole
+ * source has compiled. The evaluator walks the code exactly once per tick.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_rules.h"
+#include <ctype.h>
+#include "pdu_no_string.h"
+
+static const char* const VARIABLE_NAMES[RULE_VAR_COUNT] = {
+    "temp", "bat", "ign", "vp",
+    "f1", "f2", "f3", "f4",
+    "ch1", "ch2", "ch3", "ch4",
+    "relay", "tempThreshold", "timeThreshold"
+};
+
+PDURulesEngine::PDURulesEngine()
+    : lastEvalUs(0)
+    , maxEvalUs(0)
+{
+    clear();
+}
+
+void PDURulesEngine::clear() {
+    memset(&program, 0, sizeof(program));
+    memset(&state, 0, sizeof(state));
+    source[0] = '\0';
+    lastEvalUs = 0;
+    maxEvalUs = 0;
+}
+
+bool PDURulesEngine::compile(const char* text, char* error, size_t errorSize) {
+    if (strlen(text) >= RULES_MAX_SOURCE) {
+        snprintf(error, errorSize, "program longer than %d bytes", RULES_MAX_SOURCE - 1);
+        return false;
+    }
+
+    memset(&scratch, 0, sizeof(scratch));
+    Parser p = { text, nullptr, 0, 0, 0 };
+
+    for (;;) {
+        // Skip blank lines, comments and separators between rules
+        skipSpace(p);
+        while (*p.pos == '\n' || *p.pos == ';') {
+            p.pos++;
+            skipSpace(p);
+        }
+        if (*p.pos == '\0') break;
+
+        if (!parseRule(p)) break;
+        skipSpace(p);
+        if (*p.pos != '\n' && *p.pos != ';' && *p.pos != '\0') {
+            fail(p, "expected end of rule");
+            break;
+        }
+    }
+
+    if (p.error) {
+        snprintf(error, errorSize, "%s at offset %d", p.error, (int)(p.pos - text));
+        return false;
+    }
+
+    // Swap in the new program with fresh hysteresis/timer state
+    memcpy(&program, &scratch, sizeof(program));
+    memset(&state, 0, sizeof(state));
+    strcpy(source, text);
+    lastEvalUs = 0;
+    maxEvalUs = 0;
+    return true;
+}
+
+void PDURulesEngine::evaluate(const RuleInputs& inputs, unsigned long now, RuleOutputs& outputs) {
+    uint32_t startUs = micros();
+    float stack[RULES_MAX_STACK];
+    int sp = 0;
+
+    outputs.channelsOn = 0;
+    outputs.channelsOff = 0;
+    outputs.relayOff = false;
+
+    for (uint8_t pc = 0; pc < program.codeSize; pc++) {
+        const Instruction& in = program.code[pc];
+        switch (in.op) {
+            case OP_CONST: stack[sp++] = program.constants[in.a]; break;
+            case OP_VAR:   stack[sp++] = inputs.values[in.a]; break;
+            case OP_GT:    sp--; stack[sp - 1] = stack[sp - 1] > stack[sp]; break;
+            case OP_GE:    sp--; stack[sp - 1] = stack[sp - 1] >= stack[sp]; break;
+            case OP_LT:    sp--; stack[sp - 1] = stack[sp - 1] < stack[sp]; break;
+            case OP_LE:    sp--; stack[sp - 1] = stack[sp - 1] <= stack[sp]; break;
+            case OP_EQ:    sp--; stack[sp - 1] = stack[sp - 1] == stack[sp]; break;
+            case OP_NE:    sp--; stack[sp - 1] = stack[sp - 1] != stack[sp]; break;
+            case OP_AND:   sp--; stack[sp - 1] = stack[sp - 1] != 0 && stack[sp] != 0; break;
+            case OP_OR:    sp--; stack[sp - 1] = stack[sp - 1] != 0 || stack[sp] != 0; break;
+            case OP_NOT:   stack[sp - 1] = stack[sp - 1] == 0; break;
+
+            case OP_HYST_GT:
+            case OP_HYST_LT: {
+                // Latch when the comparison holds, release once past the band
+                sp -= 2;
+                float value = stack[sp - 1];
+                float limit = stack[sp];
+                float band = stack[sp + 1];
+                bool& latched = state.latched[in.a];
+                if (in.op == OP_HYST_GT) {
+                    if (in.b ? value >= limit : value > limit) latched = true;
+                    else if (value <= limit - band) latched = false;
+                } else {
+                    if (in.b ? value <= limit : value < limit) latched = true;
+                    else if (value >= limit + band) latched = false;
+                }
+                stack[sp - 1] = latched;
+                break;
+            }
+
+            case OP_FOR: {
+                // True once the condition has held continuously for the duration
+                sp--;
+                float duration = stack[sp];
+                bool held = false;
+                if (stack[sp - 1] == 0) {
+                    state.timerActive[in.a] = false;
+                } else {
+                    if (!state.timerActive[in.a]) {
+                        state.timerActive[in.a] = true;
+                        state.timerStart[in.a] = now;
+                    }
+                    held = duration <= 0 || now - state.timerStart[in.a] >= (unsigned long)duration;
+                }
+                stack[sp - 1] = held;
+                break;
+            }
+
+            case OP_RULE: {
+                sp--;
+                bool result = stack[sp] != 0;
+                const Rule& rule = program.rules[in.a];
+                if (result && rule.relayOff) outputs.relayOff = true;
+
+                // Level-held: the then/else channel states are asserted every tick
+                uint8_t on = result ? rule.thenOn : rule.elseOn;
+                uint8_t off = result ? rule.thenOff : rule.elseOff;
+                outputs.channelsOn = (outputs.channelsOn & ~off) | on;
+                outputs.channelsOff = (outputs.channelsOff & ~on) | off;
+                break;
+            }
+        }
+    }
+
+    lastEvalUs = micros() - startUs;
+    if (lastEvalUs > maxEvalUs) maxEvalUs = lastEvalUs;
+}
+
+bool PDURulesEngine::parseRule(Parser& p) {
+    if (scratch.ruleCount >= RULES_MAX_RULES) return fail(p, "too many rules");
+
+    p.depth = 0;
+    if (!parseExpr(p)) return false;
+    if (!accept(p, "->")) return fail(p, "expected '->'");
+
+    Rule& rule = scratch.rules[scratch.ruleCount];
+    if (!parseActions(p, rule.thenOn, rule.thenOff, &rule.relayOff)) return false;
+    if (acceptWord(p, "else") && !parseActions(p, rule.elseOn, rule.elseOff, nullptr)) return false;
+
+    return emit(p, OP_RULE, scratch.ruleCount++, 0, -1);
+}
+
+bool PDURulesEngine::parseExpr(Parser& p) {
+    if (!parseTerm(p)) return false;
+    while (accept(p, "||")) {
+        if (!parseTerm(p) || !emit(p, OP_OR, 0, 0, -1)) return false;
+    }
+    return true;
+}
+
+bool PDURulesEngine::parseTerm(Parser& p) {
+    if (!parseFactor(p)) return false;
+    while (accept(p, "&&")) {
+        if (!parseFactor(p) || !emit(p, OP_AND, 0, 0, -1)) return false;
+    }
+    return true;
+}
+
+bool PDURulesEngine::parseFactor(Parser& p) {
+    if (!parseUnary(p)) return false;
+    if (!acceptWord(p, "for")) return true;
+
+    if (scratch.stateCount >= RULES_MAX_STATE) return fail(p, "too many timers/hysteresis");
+    uint8_t slot = scratch.stateCount++;
+
+    // Duration is a literal with optional unit, or a variable such as timeThreshold
+    skipSpace(p);
+    if (isdigit((unsigned char)*p.pos) || *p.pos == '.') {
+        float ms;
+        uint8_t index;
+        if (!parseDuration(p, ms) || !addConstant(p, ms, index)) return false;
+        if (!emit(p, OP_CONST, index, 0, 1)) return false;
+    } else if (!parseOperand(p)) {
+        return false;
+    }
+    return emit(p, OP_FOR, slot, 0, -1);
+}
+
+bool PDURulesEngine::parseUnary(Parser& p) {
+    // Nothing is emitted before the recursion, so the stack depth check cannot catch
+    // "((((..." or "!!!!..." from a remote program; limit the nesting itself
+    if (accept(p, "!")) {
+        if (++p.nesting > RULES_MAX_STACK) return fail(p, "expression too deep");
+        bool ok = parseUnary(p) && emit(p, OP_NOT);
+        p.nesting--;
+        return ok;
+    }
+    if (accept(p, "(")) {
+        if (++p.nesting > RULES_MAX_STACK) return fail(p, "expression too deep");
+        if (!parseExpr(p)) return false;
+        p.nesting--;
+        return accept(p, ")") || fail(p, "expected ')'");
+    }
+
+    if (!parseOperand(p)) return false;
+
+    uint8_t op;
+    if (accept(p, ">=")) op = OP_GE;
+    else if (accept(p, "<=")) op = OP_LE;
+    else if (accept(p, "==")) op = OP_EQ;
+    else if (accept(p, "!=")) op = OP_NE;
+    else if (accept(p, ">")) op = OP_GT;
+    else if (accept(p, "<")) op = OP_LT;
+    else return true;  // Bare operand: true when non-zero
+
+    if (!parseOperand(p)) return false;
+    if (!acceptWord(p, "hyst")) return emit(p, op, 0, 0, -1);
+
+    if (op == OP_EQ || op == OP_NE) return fail(p, "hyst needs <, <=, > or >=");
+    if (scratch.stateCount >= RULES_MAX_STATE) return fail(p, "too many timers/hysteresis");
+    if (!parseOperand(p)) return false;
+
+    uint8_t hystOp = (op == OP_GT || op == OP_GE) ? OP_HYST_GT : OP_HYST_LT;
+    uint8_t inclusive = (op == OP_GE || op == OP_LE) ? 1 : 0;
+    return emit(p, hystOp, scratch.stateCount++, inclusive, -2);
+}
+
+bool PDURulesEngine::parseOperand(Parser& p) {
+    skipSpace(p);
+    const char* s = p.pos;
+    bool numeric = isdigit((unsigned char)s[0]) || s[0] == '.' ||
+                   (s[0] == '-' && (isdigit((unsigned char)s[1]) || s[1] == '.'));
+
+    if (numeric) {
+        char* end;
+        float value = strtof(s, &end);
+        if (end == s) return fail(p, "bad number");
+        p.pos = end;
+        uint8_t index;
+        return addConstant(p, value, index) && emit(p, OP_CONST, index, 0, 1);
+    }
+
+    int variable = readVariable(p);
+    if (variable < 0) return fail(p, "unknown variable");
+    return emit(p, OP_VAR, variable, 0, 1);
+}
+
+bool PDURulesEngine::parseDuration(Parser& p, float& ms) {
+    char* end;
+    ms = strtof(p.pos, &end);
+    if (end == p.pos || ms < 0) return fail(p, "bad duration");
+    p.pos = end;
+
+    if (acceptWord(p, "ms")) return true;
+    if (acceptWord(p, "s")) ms *= 1000.0f;
+    else if (acceptWord(p, "m")) ms *= 60000.0f;
+    else if (acceptWord(p, "h")) ms *= 3600000.0f;
+    return true;
+}
+
+bool PDURulesEngine::parseActions(Parser& p, uint8_t& onMask, uint8_t& offMask, bool* relayOff) {
+    bool on = false;
+    bool haveVerb = false;
+
+    do {
+        if (acceptWord(p, "on")) { on = true; haveVerb = true; }
+        else if (acceptWord(p, "off")) { on = false; haveVerb = true; }
+        if (!haveVerb) return fail(p, "expected 'on' or 'off'");
+
+        if (acceptWord(p, "relay")) {
+            // The relay is only ever held off; IGN still decides when it comes on
+            if (on || !relayOff) return fail(p, "relay can only be held off");
+            *relayOff = true;
+            continue;
+        }
+
+        uint8_t mask = 0;
+        if (acceptWord(p, "all")) {
+            mask = 0x0F;
+        } else {
+            for (uint8_t i = 0; i < 4 && !mask; i++) {
+                char name[4] = { 'c', 'h', (char)('1' + i), '\0' };
+                if (acceptWord(p, name)) mask = 1 << i;
+            }
+        }
+        if (!mask) return fail(p, "expected ch1-ch4, all or relay");
+
+        if (on) {
+            onMask |= mask;
+            offMask &= ~mask;
+        } else {
+            offMask |= mask;
+            onMask &= ~mask;
+        }
+    } while (accept(p, ","));
+
+    return true;
+}
+
+bool PDURulesEngine::emit(Parser& p, uint8_t op, uint8_t a, uint8_t b, int stackChange) {
+    if (scratch.codeSize >= RULES_MAX_CODE) return fail(p, "program too large");
+
+    Instruction& in = scratch.code[scratch.codeSize++];
+    in.op = op;
+    in.a = a;
+    in.b = b;
+
+    p.depth += stackChange;
+    if (p.depth > RULES_MAX_STACK) return fail(p, "expression too deep");
+    if (p.depth > p.maxDepth) p.maxDepth = p.depth;
+    return true;
+}
+
+bool PDURulesEngine::addConstant(Parser& p, float value, uint8_t& index) {
+    for (index = 0; index < scratch.constantCount; index++) {
+        if (scratch.constants[index] == value) return true;
+    }
+    if (scratch.constantCount >= RULES_MAX_CONSTANTS) return fail(p, "too many constants");
+    scratch.constants[scratch.constantCount++] = value;
+    return true;
+}
+
+bool PDURulesEngine::fail(Parser& p, const char* message) {
+    if (!p.error) p.error = message;
+    return false;
+}
+
+void PDURulesEngine::skipSpace(Parser& p) {
+    for (;;) {
+        char c = *p.pos;
+        if (c == ' ' || c == '\t' || c == '\r') {
+            p.pos++;
+        } else if (c == '#') {
+            while (*p.pos && *p.pos != '\n' && *p.pos != ';') p.pos++;
+        } else {
+            return;
+        }
+    }
+}
+
+bool PDURulesEngine::accept(Parser& p, const char* token) {
+    skipSpace(p);
+    size_t length = strlen(token);
+    if (strncmp(p.pos, token, length) != 0) return false;
+    p.pos += length;
+    return true;
+}
+
+bool PDURulesEngine::acceptWord(Parser& p, const char* word) {
+    skipSpace(p);
+    size_t length = strlen(word);
+    if (strncasecmp(p.pos, word, length) != 0) return false;
+    char next = p.pos[length];
+    if (isalnum((unsigned char)next) || next == '_') return false;
+    p.pos += length;
+    return true;
+}
+
+int PDURulesEngine::readVariable(Parser& p) {
+    for (int i = 0; i < RULE_VAR_COUNT; i++) {
+        if (acceptWord(p, VARIABLE_NAMES[i])) return i;
+    }
+    return -1;
+}
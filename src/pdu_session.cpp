@@ -0,0 +1,113 @@
+/*
+ * PDU Session Table Implementation
+ *
+ * Tokens are 128-bit random values from the hardware RNG. The table is
+ * open-addressed on the token's first bytes, so a lookup touches one slot
+ * in the common case; the compare itself always checks every byte.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_session.h"
+#include "pdu_no_string.h"
+
+PDUSessionTable::PDUSessionTable() {
+    memset(sessions, 0, sizeof(sessions));
+}
+
+void PDUSessionTable::create(char* tokenHex) {
+    uint8_t token[SESSION_TOKEN_BYTES];
+    for (int i = 0; i < SESSION_TOKEN_BYTES; i += 4) {
+        uint32_t random = esp_random();
+        memcpy(&token[i], &random, 4);
+    }
+
+    // Take the first free or expired slot from the token's home slot, else evict the oldest
+    uint8_t home = slotFor(token);
+    int target = -1;
+    for (int probe = 0; probe < SESSION_TABLE_SIZE && target < 0; probe++) {
+        int index = (home + probe) % SESSION_TABLE_SIZE;
+        if (!sessions[index].active || isExpired(sessions[index])) target = index;
+    }
+    if (target < 0) {
+        target = home;
+        for (int i = 0; i < SESSION_TABLE_SIZE; i++) {
+            if ((long)(sessions[i].expiresAt - sessions[target].expiresAt) < 0) target = i;
+        }
+    }
+
+    Session& session = sessions[target];
+    memcpy(session.token, token, SESSION_TOKEN_BYTES);
+    session.expiresAt = millis() + SESSION_TIMEOUT;
+    session.active = true;
+
+    static const char hex[] = "0123456789abcdef";
+    for (int i = 0; i < SESSION_TOKEN_BYTES; i++) {
+        tokenHex[i * 2] = hex[token[i] >> 4];
+        tokenHex[i * 2 + 1] = hex[token[i] & 0x0F];
+    }
+    tokenHex[SESSION_TOKEN_HEX_LENGTH] = '\0';
+}
+
+bool PDUSessionTable::validate(const char* tokenHex) {
+    uint8_t token[SESSION_TOKEN_BYTES];
+    if (!parseToken(tokenHex, token)) return false;
+
+    int index = find(token);
+    if (index < 0) return false;
+
+    // Sliding expiry: an active dashboard keeps its session
+    sessions[index].expiresAt = millis() + SESSION_TIMEOUT;
+    return true;
+}
+
+void PDUSessionTable::remove(const char* tokenHex) {
+    uint8_t token[SESSION_TOKEN_BYTES];
+    if (!parseToken(tokenHex, token)) return;
+
+    int index = find(token);
+    if (index >= 0) sessions[index].active = false;
+}
+
+int PDUSessionTable::find(const uint8_t* token) {
+    uint8_t home = slotFor(token);
+    for (int probe = 0; probe < SESSION_TABLE_SIZE; probe++) {
+        int index = (home + probe) % SESSION_TABLE_SIZE;
+        Session& session = sessions[index];
+        if (session.active && !isExpired(session) && tokensEqual(session.token, token)) return index;
+    }
+    return -1;
+}
+
+bool PDUSessionTable::isExpired(const Session& session) const {
+    return (long)(millis() - session.expiresAt) >= 0;
+}
+
+bool PDUSessionTable::parseToken(const char* tokenHex, uint8_t* token) {
+    if (!tokenHex) return false;
+    for (int i = 0; i < SESSION_TOKEN_HEX_LENGTH; i++) {
+        char c = tokenHex[i];
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else return false;
+        if (i % 2 == 0) token[i / 2] = nibble << 4;
+        else token[i / 2] |= nibble;
+    }
+    return true;
+}
+
+bool PDUSessionTable::tokensEqual(const uint8_t* a, const uint8_t* b) {
+    // Constant-time compare so response timing does not leak matching prefixes
+    uint8_t diff = 0;
+    for (int i = 0; i < SESSION_TOKEN_BYTES; i++) diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
+uint8_t PDUSessionTable::slotFor(const uint8_t* token) {
+    return token[0] % SESSION_TABLE_SIZE;
+}
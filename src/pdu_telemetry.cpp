@@ -0,0 +1,636 @@
+/*
+ * PDU Telemetry Publisher Implementation
+ *
+ * This file implements the batch encoder, the spool and the publisher
+ * task. The loop task owns the open batch; the spool is shared with the
+ * publisher task under a critical section that only covers the copies.
+ * The MQTT side is a minimal MQTT 3.1.1 client: clean session, QoS 1
+ * publishes with one message in flight, keep-alive pings, no
+ * subscriptions.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_telemetry.h"
+#include <Preferences.h>
+#include "pdu_event_log.h"
+#include "pdu_journal.h"
+#include "pdu_logger.h"
+#include "pdu_no_string.h"
+
+static const size_t VARINT_MAX = 5;
+static const size_t SAMPLE_RECORD_MAX = 1 + 5 * VARINT_MAX;
+static const size_t EVENT_RECORD_MAX = 1 + 2 * VARINT_MAX;
+static const size_t LOST_RECORD_MAX = 1 + VARINT_MAX;
+static const size_t SPOOL_ENTRY_HEADER = 4;         // Payload length, sample count
+static const size_t EVENTS_PER_READ = 16;
+
+static const uint8_t RECORD_EVENT = 0x80;
+static const uint8_t RECORD_LOST = 0xC0;
+
+// MQTT control packet types (upper nibble of the first byte)
+static const uint8_t MQTT_CONNECT = 1;
+static const uint8_t MQTT_CONNACK = 2;
+static const uint8_t MQTT_PUBLISH = 3;
+static const uint8_t MQTT_PUBACK = 4;
+static const uint8_t MQTT_PINGREQ = 12;
+static const uint8_t MQTT_PINGRESP = 13;
+static const uint8_t MQTT_DISCONNECT = 14;
+
+PDUController* PDUTelemetry::controller = nullptr;
+TelemetryConfig PDUTelemetry::config;
+volatile uint32_t PDUTelemetry::configVersion = 0;
+volatile TelemetryState PDUTelemetry::state = TELEMETRY_OFF;
+TelemetryStats PDUTelemetry::stats;
+char PDUTelemetry::clientId[20];
+
+uint8_t PDUTelemetry::batch[TELEMETRY_BATCH_MAX];
+size_t PDUTelemetry::batchLength = 0;
+uint16_t PDUTelemetry::batchSampleCount = 0;
+uint32_t PDUTelemetry::batchNumber = 0;
+unsigned long PDUTelemetry::batchStart = 0;
+unsigned long PDUTelemetry::lastSampleTime = 0;
+unsigned long PDUTelemetry::previousSampleTime = 0;
+uint32_t PDUTelemetry::lastEventUs = 0;
+uint32_t PDUTelemetry::eventSeq = 0;
+PDUTelemetry::Sample PDUTelemetry::previous;
+
+uint8_t PDUTelemetry::spool[TELEMETRY_SPOOL_SIZE];
+size_t PDUTelemetry::spoolHead = 0;
+volatile size_t PDUTelemetry::spoolUsed = 0;
+volatile uint16_t PDUTelemetry::spoolCount = 0;
+uint32_t PDUTelemetry::spoolFirst = 0;
+portMUX_TYPE PDUTelemetry::mux = portMUX_INITIALIZER_UNLOCKED;
+
+static size_t putVarint(uint8_t* out, uint32_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[length++] = value;
+    return length;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+void PDUTelemetry::begin(PDUController& pdu) {
+    controller = &pdu;
+
+    Preferences preferences;
+    preferences.begin("pdu-mqtt", true);
+    memset(config.broker, 0, sizeof(config.broker));
+    preferences.getString("broker", config.broker, sizeof(config.broker));
+    config.port = preferences.getUShort("port", MQTT_DEFAULT_PORT);
+    config.batchPeriod = preferences.getULong("period", TELEMETRY_BATCH_PERIOD);
+    config.batchSamples = preferences.getUShort("samples", TELEMETRY_BATCH_SAMPLES);
+    preferences.end();
+
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    snprintf(clientId, sizeof(clientId), "pdu-%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3],
+             mac[4], mac[5]);
+
+    eventSeq = PDUEventLog::getNextSeq();
+    configVersion++;
+    xTaskCreate(publisherTask, "pdu_mqtt", MQTT_TASK_STACK, nullptr, tskIDLE_PRIORITY + 1, nullptr);
+    if (config.broker[0] != '\0') LOG_INFO("MQTT telemetry to %s:%u as %s", config.broker, config.port, clientId);
+}
+
+void PDUTelemetry::update() {
+    if (config.broker[0] == '\0') return;
+
+    unsigned long now = millis();
+    if (now - lastSampleTime < TELEMETRY_SAMPLE_INTERVAL) return;
+
+    // Keep the cadence through loop jitter so sample times stay implicit; restart it after a stall
+    if (now - lastSampleTime < 2 * TELEMETRY_SAMPLE_INTERVAL) lastSampleTime += TELEMETRY_SAMPLE_INTERVAL;
+    else lastSampleTime = now;
+    takeSample(lastSampleTime);
+}
+
+void PDUTelemetry::takeSample(unsigned long time) {
+    addEvents(time);
+    addSample(time);
+    if (batchSampleCount >= config.batchSamples || time - batchStart + TELEMETRY_SAMPLE_INTERVAL > config.batchPeriod) {
+        closeBatch();
+    }
+}
+
+void PDUTelemetry::addSample(unsigned long time) {
+    PDUStatus status;
+    uint32_t version;
+    controller->readStatus(status, version);
+
+    Sample current;
+    current.flags = 0;
+    for (int i = 0; i < 4; i++) {
+        if (status.fuses[i]) current.flags |= TELEMETRY_F1 << i;
+        if (status.channels[i]) current.flags |= TELEMETRY_CH1 << i;
+    }
+    if (status.ign) current.flags |= TELEMETRY_IGN;
+    if (status.relay) current.flags |= TELEMETRY_RELAY;
+    if (status.vpLocked) current.flags |= TELEMETRY_VP_LOCKED;
+    current.temp = lroundf(status.temp * 100);
+    current.battery = lroundf(status.battery * 100);
+    current.vpTrips = status.vpTrips;
+
+    ensureSpace(SAMPLE_RECORD_MAX, time);
+    uint8_t* record = batch + batchLength;
+    uint8_t mask = 0;
+    size_t length = 1;
+    uint32_t elapsed = time - previousSampleTime;
+    if (elapsed != TELEMETRY_SAMPLE_INTERVAL) {
+        mask |= 0x01;
+        length += putVarint(record + length, elapsed);
+    }
+    if (current.flags != previous.flags) {
+        mask |= 0x02;
+        length += putVarint(record + length, current.flags ^ previous.flags);
+    }
+    if (current.temp != previous.temp) {
+        mask |= 0x04;
+        length += putVarint(record + length, zigzag(current.temp - previous.temp));
+    }
+    if (current.battery != previous.battery) {
+        mask |= 0x08;
+        length += putVarint(record + length, zigzag(current.battery - previous.battery));
+    }
+    if (current.vpTrips != previous.vpTrips) {
+        mask |= 0x10;
+        length += putVarint(record + length, current.vpTrips - previous.vpTrips);
+    }
+    record[0] = mask;
+    batchLength += length;
+
+    previous = current;
+    previousSampleTime = time;
+    batchSampleCount++;
+    stats.samples++;
+}
+
+void PDUTelemetry::addEvents(unsigned long time) {
+    PDUEvent events[EVENTS_PER_READ];
+    uint32_t next;
+    size_t count;
+    while ((count = PDUEventLog::read(eventSeq, events, EVENTS_PER_READ, next)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            const PDUEvent& event = events[i];
+            if (event.seq != eventSeq) {
+                // Overwritten before we got to them
+                ensureSpace(LOST_RECORD_MAX + EVENT_RECORD_MAX, time);
+                batch[batchLength++] = RECORD_LOST;
+                batchLength += putVarint(batch + batchLength, event.seq - eventSeq);
+            }
+            ensureSpace(EVENT_RECORD_MAX, time);
+            batch[batchLength++] = RECORD_EVENT | (event.level ? 1 : 0);
+            batchLength += putVarint(batch + batchLength, event.pin);
+            batchLength += putVarint(batch + batchLength, zigzag((int32_t)(event.timestampUs - lastEventUs)));
+            lastEventUs = event.timestampUs;
+            eventSeq = event.seq + 1;
+            stats.events++;
+        }
+        if (count < EVENTS_PER_READ) break;
+    }
+}
+
+void PDUTelemetry::openBatch(unsigned long time) {
+    batch[0] = TELEMETRY_FORMAT;
+    batchLength = 1;
+    batchLength += putVarint(batch + batchLength, batchNumber);
+    batchLength += putVarint(batch + batchLength, PDUJournal::getBootCount());
+    batchLength += putVarint(batch + batchLength, time);
+    batchLength += putVarint(batch + batchLength, TELEMETRY_SAMPLE_INTERVAL);
+
+    batchStart = time;
+    batchSampleCount = 0;
+    previousSampleTime = time - TELEMETRY_SAMPLE_INTERVAL;
+    lastEventUs = time * 1000;
+    memset(&previous, 0, sizeof(previous));
+}
+
+// Opens a batch, or starts the next one when the record would not fit
+void PDUTelemetry::ensureSpace(size_t bytes, unsigned long time) {
+    if (batchLength > 0 && batchLength + bytes > sizeof(batch)) closeBatch();
+    if (batchLength == 0) openBatch(time);
+}
+
+void PDUTelemetry::closeBatch() {
+    if (batchLength == 0) return;
+
+    size_t entryLength = SPOOL_ENTRY_HEADER + batchLength;
+    uint8_t header[SPOOL_ENTRY_HEADER] = { (uint8_t)(batchLength >> 8), (uint8_t)batchLength,
+                                           (uint8_t)(batchSampleCount >> 8), (uint8_t)batchSampleCount };
+    uint32_t dropped = 0;
+
+    // Make room by moving the head past the oldest entries
+    portENTER_CRITICAL(&mux);
+    while (spoolUsed + entryLength > sizeof(spool) && spoolCount > 0) {
+        uint8_t oldest[2];
+        spoolCopy(spoolHead, oldest, 2, false);
+        size_t oldestLength = SPOOL_ENTRY_HEADER + (oldest[0] << 8 | oldest[1]);
+        spoolHead = (spoolHead + oldestLength) % sizeof(spool);
+        spoolUsed -= oldestLength;
+        spoolCount--;
+        spoolFirst++;
+        dropped++;
+    }
+    size_t tail = (spoolHead + spoolUsed) % sizeof(spool);
+    portEXIT_CRITICAL(&mux);
+
+    // Nothing past spoolUsed is read and this is the only writer, so copy without the lock.
+    // A pop by the publisher moves the head but not the tail.
+    spoolCopy(tail, header, SPOOL_ENTRY_HEADER, true);
+    spoolCopy((tail + SPOOL_ENTRY_HEADER) % sizeof(spool), batch, batchLength, true);
+
+    if (dropped > 0 && stats.dropped == 0) LOG_WARN("MQTT: spool full, dropping the oldest batches");
+    portENTER_CRITICAL(&mux);
+    if (spoolCount == 0) spoolFirst = batchNumber;
+    spoolUsed += entryLength;
+    spoolCount++;
+    stats.dropped += dropped;
+    stats.batches++;
+    portEXIT_CRITICAL(&mux);
+    batchNumber++;
+    batchLength = 0;
+}
+
+// Copies to or from the ring at offset, wrapping at the end
+void PDUTelemetry::spoolCopy(size_t offset, uint8_t* data, size_t length, bool write) {
+    size_t first = sizeof(spool) - offset < length ? sizeof(spool) - offset : length;
+    if (write) {
+        memcpy(spool + offset, data, first);
+        memcpy(spool, data + first, length - first);
+    } else {
+        memcpy(data, spool + offset, first);
+        memcpy(data + first, spool, length - first);
+    }
+}
+
+bool PDUTelemetry::peekOldest(uint8_t* payload, size_t& length, uint16_t& samples, uint32_t& number) {
+    uint8_t header[SPOOL_ENTRY_HEADER];
+    size_t offset = 0;
+    portENTER_CRITICAL(&mux);
+    bool found = spoolCount > 0;
+    if (found) {
+        spoolCopy(spoolHead, header, SPOOL_ENTRY_HEADER, false);
+        offset = (spoolHead + SPOOL_ENTRY_HEADER) % sizeof(spool);
+        number = spoolFirst;
+    }
+    portEXIT_CRITICAL(&mux);
+    if (!found) return false;
+
+    length = header[0] << 8 | header[1];
+    samples = header[2] << 8 | header[3];
+    spoolCopy(offset, payload, length, false);
+
+    // If the loop dropped the entry for space meanwhile, the copy may be overwritten: try again later
+    portENTER_CRITICAL(&mux);
+    bool valid = spoolCount > 0 && spoolFirst == number;
+    portEXIT_CRITICAL(&mux);
+    return valid;
+}
+
+// Removes the oldest batch if it is still the given one (it may have been dropped for space meanwhile)
+void PDUTelemetry::dropOldest(uint32_t number) {
+    portENTER_CRITICAL(&mux);
+    if (spoolCount > 0 && spoolFirst == number) {
+        uint8_t header[2];
+        spoolCopy(spoolHead, header, 2, false);
+        size_t entryLength = SPOOL_ENTRY_HEADER + (header[0] << 8 | header[1]);
+        spoolHead = (spoolHead + entryLength) % sizeof(spool);
+        spoolUsed -= entryLength;
+        spoolCount--;
+        spoolFirst++;
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+void PDUTelemetry::getStats(TelemetryStats& out) {
+    portENTER_CRITICAL(&mux);
+    out = stats;
+    portEXIT_CRITICAL(&mux);
+}
+
+void PDUTelemetry::clear() {
+    batchLength = 0;
+    portENTER_CRITICAL(&mux);
+    spoolHead = 0;
+    spoolUsed = 0;
+    spoolCount = 0;
+    portEXIT_CRITICAL(&mux);
+}
+
+// Host names and IPv4/IPv6 addresses; also keeps the name safe to echo in JSON
+static bool isBrokerValid(const char* broker, size_t size) {
+    size_t length = strnlen(broker, size);
+    if (length >= size) return false;
+    for (size_t i = 0; i < length; i++) {
+        char c = broker[i];
+        if (!isalnum((unsigned char)c) && c != '.' && c != '-' && c != '_' && c != ':') return false;
+    }
+    return true;
+}
+
+bool PDUTelemetry::configure(const TelemetryConfig& newConfig) {
+    if (!isBrokerValid(newConfig.broker, sizeof(newConfig.broker)) || newConfig.port == 0 ||
+        newConfig.batchSamples == 0 || newConfig.batchPeriod < TELEMETRY_SAMPLE_INTERVAL) {
+        return false;
+    }
+
+    // Batches from before the change still go out, unless publishing is switched off
+    closeBatch();
+    if (newConfig.broker[0] == '\0') clear();
+    if (config.broker[0] == '\0') eventSeq = PDUEventLog::getNextSeq();
+
+    portENTER_CRITICAL(&mux);
+    config = newConfig;
+    configVersion++;
+    portEXIT_CRITICAL(&mux);
+
+    Preferences preferences;
+    preferences.begin("pdu-mqtt", false);
+    preferences.putString("broker", config.broker);
+    preferences.putUShort("port", config.port);
+    preferences.putULong("period", config.batchPeriod);
+    preferences.putUShort("samples", config.batchSamples);
+    preferences.end();
+
+    if (config.broker[0] != '\0') LOG_INFO("MQTT telemetry to %s:%u as %s", config.broker, config.port, clientId);
+    else LOG_INFO("MQTT telemetry off");
+    return true;
+}
+
+void PDUTelemetry::getConfig(TelemetryConfig& out) {
+    portENTER_CRITICAL(&mux);
+    out = config;
+    portEXIT_CRITICAL(&mux);
+}
+
+const char* PDUTelemetry::getStateName(TelemetryState value) {
+    switch (value) {
+        case TELEMETRY_OFF: return "off";
+        case TELEMETRY_WAIT_WIFI: return "wifi";
+        case TELEMETRY_WAIT_BROKER: return "broker";
+        case TELEMETRY_CONNECTED: return "connected";
+        default: return "unknown";
+    }
+}
+
+// Publisher task state; only the task touches it
+namespace {
+
+struct Publisher {
+    WiFiClient client;
+    TelemetryConfig config;
+    uint32_t configVersion;
+    char topic[sizeof(MQTT_TOPIC_PREFIX) + 32];
+    bool sessionOpen;               // CONNACK received
+    bool attempted;                 // A connection has been attempted since the last change
+    bool reportFailure;
+    bool joined;                    // WiFi.begin() called at least once
+    unsigned long lastJoin;
+    unsigned long lastAttempt;
+    unsigned long connectSent;
+    unsigned long lastSend;
+    bool pingOutstanding;
+
+    bool inFlight;
+    uint32_t inFlightBatch;
+    uint16_t inFlightSamples;
+    size_t inFlightLength;
+    uint16_t packetId;
+    unsigned long inFlightSince;
+    uint32_t wireBytes;             // Copied into the shared stats under the lock
+
+    // Incoming packet being assembled; bodies past the first bytes are skipped
+    uint8_t rxHeader;
+    uint32_t rxRemaining;
+    uint8_t rxShift;
+    uint8_t rxPhase;                // 0 = fixed header, 1 = remaining length, 2 = body
+    uint8_t rxBody[4];
+    size_t rxBodyLength;
+
+    uint8_t payload[TELEMETRY_BATCH_MAX];
+    uint8_t packet[TELEMETRY_BATCH_MAX + 64];
+};
+
+}  // namespace
+
+static Publisher publisher;
+
+static bool sendPacket(Publisher& p, const uint8_t* data, size_t length) {
+    size_t sent = p.client.write(data, length);
+    p.wireBytes += sent;
+    p.lastSend = millis();
+    return sent == length;
+}
+
+static void closeSession(Publisher& p, bool graceful) {
+    if (p.client.connected() && graceful && p.sessionOpen) {
+        static const uint8_t disconnect[] = { MQTT_DISCONNECT << 4, 0 };
+        p.client.write(disconnect, sizeof(disconnect));
+    }
+    p.client.stop();
+    p.sessionOpen = false;
+    p.inFlight = false;             // The batch is still spooled and is sent again
+    p.pingOutstanding = false;
+    p.rxPhase = 0;
+}
+
+static size_t putString(uint8_t* out, const char* text) {
+    size_t length = strlen(text);
+    out[0] = length >> 8;
+    out[1] = length & 0xFF;
+    memcpy(out + 2, text, length);
+    return 2 + length;
+}
+
+void PDUTelemetry::publisherTask(void* param) {
+    Publisher& p = publisher;
+    p.configVersion = configVersion - 1;
+    p.attempted = false;
+    p.reportFailure = true;
+    p.joined = false;
+    p.wireBytes = 0;
+    closeSession(p, false);
+
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(MQTT_POLL_INTERVAL));
+        unsigned long now = millis();
+        portENTER_CRITICAL(&mux);
+        stats.wireBytes = p.wireBytes;
+        portEXIT_CRITICAL(&mux);
+
+        if (p.configVersion != configVersion) {
+            closeSession(p, true);
+            getConfig(p.config);
+            p.configVersion = configVersion;
+            p.attempted = false;
+            p.reportFailure = true;
+            snprintf(p.topic, sizeof(p.topic), MQTT_TOPIC_PREFIX "%s/telemetry", clientId);
+        }
+        if (p.config.broker[0] == '\0') {
+            state = TELEMETRY_OFF;
+            continue;
+        }
+
+        // The access point comes up first; parked mode switches the radio off
+        wifi_mode_t mode = WiFi.getMode();
+        if (mode == WIFI_OFF) {
+            if (p.client) closeSession(p, false);
+            state = TELEMETRY_WAIT_WIFI;
+            continue;
+        }
+        if ((mode & WIFI_STA) == 0) {
+            if (!p.joined || now - p.lastJoin >= MQTT_RETRY_INTERVAL) {
+                if (!p.joined) LOG_INFO("MQTT: joining network \"%s\" (STA_SSID)", STA_SSID);
+                WiFi.begin(STA_SSID, STA_PASSWORD);     // Keeps the access point; reconnects by itself
+                p.joined = true;
+                p.lastJoin = now;
+            }
+            state = TELEMETRY_WAIT_WIFI;
+            continue;
+        }
+        if (WiFi.status() != WL_CONNECTED) {
+            if (p.client) closeSession(p, false);
+            state = TELEMETRY_WAIT_WIFI;
+            continue;
+        }
+
+        if (!p.client.connected()) {
+            if (p.sessionOpen) {
+                LOG_WARN("MQTT: connection to %s lost", p.config.broker);
+                p.reportFailure = true;
+            }
+            closeSession(p, false);
+            state = TELEMETRY_WAIT_BROKER;
+            if (p.attempted && now - p.lastAttempt < MQTT_RETRY_INTERVAL) continue;
+            p.attempted = true;
+            p.lastAttempt = now;
+            if (!p.client.connect(p.config.broker, p.config.port)) {
+                if (p.reportFailure) LOG_WARN("MQTT: cannot reach %s:%u", p.config.broker, p.config.port);
+                p.reportFailure = false;
+                continue;
+            }
+            p.client.setNoDelay(true);
+
+            uint8_t* packet = p.packet;
+            size_t length = 2;
+            length += putString(packet + length, "MQTT");
+            packet[length++] = 4;                   // Protocol level 3.1.1
+            packet[length++] = 0x02;                // Clean session
+            packet[length++] = MQTT_KEEPALIVE >> 8;
+            packet[length++] = MQTT_KEEPALIVE & 0xFF;
+            length += putString(packet + length, clientId);
+            packet[0] = MQTT_CONNECT << 4;
+            packet[1] = length - 2;
+            p.connectSent = now;
+            if (!sendPacket(p, packet, length)) closeSession(p, false);
+            continue;
+        }
+
+        // Incoming: CONNACK, PUBACK and PINGRESP; anything else is skipped
+        int available = p.client.available();
+        while (available-- > 0) {
+            int c = p.client.read();
+            if (c < 0) break;
+            if (p.rxPhase == 0) {
+                p.rxHeader = c;
+                p.rxRemaining = 0;
+                p.rxShift = 0;
+                p.rxBodyLength = 0;
+                p.rxPhase = 1;
+                continue;
+            }
+            if (p.rxPhase == 1) {
+                p.rxRemaining |= (uint32_t)(c & 0x7F) << p.rxShift;
+                p.rxShift += 7;
+                if (c & 0x80) continue;
+                p.rxPhase = 2;
+            } else {
+                if (p.rxBodyLength < sizeof(p.rxBody)) p.rxBody[p.rxBodyLength++] = c;
+                p.rxRemaining--;
+            }
+            if (p.rxRemaining > 0) continue;
+            p.rxPhase = 0;
+
+            uint8_t type = p.rxHeader >> 4;
+            if (type == MQTT_CONNACK && p.rxBodyLength >= 2) {
+                if (p.rxBody[1] != 0) {
+                    LOG_WARN("MQTT: %s refused the connection (code %u)", p.config.broker, p.rxBody[1]);
+                    closeSession(p, false);
+                    break;
+                }
+                p.sessionOpen = true;
+                p.reportFailure = true;
+                portENTER_CRITICAL(&mux);
+                stats.connects++;
+                portEXIT_CRITICAL(&mux);
+                state = TELEMETRY_CONNECTED;
+                LOG_INFO("MQTT: connected to %s:%u", p.config.broker, p.config.port);
+            } else if (type == MQTT_PUBACK && p.rxBodyLength >= 2 && p.inFlight &&
+                       (p.rxBody[0] << 8 | p.rxBody[1]) == p.packetId) {
+                dropOldest(p.inFlightBatch);
+                p.inFlight = false;
+                portENTER_CRITICAL(&mux);
+                stats.published++;
+                stats.publishedSamples += p.inFlightSamples;
+                stats.payloadBytes += p.inFlightLength;
+                portEXIT_CRITICAL(&mux);
+            } else if (type == MQTT_PINGRESP) {
+                p.pingOutstanding = false;
+            }
+        }
+        if (!p.client) continue;
+
+        if (!p.sessionOpen) {
+            if (now - p.connectSent > MQTT_ACK_TIMEOUT) {
+                LOG_WARN("MQTT: no CONNACK from %s", p.config.broker);
+                closeSession(p, false);
+            }
+            continue;
+        }
+        if (p.inFlight && now - p.inFlightSince > MQTT_ACK_TIMEOUT) {
+            LOG_WARN("MQTT: no PUBACK for batch %lu, reconnecting", (unsigned long)p.inFlightBatch);
+            closeSession(p, false);
+            continue;
+        }
+
+        if (!p.inFlight && peekOldest(p.payload, p.inFlightLength, p.inFlightSamples, p.inFlightBatch)) {
+            p.packetId = p.packetId == 0xFFFF ? 1 : p.packetId + 1;
+            size_t topicLength = strlen(p.topic);
+            uint32_t remaining = 2 + topicLength + 2 + p.inFlightLength;
+            uint8_t* packet = p.packet;
+            packet[0] = MQTT_PUBLISH << 4 | 0x02;   // QoS 1
+            size_t length = 1 + putVarint(packet + 1, remaining);
+            length += putString(packet + length, p.topic);
+            packet[length++] = p.packetId >> 8;
+            packet[length++] = p.packetId & 0xFF;
+            memcpy(packet + length, p.payload, p.inFlightLength);
+            length += p.inFlightLength;
+
+            p.inFlight = true;
+            p.inFlightSince = now;
+            if (!sendPacket(p, packet, length)) closeSession(p, false);
+            continue;
+        }
+
+        // Keep-alive: a ping every half period; no answer by the next one drops the connection
+        if (now - p.lastSend >= MQTT_KEEPALIVE * 500UL) {
+            if (p.pingOutstanding) {
+                LOG_WARN("MQTT: no PINGRESP from %s", p.config.broker);
+                closeSession(p, false);
+                continue;
+            }
+            static const uint8_t ping[] = { MQTT_PINGREQ << 4, 0 };
+            p.pingOutstanding = true;
+            if (!sendPacket(p, ping, sizeof(ping))) closeSession(p, false);
+        }
+    }
+}
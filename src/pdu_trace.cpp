@@ -0,0 +1,105 @@
+/*
+ * PDU Trace Recorder Implementation
+ *
+ * This file implements the trace recorder. Records are appended to a
+ * fixed buffer from the loop task only (input edges are taken from the
+ * event log there, not from the ISRs), so no locking is needed. A record
+ * is either written completely or not at all.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_trace.h"
+#include "pdu_no_string.h"
+
+uint8_t PDUTrace::buffer[TRACE_BUFFER_SIZE];
+size_t PDUTrace::length = 0;
+uint32_t PDUTrace::lastTimeMs = 0;
+bool PDUTrace::recording = false;
+bool PDUTrace::truncated = false;
+
+void PDUTrace::start(uint32_t timeMs) {
+    memcpy(buffer, TRACE_MAGIC, 4);
+    buffer[4] = TRACE_VERSION;
+    length = TRACE_HEADER_SIZE;
+    lastTimeMs = timeMs;
+    truncated = false;
+    recording = true;
+}
+
+size_t PDUTrace::varintSize(uint32_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+void PDUTrace::putVarint(uint32_t value) {
+    while (value >= 0x80) {
+        buffer[length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buffer[length++] = value;
+}
+
+bool PDUTrace::beginRecord(uint8_t type, uint32_t timeMs, size_t payloadSize) {
+    if (!recording) return false;
+
+    // Edges drained from the event log can predate the last sample by a few ms
+    uint32_t delta = (int32_t)(timeMs - lastTimeMs) > 0 ? timeMs - lastTimeMs : 0;
+    if (length + 1 + varintSize(delta) + payloadSize > sizeof(buffer)) {
+        recording = false;
+        truncated = true;
+        return false;
+    }
+
+    buffer[length++] = type;
+    putVarint(delta);
+    lastTimeMs += delta;
+    return true;
+}
+
+void PDUTrace::recordPin(uint32_t timeMs, uint8_t pin, uint8_t level) {
+    if (!beginRecord(TRACE_PIN, timeMs, 1)) return;
+    buffer[length++] = (pin & 0x7F) | (level ? 0x80 : 0);
+}
+
+void PDUTrace::recordTemperature(uint32_t timeMs, float celsius) {
+    if (!beginRecord(TRACE_TEMP, timeMs, 2)) return;
+    int16_t value = (int16_t)lroundf(celsius * 16);
+    buffer[length++] = value & 0xFF;
+    buffer[length++] = (value >> 8) & 0xFF;
+}
+
+void PDUTrace::recordAnalog(uint32_t timeMs, uint8_t pin, uint16_t value) {
+    if (!beginRecord(TRACE_ADC, timeMs, 3)) return;
+    buffer[length++] = pin;
+    buffer[length++] = value & 0xFF;
+    buffer[length++] = value >> 8;
+}
+
+void PDUTrace::recordStart(uint32_t timeMs) {
+    beginRecord(TRACE_START, timeMs, 0);
+}
+
+void PDUTrace::recordCommand(const char* prefix, const char* text) {
+    if (!recording) return;
+
+    size_t prefixLength = strlen(prefix);
+    size_t textLength = strlen(text);
+    uint32_t commandLength = prefixLength + textLength;
+    if (!beginRecord(TRACE_CMD, millis(), varintSize(commandLength) + commandLength)) return;
+
+    putVarint(commandLength);
+    memcpy(&buffer[length], prefix, prefixLength);
+    length += prefixLength;
+    for (size_t i = 0; i < textLength; i++) {
+        char c = text[i];
+        buffer[length++] = c == '\n' ? ';' : c == '\r' ? ' ' : c;
+    }
+}
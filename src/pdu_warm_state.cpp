@@ -0,0 +1,151 @@
+/*
+ * PDU Warm Restart State Implementation
+ *
+ * This file implements the RTC memory blocks. RTC_NOINIT_ATTR keeps them
+ * out of the start-up zeroing, so after a power-on they hold whatever the
+ * memory powered up with; the magic number and CRC tell a valid block from
+ * that. A block is invalidated by clearing its magic.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "pdu_warm_state.h"
+#include "pdu_journal.h"
+#include "pdu_logger.h"
+#include "pdu_no_string.h"
+
+static const uint32_t SETTINGS_MAGIC = 0x50445553;  // "PDUS"
+static const uint32_t RUNTIME_MAGIC = 0x50445552;   // "PDUR"
+
+struct SettingsBlock {
+    uint32_t magic;
+    uint32_t crc;
+    WarmSettings settings;
+};
+
+struct RuntimeBlock {
+    uint32_t magic;
+    uint32_t crc;
+    uint32_t warmBoots;
+    uint32_t savedAt;           // millis() when written
+    WarmRuntime runtime;
+};
+
+RTC_NOINIT_ATTR static SettingsBlock settingsBlock;
+RTC_NOINIT_ATTR static RuntimeBlock runtimeBlock;
+
+bool PDUWarmState::warmBoot = false;
+uint8_t PDUWarmState::warmBoots = 0;
+esp_reset_reason_t PDUWarmState::resetReason = ESP_RST_UNKNOWN;
+
+// CRC of everything after the crc field
+template <typename Block>
+static uint32_t blockCrc(const Block& block) {
+    const uint8_t* start = (const uint8_t*)&block + offsetof(Block, crc) + sizeof(block.crc);
+    return PDUJournal::crc32(start, sizeof(Block) - offsetof(Block, crc) - sizeof(block.crc));
+}
+
+template <typename Block>
+static bool isValid(const Block& block, uint32_t magic) {
+    return block.magic == magic && block.crc == blockCrc(block);
+}
+
+template <typename Block>
+static void seal(Block& block, uint32_t magic) {
+    block.magic = magic;
+    block.crc = blockCrc(block);
+}
+
+bool PDUWarmState::begin() {
+    resetReason = esp_reset_reason();
+
+    // Resets that leave RTC memory powered; anything else starts from NVS
+    bool warmReason = resetReason == ESP_RST_SW || resetReason == ESP_RST_PANIC ||
+                      resetReason == ESP_RST_INT_WDT || resetReason == ESP_RST_TASK_WDT ||
+                      resetReason == ESP_RST_WDT || resetReason == ESP_RST_BROWNOUT ||
+                      resetReason == ESP_RST_DEEPSLEEP;
+
+    warmBoot = false;
+    warmBoots = 0;
+    if (warmReason && isValid(runtimeBlock, RUNTIME_MAGIC)) {
+        // Waking up from parked mode is not a crash and does not count towards WARM_BOOT_LIMIT
+        uint32_t count = runtimeBlock.warmBoots + (resetReason == ESP_RST_DEEPSLEEP ? 0 : 1);
+        if (count <= WARM_BOOT_LIMIT) {
+            warmBoot = true;
+            warmBoots = count;
+        } else {
+            LOG_WARN("Warm restart: %lu restarts in a row, starting cold", (unsigned long)count);
+        }
+    }
+
+    if (!warmBoot) {
+        settingsBlock.magic = 0;
+        runtimeBlock.magic = 0;
+    } else {
+        LOG_INFO("Warm restart after %s reset (%u in a row): resuming from RTC memory",
+                 getResetReasonName(resetReason), warmBoots);
+    }
+    return warmBoot;
+}
+
+bool PDUWarmState::loadSettings(WarmSettings& settings) {
+    if (!warmBoot || !isValid(settingsBlock, SETTINGS_MAGIC)) return false;
+    settings = settingsBlock.settings;
+    settings.rules[RULES_MAX_SOURCE - 1] = '\0';
+    return true;
+}
+
+void PDUWarmState::saveSettings(const WarmSettings& settings) {
+    settingsBlock.settings = settings;
+    seal(settingsBlock, SETTINGS_MAGIC);
+}
+
+bool PDUWarmState::loadRuntime(WarmRuntime& runtime) {
+    if (!warmBoot || !isValid(runtimeBlock, RUNTIME_MAGIC)) return false;
+    runtime = runtimeBlock.runtime;
+
+    // Ages as they were at the last save; the time spent restarting is not counted
+    uint32_t savedAt = runtimeBlock.savedAt;
+    runtime.ignStableTime = savedAt - runtime.ignStableTime;
+    runtime.seqStartTime = savedAt - runtime.seqStartTime;
+    runtime.seqPhaseTime = savedAt - runtime.seqPhaseTime;
+    runtime.vpFaultStartTime = savedAt - runtime.vpFaultStartTime;
+    return true;
+}
+
+void PDUWarmState::saveRuntime(const WarmRuntime& runtime) {
+    uint32_t now = millis();
+
+    // Restarts this far apart are not a restart loop
+    if (warmBoots > 0 && now >= WARM_STABLE_TIME) warmBoots = 0;
+
+    // Most ticks change nothing; the CRC is only recomputed for a change or the periodic refresh
+    if (runtimeBlock.magic == RUNTIME_MAGIC && runtimeBlock.warmBoots == warmBoots &&
+        now - runtimeBlock.savedAt < WARM_SAVE_INTERVAL &&
+        memcmp(&runtimeBlock.runtime, &runtime, sizeof(runtime)) == 0) {
+        return;
+    }
+
+    runtimeBlock.warmBoots = warmBoots;
+    runtimeBlock.savedAt = now;
+    runtimeBlock.runtime = runtime;
+    seal(runtimeBlock, RUNTIME_MAGIC);
+}
+
+const char* PDUWarmState::getResetReasonName(esp_reset_reason_t reason) {
+    switch (reason) {
+        case ESP_RST_POWERON: return "power-on";
+        case ESP_RST_EXT: return "external";
+        case ESP_RST_SW: return "software";
+        case ESP_RST_PANIC: return "panic";
+        case ESP_RST_INT_WDT: return "interrupt watchdog";
+        case ESP_RST_TASK_WDT: return "task watchdog";
+        case ESP_RST_WDT: return "watchdog";
+        case ESP_RST_DEEPSLEEP: return "deep sleep";
+        case ESP_RST_BROWNOUT: return "brownout";
+        default: return "unknown";
+    }
+}
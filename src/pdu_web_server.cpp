@@ -12,34 +12,103 @@
  */
 
 #include "pdu_web_server.h"
+#include "pdu_logger.h"
+#include "pdu_boot.h"
+#include "pdu_heap.h"
+#include "pdu_trace.h"
+#include "pdu_journal.h"
+#include "pdu_command_queue.h"
+#include "pdu_warm_state.h"
+#include "pdu_park.h"
+#include "pdu_telemetry.h"
+#include "pdu_no_string.h"
 
 PDUWebServer::PDUWebServer(PDUController& pduController)
     : server(80)
     , pdu(pduController)
+    , started(false)
+    , listening(false)
+    , sessionAuthenticated(false)
+    , jsonLength(0)
+    , jsonCode(200)
+    , jsonChunked(false)
+    , etagEpoch(0)
 {
 }
 
 void PDUWebServer::begin() {
-    setupRoutes();
     WiFi.softAP(AP_SSID, AP_PASSWORD);
+    if (listening) {
+        // Back from parked mode: routes and the listening socket are still in place
+        started = true;
+        LOG_INFO("Access point restarted");
+        return;
+    }
+    PDUBoot::mark(BOOT_WIFI_READY);
+    setupRoutes();
+    etagEpoch = esp_random();
+    const char* headerKeys[] = { "Cookie", "If-None-Match" };
+    server.collectHeaders(headerKeys, 2);
     server.begin();
-    Serial.print("AP IP address: ");
-    Serial.println(WiFi.softAPIP());
+    listening = true;
+    started = true;
+    PDUBoot::mark(BOOT_HTTP_READY);
+    LOG_INFO("AP IP address: %s", WiFi.softAPIP().toString().c_str());
+    LOG_INFO("HTTP server started");
+}
+
+void PDUWebServer::beginAsync() {
+    // Bring up the AP off the control path; handleClient() is a no-op until it is done
+    xTaskCreate(initTask, "pdu_web_init", WEB_INIT_TASK_STACK, this, tskIDLE_PRIORITY + 1, nullptr);
+}
+
+void PDUWebServer::suspend() {
+    started = false;
+    WiFi.softAPdisconnect(true);
+    WiFi.mode(WIFI_OFF);
+}
+
+void PDUWebServer::initTask(void* param) {
+    static_cast<PDUWebServer*>(param)->begin();
+    vTaskDelete(nullptr);
 }
 
 void PDUWebServer::handleClient() {
+    if (!started) return;
     server.handleClient();
 }
 
 void PDUWebServer::setupRoutes() {
     server.on("/", [this]() { handleRoot(); });
+    server.on("/api/login", HTTP_POST, [this]() { handleApiLogin(); });
+    server.on("/api/logout", HTTP_POST, [this]() { handleApiLogout(); });
     server.on("/api/status", HTTP_GET, [this]() { handleApiStatus(); });
     server.on("/api/control", HTTP_POST, [this]() { handleApiControl(); });
     server.on("/api/setTemp", HTTP_POST, [this]() { handleApiSetTemp(); });
     server.on("/api/setTime", HTTP_POST, [this]() { handleApiSetTime(); });
+    server.on("/api/events", HTTP_GET, [this]() { handleApiEvents(); });
+    server.on("/api/sequence", HTTP_GET, [this]() { handleApiGetSequence(); });
+    server.on("/api/sequence", HTTP_POST, [this]() { handleApiSetSequence(); });
+    server.on("/api/boot", HTTP_GET, [this]() { handleApiBoot(); });
+    server.on("/api/heap", HTTP_GET, [this]() { handleApiHeap(); });
+    server.on("/api/park", HTTP_GET, [this]() { handleApiGetPark(); });
+    server.on("/api/park", HTTP_POST, [this]() { handleApiSetPark(); });
+    server.on("/api/mqtt", HTTP_GET, [this]() { handleApiGetMqtt(); });
+    server.on("/api/mqtt", HTTP_POST, [this]() { handleApiSetMqtt(); });
+    server.on("/api/rules", HTTP_GET, [this]() { handleApiGetRules(); });
+    server.on("/api/rules", HTTP_POST, [this]() { handleApiSetRules(); });
+    server.on("/api/journal", HTTP_GET, [this]() { handleApiJournal(); });
+    server.on("/api/trace", HTTP_GET, [this]() { handleApiGetTrace(); });
+    server.on("/api/trace", HTTP_POST, [this]() { handleApiSetTrace(); });
+    server.on("/api/command", HTTP_GET, [this]() { handleApiCommand(); });
 }
 
 bool PDUWebServer::authenticate() {
+    // A valid session token skips the basic-auth decode entirely
+    char tokenHex[SESSION_TOKEN_HEX_LENGTH + 1];
+    sessionAuthenticated = getSessionToken(tokenHex) && sessions.validate(tokenHex);
+    if (sessionAuthenticated) return true;
+
     if (!server.authenticate(HTTP_USERNAME, HTTP_PASSWORD)) {
         server.requestAuthentication();
         return false;
@@ -47,63 +116,250 @@ bool PDUWebServer::authenticate() {
     return true;
 }
 
+// True at the start of a cookie list or right after a "; " separator, so that the
+// name does not match inside another cookie's (e.g. XPDUSESSION=)
+static bool isCookieStart(const char* header, const char* position) {
+    return position == header || (position - header >= 2 && position[-2] == ';' && position[-1] == ' ');
+}
+
+// Copies the token following prefix (at the start of any cookie in header, or only at its start)
+static bool extractToken(const char* header, const char* prefix, bool anywhere, char* tokenHex) {
+    const char* start = header;
+    if (anywhere) {
+        start = strstr(header, prefix);
+        while (start != nullptr && !isCookieStart(header, start)) start = strstr(start + 1, prefix);
+    }
+    if (start == nullptr || strncmp(start, prefix, strlen(prefix)) != 0) return false;
+
+    start += strlen(prefix);
+    if (strlen(start) < SESSION_TOKEN_HEX_LENGTH) return false;
+    memcpy(tokenHex, start, SESSION_TOKEN_HEX_LENGTH);
+    tokenHex[SESSION_TOKEN_HEX_LENGTH] = '\0';
+    return true;
+}
+
+bool PDUWebServer::getSessionToken(char* tokenHex) {
+    // Cookie: ...; PDUSESSION=<hex>  or  Authorization: Bearer <hex>
+    return extractToken(server.header("Cookie").c_str(), SESSION_COOKIE "=", true, tokenHex) ||
+           extractToken(server.header("Authorization").c_str(), "Bearer ", false, tokenHex);
+}
+
+void PDUWebServer::issueSession(char* tokenHex) {
+    sessions.create(tokenHex);
+    char cookie[96];
+    snprintf(cookie, sizeof(cookie), SESSION_COOKIE "=%s; Path=/; HttpOnly; SameSite=Strict; Max-Age=%lu",
+             tokenHex, (unsigned long)(SESSION_TIMEOUT / 1000));
+    server.sendHeader("Set-Cookie", cookie);
+}
+
+void PDUWebServer::beginJson(int code) {
+    jsonLength = 0;
+    jsonCode = code;
+    jsonChunked = false;
+    jsonBuffer[0] = '\0';
+}
+
+void PDUWebServer::appendJson(const char* format, ...) {
+    // A fragment that does not fit flushes the buffer as a chunk and is retried once
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t space = sizeof(jsonBuffer) - jsonLength;
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(jsonBuffer + jsonLength, space, format, args);
+        va_end(args);
+
+        if (written < 0) return;
+        if ((size_t)written < space) {
+            jsonLength += written;
+            return;
+        }
+        if (jsonLength == 0) break;
+        flushJson();
+    }
+    LOG_WARN("HTTP response fragment larger than %d bytes dropped", JSON_BUFFER_SIZE);
+}
+
+void PDUWebServer::flushJson() {
+    if (!jsonChunked) {
+        server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+        server.send(jsonCode, "application/json");
+        jsonChunked = true;
+    }
+    server.sendContent(jsonBuffer, jsonLength);
+    jsonLength = 0;
+    jsonBuffer[0] = '\0';
+}
+
+void PDUWebServer::sendJson() {
+    if (!jsonChunked) {
+        server.send(jsonCode, "application/json", jsonBuffer);
+        return;
+    }
+    if (jsonLength > 0) flushJson();
+    server.sendContent("", 0);
+}
+
 void PDUWebServer::handleRoot() {
     if (!authenticate()) return;
+
+    // The dashboard's status polls then ride on the session cookie
+    if (!sessionAuthenticated) {
+        char tokenHex[SESSION_TOKEN_HEX_LENGTH + 1];
+        issueSession(tokenHex);
+    }
     server.send(200, "text/html", INDEX_HTML);
 }
 
-String PDUWebServer::createJsonResponse() {
-    String jsonResponse = "{";
-    jsonResponse += "\"f1\":" + String(digitalRead(F1_PIN)) + ",";
-    jsonResponse += "\"f2\":" + String(digitalRead(F2_PIN)) + ",";
-    jsonResponse += "\"f3\":" + String(digitalRead(F3_PIN)) + ",";
-    jsonResponse += "\"f4\":" + String(digitalRead(F4_PIN)) + ",";
-    jsonResponse += "\"ign\":" + String(digitalRead(IGN_PIN)) + ",";
-    jsonResponse += "\"temp\":" + String(pdu.getCurrentTemp()) + ",";
-    jsonResponse += "\"tempThreshold\":" + String(pdu.getTempThreshold()) + ",";
-    jsonResponse += "\"battery\":" + String(pdu.getBatteryVoltage()) + ",";
-    jsonResponse += "\"relay\":" + String(pdu.getRelayState()) + ",";
-    jsonResponse += "\"timeThreshold\":" + String(pdu.getTimeThreshold()) + ",";
-    jsonResponse += "\"ch1\":" + String(pdu.getChannelState(1)) + ",";
-    jsonResponse += "\"ch2\":" + String(pdu.getChannelState(2)) + ",";
-    jsonResponse += "\"ch3\":" + String(pdu.getChannelState(3)) + ",";
-    jsonResponse += "\"ch4\":" + String(pdu.getChannelState(4));
-    jsonResponse += "}";
-    return jsonResponse;
+void PDUWebServer::handleApiLogin() {
+    if (!authenticate()) return;
+
+    char tokenHex[SESSION_TOKEN_HEX_LENGTH + 1];
+    issueSession(tokenHex);
+    beginJson();
+    appendJson("{\"success\":true,\"token\":\"%s\",\"expiresIn\":%lu}",
+               tokenHex, (unsigned long)(SESSION_TIMEOUT / 1000));
+    sendJson();
+}
+
+void PDUWebServer::handleApiLogout() {
+    char tokenHex[SESSION_TOKEN_HEX_LENGTH + 1];
+    if (getSessionToken(tokenHex)) sessions.remove(tokenHex);
+    server.sendHeader("Set-Cookie", SESSION_COOKIE "=; Path=/; HttpOnly; Max-Age=0");
+    server.send(200, "application/json", 
+        "{\"success\":true,\"message\":\"Logged out\"}");
+}
+
+// /api/status fields, in response order; ?fields= selects a subset by name
+static const char* const STATUS_FIELDS[] = {
+    "f1", "f2", "f3", "f4", "ign", "temp", "tempThreshold", "battery", "relay", "timeThreshold",
+    "ch1", "ch2", "ch3", "ch4", "vpTrips", "vpTripLatencyUs", "vpTripMaxLatencyUs", "vpLocked"
+};
+static const uint8_t STATUS_FIELD_COUNT = sizeof(STATUS_FIELDS) / sizeof(STATUS_FIELDS[0]);
+static const uint32_t STATUS_ALL_FIELDS = (1UL << STATUS_FIELD_COUNT) - 1;
+
+// Returns the field mask for a comma-separated list of names (0 if none is known)
+static uint32_t parseStatusFields(const char* list) {
+    uint32_t mask = 0;
+    while (*list) {
+        const char* end = strchr(list, ',');
+        size_t length = end ? (size_t)(end - list) : strlen(list);
+        for (uint8_t i = 0; i < STATUS_FIELD_COUNT; i++) {
+            if (strlen(STATUS_FIELDS[i]) == length && strncmp(STATUS_FIELDS[i], list, length) == 0) {
+                mask |= 1UL << i;
+            }
+        }
+        list += length;
+        if (*list == ',') list++;
+    }
+    return mask;
+}
+
+// If-None-Match may list several tags or be "*"
+static bool etagMatches(const char* ifNoneMatch, const char* etag) {
+    return strstr(ifNoneMatch, etag) != nullptr || strcmp(ifNoneMatch, "*") == 0;
+}
+
+void PDUWebServer::createJsonResponse(uint32_t fields) {
+    const PDUStatus& status = pdu.getStatus();
+    beginJson();
+    bool first = true;
+    for (uint8_t i = 0; i < STATUS_FIELD_COUNT; i++) {
+        if (!(fields & (1UL << i))) continue;
+        const char* separator = first ? "{" : ",";
+        first = false;
+        switch (i) {
+            case 0: case 1: case 2: case 3:
+                appendJson("%s\"%s\":%d", separator, STATUS_FIELDS[i], status.fuses[i]);
+                break;
+            case 4:  appendJson("%s\"ign\":%d", separator, status.ign); break;
+            case 5:  appendJson("%s\"temp\":%.2f", separator, status.temp); break;
+            case 6:  appendJson("%s\"tempThreshold\":%.2f", separator, status.tempThreshold); break;
+            case 7:  appendJson("%s\"battery\":%.2f", separator, status.battery); break;
+            case 8:  appendJson("%s\"relay\":%d", separator, status.relay); break;
+            case 9:  appendJson("%s\"timeThreshold\":%lu", separator, (unsigned long)status.timeThreshold); break;
+            case 10: case 11: case 12: case 13:
+                appendJson("%s\"%s\":%d", separator, STATUS_FIELDS[i], status.channels[i - 10]);
+                break;
+            case 14: appendJson("%s\"vpTrips\":%lu", separator, (unsigned long)status.vpTrips); break;
+            case 15: appendJson("%s\"vpTripLatencyUs\":%lu", separator, (unsigned long)status.vpTripLatencyUs); break;
+            case 16: appendJson("%s\"vpTripMaxLatencyUs\":%lu", separator, (unsigned long)status.vpTripMaxLatencyUs); break;
+            case 17: appendJson("%s\"vpLocked\":%d", separator, status.vpLocked); break;
+        }
+    }
+    appendJson("}");
 }
 
 void PDUWebServer::handleApiStatus() {
     if (!authenticate()) return;
-    server.send(200, "application/json", createJsonResponse());
+
+    uint32_t fields = STATUS_ALL_FIELDS;
+    if (server.hasArg("fields")) {
+        fields = parseStatusFields(server.arg("fields").c_str());
+        if (fields == 0) {
+            server.send(400, "application/json",
+                "{\"success\":false,\"message\":\"No known fields\"}");
+            return;
+        }
+    }
+
+    // The ETag changes with every visible state change; the epoch keeps it unique across reboots
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%08lx-%lx\"", (unsigned long)etagEpoch,
+             (unsigned long)pdu.getStateVersion());
+    server.sendHeader("ETag", etag);
+    server.sendHeader("Cache-Control", "no-cache");
+
+    if (etagMatches(server.header("If-None-Match").c_str(), etag)) {
+        server.send(304);
+        return;
+    }
+
+    createJsonResponse(fields);
+    sendJson();
 }
 
 void PDUWebServer::handleApiControl() {
     if (!authenticate()) return;
 
     if (server.hasArg("device") && server.hasArg("state")) {
-        String device = server.arg("device");
+        char device[8];
+        snprintf(device, sizeof(device), "%s", server.arg("device").c_str());
         int state = server.arg("state").toInt();
-        bool success = false;
-        String message = "";
+        uint32_t ticket = 0;
+        bool valid = false;
+        char message[40] = "";
+        char command[16] = "";
 
         if (state == 0 || state == 1) {
-            if (device.startsWith("CH") && device.length() == 3) {
-                int channel = device.substring(2).toInt();
+            if (strncmp(device, "CH", 2) == 0 && strlen(device) == 3) {
+                int channel = atoi(device + 2);
                 if (channel >= 1 && channel <= 4) {
-                    pdu.setChannel(channel, state == 0);
-                    success = true;
-                    message = device + " set to " + String(state == 0 ? "ON" : "OFF");
+                    valid = true;
+                    ticket = PDUCommandQueue::setChannel(channel, state == 0);
+                    snprintf(command, sizeof(command), "SET_CH%d:%d", channel, state);
+                    snprintf(message, sizeof(message), "%s set to %s", device, state == 0 ? "ON" : "OFF");
                 }
-            } else if (device == "RELAY") {
-                pdu.setRelayFlag(state == 1);
-                success = true;
-                message = "RelayFlag set to " + String(state == 1 ? "ON" : "OFF");
+            } else if (strcmp(device, "RELAY") == 0) {
+                valid = true;
+                ticket = PDUCommandQueue::setRelayFlag(state == 1);
+                snprintf(command, sizeof(command), "SET_RELAY:%d", state);
+                snprintf(message, sizeof(message), "RelayFlag set to %s", state == 1 ? "ON" : "OFF");
+            } else if (strcmp(device, "VPLOCK") == 0 && state == 0) {
+                valid = true;
+                ticket = PDUCommandQueue::clearVpLockout();
+                snprintf(command, sizeof(command), "SET_VPLOCK:0");
+                snprintf(message, sizeof(message), "VP lockout cleared");
             }
         }
 
-        server.send(200, "application/json", 
-            "{\"success\":" + String(success ? "true" : "false") + 
-            ",\"message\":\"" + message + "\"}");
+        if (!valid) {
+            beginJson();
+            appendJson("{\"success\":false,\"message\":\"\"}");
+            sendJson();
+            return;
+        }
+        if (ticket != 0) PDUTrace::recordCommand(command);
+        sendQueued(ticket, message);
     } else {
         server.send(400, "application/json", 
             "{\"success\":false,\"message\":\"Missing parameters\"}");
@@ -115,9 +371,9 @@ void PDUWebServer::handleApiSetTemp() {
 
     if (server.hasArg("value")) {
         float temp = server.arg("value").toFloat();
-        pdu.setTempThreshold(temp);
-        server.send(200, "application/json", 
-            "{\"success\":true,\"message\":\"Temperature threshold updated\"}");
+        uint32_t ticket = PDUCommandQueue::setTempThreshold(temp);
+        if (ticket != 0) PDUTrace::recordCommand("SET_TSTemp:", server.arg("value").c_str());
+        sendQueued(ticket, "Temperature threshold updated");
     } else {
         server.send(400, "application/json", 
             "{\"success\":false,\"message\":\"Missing value parameter\"}");
@@ -129,11 +385,361 @@ void PDUWebServer::handleApiSetTime() {
 
     if (server.hasArg("value")) {
         unsigned long time = server.arg("value").toFloat() * 60000;
-        pdu.setTimeThreshold(time);
-        server.send(200, "application/json", 
-            "{\"success\":true,\"message\":\"Time threshold updated\"}");
+        uint32_t ticket = PDUCommandQueue::setTimeThreshold(time);
+        if (ticket != 0) PDUTrace::recordCommand("SET_TSTime:", server.arg("value").c_str());
+        sendQueued(ticket, "Time threshold updated");
     } else {
         server.send(400, "application/json", 
             "{\"success\":false,\"message\":\"Missing value parameter\"}");
     }
 }
+
+// Mutations are applied by the controller on its next tick; the ticket can be polled on /api/command
+void PDUWebServer::sendQueued(uint32_t ticket, const char* message) {
+    if (ticket == 0) {
+        server.send(503, "application/json",
+            "{\"success\":false,\"message\":\"Command queue full\"}");
+        return;
+    }
+    beginJson();
+    appendJson("{\"success\":true,\"message\":\"%s\",\"ticket\":%lu}", message, (unsigned long)ticket);
+    sendJson();
+}
+
+void PDUWebServer::handleApiCommand() {
+    if (!authenticate()) return;
+
+    if (!server.hasArg("ticket")) {
+        server.send(400, "application/json",
+            "{\"success\":false,\"message\":\"Missing ticket parameter\"}");
+        return;
+    }
+
+    uint32_t ticket = strtoul(server.arg("ticket").c_str(), nullptr, 10);
+    beginJson();
+    appendJson("{\"ticket\":%lu,\"status\":\"%s\"}", (unsigned long)ticket,
+               PDUCommandQueue::getStatusName(PDUCommandQueue::getResult(ticket)));
+    sendJson();
+}
+
+void PDUWebServer::handleApiEvents() {
+    if (!authenticate()) return;
+
+    uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), nullptr, 10) : 0;
+    PDUEvent events[EVENT_MAX_PER_REQUEST];
+    uint32_t next;
+    size_t count = PDUEventLog::read(since, events, EVENT_MAX_PER_REQUEST, next);
+
+    beginJson();
+    appendJson("{\"next\":%lu,\"events\":[", (unsigned long)next);
+    for (size_t i = 0; i < count; i++) {
+        appendJson("%s{\"seq\":%lu,\"t\":%lu,\"pin\":%u,\"level\":%u}", i > 0 ? "," : "",
+                   (unsigned long)events[i].seq, (unsigned long)events[i].timestampUs,
+                   events[i].pin, events[i].level);
+    }
+    appendJson("]}");
+    sendJson();
+}
+
+void PDUWebServer::handleApiGetSequence() {
+    if (!authenticate()) return;
+
+    beginJson();
+    appendJson("{\"lastMs\":%lu,\"running\":%d,\"steps\":[", pdu.getLastSequenceTime(),
+               pdu.isSequenceRunning() ? 1 : 0);
+    for (uint8_t channel = 2; channel <= 4; channel++) {
+        const SequenceStep& step = pdu.getSequenceStep(channel);
+        appendJson("%s{\"ch\":%u,\"delay\":%lu,\"deps\":%u,\"stable\":%lu,\"timeout\":%lu}",
+                   channel > 2 ? "," : "", channel, (unsigned long)step.delayMs, step.dependsOn,
+                   (unsigned long)step.stableMs, (unsigned long)step.timeoutMs);
+    }
+    appendJson("]}");
+    sendJson();
+}
+
+void PDUWebServer::handleApiSetSequence() {
+    if (!authenticate()) return;
+
+    if (!server.hasArg("ch")) {
+        server.send(400, "application/json", 
+            "{\"success\":false,\"message\":\"Missing ch parameter\"}");
+        return;
+    }
+
+    int channel = server.arg("ch").toInt();
+    if (channel < 2 || channel > 4) {
+        server.send(400, "application/json", 
+            "{\"success\":false,\"message\":\"ch must be 2-4\"}");
+        return;
+    }
+
+    // Parameters that are not given keep their current value
+    SequenceStep step = pdu.getSequenceStep(channel);
+    if (server.hasArg("delay")) step.delayMs = server.arg("delay").toInt();
+    if (server.hasArg("deps")) {
+        // Range-checked before narrowing: 256 must not turn into "no dependencies"
+        long deps = server.arg("deps").toInt();
+        if (deps < 0 || deps > 0x0F) {
+            server.send(400, "application/json",
+                "{\"success\":false,\"message\":\"Invalid dependencies\"}");
+            return;
+        }
+        step.dependsOn = deps;
+    }
+    if (server.hasArg("stable")) step.stableMs = server.arg("stable").toInt();
+    if (server.hasArg("timeout")) step.timeoutMs = server.arg("timeout").toInt();
+
+    // Validated against the current profile here; the controller checks again when applying
+    if (pdu.isSequenceStepValid(channel, step)) {
+        uint32_t ticket = PDUCommandQueue::setSequenceStep(channel, step);
+        if (ticket != 0) {
+            char command[48];
+            snprintf(command, sizeof(command), "SET_SEQ%d:%lu,%u,%lu,%lu", channel, (unsigned long)step.delayMs,
+                     step.dependsOn, (unsigned long)step.stableMs, (unsigned long)step.timeoutMs);
+            PDUTrace::recordCommand(command);
+        }
+        sendQueued(ticket, "Sequence updated");
+    } else {
+        server.send(400, "application/json", 
+            "{\"success\":false,\"message\":\"Invalid dependencies\"}");
+    }
+}
+
+void PDUWebServer::handleApiBoot() {
+    if (!authenticate()) return;
+
+    beginJson();
+    for (int phase = 0; phase < BOOT_PHASE_COUNT; phase++) {
+        appendJson("%s\"%s\":%lu", phase > 0 ? "," : "{", PDUBoot::getPhaseName((BootPhase)phase),
+                   (unsigned long)PDUBoot::getPhaseTime((BootPhase)phase));
+    }
+    appendJson(",\"reset\":\"%s\",\"warm\":%s,\"warmBoots\":%u}",
+               PDUWarmState::getResetReasonName(PDUWarmState::getResetReason()),
+               PDUWarmState::isWarmBoot() ? "true" : "false", PDUWarmState::getWarmBoots());
+    sendJson();
+}
+
+void PDUWebServer::handleApiHeap() {
+    if (!authenticate()) return;
+
+    beginJson();
+    appendJson("{\"free\":%lu,\"minFree\":%lu,\"maxAlloc\":%lu,",
+               (unsigned long)PDUHeap::getFree(), (unsigned long)PDUHeap::getMinFree(),
+               (unsigned long)PDUHeap::getLargestBlock());
+    appendJson("\"tracing\":%s,\"allocs\":%lu,\"tickAllocs\":%lu,\"maxTickAllocs\":%lu,"
+               "\"allocTicks\":%lu,\"ticks\":%lu}",
+               PDUHeap::isTracing() ? "true" : "false", (unsigned long)PDUHeap::getAllocCount(),
+               (unsigned long)PDUHeap::getLastTickAllocs(), (unsigned long)PDUHeap::getMaxTickAllocs(),
+               (unsigned long)PDUHeap::getAllocTicks(), (unsigned long)PDUHeap::getTickCount());
+    sendJson();
+}
+
+void PDUWebServer::handleApiGetPark() {
+    if (!authenticate()) return;
+
+    const ParkStats& stats = PDUParkMode::getStats();
+    beginJson();
+    appendJson("{\"enabled\":%s,\"wakeInterval\":%.9g,\"sleep\":\"%s\",",
+               pdu.getParkEnabled() ? "true" : "false", pdu.getParkWakeInterval() / 60000.0,
+               PDUParkMode::usesDeepSleep() ? "deep" : "light");
+    appendJson("\"parks\":%lu,\"ignWakes\":%lu,\"timerWakes\":%lu,\"asleep\":%lu,\"awake\":%lu,"
+               "\"battery\":%.2f,",
+               (unsigned long)stats.parks, (unsigned long)stats.ignWakes, (unsigned long)stats.timerWakes,
+               (unsigned long)(stats.sleepUs / 1000000), (unsigned long)(stats.awakeUs / 1000000), stats.battery);
+    appendJson("\"currentUa\":%lu,\"activeCurrentUa\":%lu,\"wakeToRelayUs\":%lu,\"maxWakeToRelayUs\":%lu}",
+               (unsigned long)PDUParkMode::getEstimatedCurrent(), (unsigned long)PARK_ACTIVE_CURRENT,
+               (unsigned long)stats.lastWakeToRelayUs, (unsigned long)stats.maxWakeToRelayUs);
+    sendJson();
+}
+
+void PDUWebServer::handleApiSetPark() {
+    if (!authenticate()) return;
+
+    if (!server.hasArg("enabled")) {
+        server.send(400, "application/json",
+            "{\"success\":false,\"message\":\"Missing enabled parameter\"}");
+        return;
+    }
+    bool enabled = server.arg("enabled").toInt() == 1;
+    uint32_t interval = server.hasArg("wakeInterval") ? server.arg("wakeInterval").toFloat() * 60000 + 0.5
+                                                      : pdu.getParkWakeInterval();
+    uint32_t ticket = PDUCommandQueue::setParkMode(enabled, interval);
+    if (ticket != 0) {
+        char command[48];
+        snprintf(command, sizeof(command), "SET_PARK:%d,%.9g", enabled ? 1 : 0, interval / 60000.0);
+        PDUTrace::recordCommand(command);
+    }
+    sendQueued(ticket, "Parked mode updated");
+}
+
+void PDUWebServer::handleApiGetMqtt() {
+    if (!authenticate()) return;
+
+    TelemetryConfig config;
+    PDUTelemetry::getConfig(config);
+    TelemetryStats stats;
+    PDUTelemetry::getStats(stats);
+    beginJson();
+    appendJson("{\"broker\":\"%s\",\"port\":%u,\"batchPeriod\":%.9g,\"batchSamples\":%u,\"state\":\"%s\","
+               "\"clientId\":\"%s\",",
+               config.broker, config.port, config.batchPeriod / 1000.0, config.batchSamples,
+               PDUTelemetry::getStateName(PDUTelemetry::getState()), PDUTelemetry::getClientId());
+    appendJson("\"samples\":%lu,\"events\":%lu,\"batches\":%lu,\"published\":%lu,\"spooled\":%u,"
+               "\"spoolBytes\":%lu,\"dropped\":%lu,\"connects\":%lu,",
+               (unsigned long)stats.samples, (unsigned long)stats.events, (unsigned long)stats.batches,
+               (unsigned long)stats.published, PDUTelemetry::getSpooledBatches(),
+               (unsigned long)PDUTelemetry::getSpooledBytes(), (unsigned long)stats.dropped,
+               (unsigned long)stats.connects);
+    appendJson("\"payloadBytes\":%lu,\"wireBytes\":%lu,\"bytesPerSample\":%.2f}",
+               (unsigned long)stats.payloadBytes, (unsigned long)stats.wireBytes,
+               stats.publishedSamples > 0 ? (float)stats.wireBytes / stats.publishedSamples : 0.0f);
+    sendJson();
+}
+
+void PDUWebServer::handleApiSetMqtt() {
+    if (!authenticate()) return;
+
+    // Parameters that are not given keep their current value; an empty broker switches publishing off
+    TelemetryConfig config;
+    PDUTelemetry::getConfig(config);
+    if (server.hasArg("broker")) {
+        snprintf(config.broker, sizeof(config.broker), "%s", server.arg("broker").c_str());
+    }
+    if (server.hasArg("port")) {
+        long port = server.arg("port").toInt();
+        config.port = port > 0 && port <= 0xFFFF ? port : 0;
+    }
+    if (server.hasArg("batchPeriod")) {
+        float periodS = server.arg("batchPeriod").toFloat();
+        config.batchPeriod = periodS > 0 ? periodS * 1000 + 0.5f : 0;
+    }
+    if (server.hasArg("batchSamples")) {
+        long samples = server.arg("batchSamples").toInt();
+        config.batchSamples = samples > 0 && samples <= 0xFFFF ? samples : 0;
+    }
+
+    if (!PDUTelemetry::configure(config)) {
+        server.send(400, "application/json",
+            "{\"success\":false,\"message\":\"Invalid MQTT settings\"}");
+        return;
+    }
+    server.send(200, "application/json", "{\"success\":true,\"message\":\"MQTT settings updated\"}");
+}
+
+void PDUWebServer::handleApiGetRules() {
+    if (!authenticate()) return;
+
+    const PDURulesEngine& rules = pdu.getRules();
+    beginJson();
+    appendJson("{\"loaded\":%s,\"rules\":%u,\"instructions\":%u,\"maxInstructions\":%d,",
+               rules.isLoaded() ? "true" : "false", rules.getRuleCount(), rules.getCodeSize(),
+               RULES_MAX_CODE);
+    appendJson("\"evalUs\":%lu,\"evalMaxUs\":%lu,\"tickUs\":%lu,\"tickMaxUs\":%lu,\"source\":\"",
+               (unsigned long)rules.getLastEvalTime(), (unsigned long)rules.getMaxEvalTime(),
+               (unsigned long)pdu.getLastTickTime(), (unsigned long)pdu.getMaxTickTime());
+
+    // Escape the program text in small pieces
+    char escaped[64];
+    size_t length = 0;
+    for (const char* c = rules.getSource(); *c; c++) {
+        if (*c == '"' || *c == '\\') escaped[length++] = '\\';
+        if (*c == '\n') {
+            escaped[length++] = '\\';
+            escaped[length++] = 'n';
+        } else {
+            escaped[length++] = (*c == '\r' || *c == '\t') ? ' ' : *c;
+        }
+        if (length >= sizeof(escaped) - 3) {
+            escaped[length] = '\0';
+            appendJson("%s", escaped);
+            length = 0;
+        }
+    }
+    escaped[length] = '\0';
+    appendJson("%s\"}", escaped);
+    sendJson();
+}
+
+void PDUWebServer::handleApiSetRules() {
+    if (!authenticate()) return;
+
+    // Form field "rules", or the raw text/plain body; an empty program restores the built-in policy
+    if (!server.hasArg("rules") && !server.hasArg("plain")) {
+        server.send(400, "application/json", 
+            "{\"success\":false,\"message\":\"Missing rules parameter\"}");
+        return;
+    }
+
+    char error[64];
+    const char* field = server.hasArg("rules") ? "rules" : "plain";
+    if (pdu.loadRules(server.arg(field).c_str(), error, sizeof(error))) {
+        PDUTrace::recordCommand("SET_RULES:", pdu.getRules().getSource());
+        server.send(200, "application/json", 
+            "{\"success\":true,\"message\":\"Rules loaded\"}");
+    } else {
+        beginJson(400);
+        appendJson("{\"success\":false,\"message\":\"%s\"}", error);
+        sendJson();
+    }
+}
+
+void PDUWebServer::handleApiJournal() {
+    if (!authenticate()) return;
+
+    // Without "since" the latest "count" records are returned
+    uint32_t next = PDUJournal::getNextSeq();
+    uint32_t count = server.hasArg("count") ? strtoul(server.arg("count").c_str(), nullptr, 10)
+                                            : JOURNAL_MAX_PER_REQUEST;
+    if (count == 0 || count > JOURNAL_MAX_PER_REQUEST) count = JOURNAL_MAX_PER_REQUEST;
+    uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), nullptr, 10)
+                                            : (next > count ? next - count : 0);
+
+    JournalRecord records[JOURNAL_MAX_PER_REQUEST];
+    size_t found = PDUJournal::read(since, records, count, next);
+
+    beginJson();
+    appendJson("{\"mounted\":%s,\"boot\":%lu,\"oldest\":%lu,\"next\":%lu,\"capacity\":%lu,"
+               "\"erases\":%lu,\"dropped\":%lu,\"vpLocked\":%s,\"records\":[",
+               PDUJournal::isMounted() ? "true" : "false", (unsigned long)PDUJournal::getBootCount(),
+               (unsigned long)PDUJournal::getOldestSeq(), (unsigned long)next,
+               (unsigned long)PDUJournal::getCapacity(), (unsigned long)PDUJournal::getEraseCount(),
+               (unsigned long)PDUJournal::getDroppedCount(), pdu.isCh1Locked() ? "true" : "false");
+    for (size_t i = 0; i < found; i++) {
+        const JournalRecord& record = records[i];
+        appendJson("%s{\"seq\":%lu,\"boot\":%lu,\"t\":%lu,\"type\":\"%s\",\"value\":%ld,\"value2\":%ld}",
+                   i > 0 ? "," : "", (unsigned long)record.seq, (unsigned long)record.bootCount,
+                   (unsigned long)record.timeMs, PDUJournal::getTypeName(record.type), (long)record.value,
+                   (long)record.value2);
+    }
+    appendJson("]}");
+    sendJson();
+}
+
+void PDUWebServer::handleApiGetTrace() {
+    if (!authenticate()) return;
+
+    // Raw recording, as read by tools/replay
+    server.sendHeader("Content-Disposition", "attachment; filename=\"pdu.trace\"");
+    server.send(200, "application/octet-stream", (const char*)PDUTrace::getData(), PDUTrace::getSize());
+}
+
+void PDUWebServer::handleApiSetTrace() {
+    if (!authenticate()) return;
+
+    if (!server.hasArg("action")) {
+        server.send(400, "application/json", 
+            "{\"success\":false,\"message\":\"Missing action parameter\"}");
+        return;
+    }
+
+    // action=start begins a new recording (discarding the previous one), action=stop ends it
+    bool start = strcmp(server.arg("action").c_str(), "start") == 0;
+    if (start) pdu.startTrace();
+    else pdu.stopTrace();
+
+    beginJson();
+    appendJson("{\"success\":true,\"recording\":%s,\"bytes\":%u,\"truncated\":%s}",
+               PDUTrace::isRecording() ? "true" : "false", (unsigned)PDUTrace::getSize(),
+               PDUTrace::isTruncated() ? "true" : "false");
+    sendJson();
+}
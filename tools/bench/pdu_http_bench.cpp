@@ -0,0 +1,534 @@
+/*
+ * PDU HTTP Load Benchmark
+ *
+ * Drives /api/status, /api/control and / on a PDUWebServer (normally the
+ * host build, tools/build/pdu_host) at a configurable concurrency and
+ * request rate. Connections are reused when the server allows it. Every
+ * report interval it prints throughput, p50/p99/p999 latency, error rate
+ * and the server's free heap and heap low-water mark (from /api/heap).
+ *
+ * With --rate, requests are scheduled open-loop and latency is measured
+ * from the scheduled send time, so a stalled server shows up as latency
+ * instead of silently lowering the offered load.
+ *
+ * Usage:
+ *   pdu_http_bench [options]
+ *     --host HOST            Server address (default 127.0.0.1)
+ *     --port N               Server port (default 8080)
+ *     --user NAME            HTTP user (default admin)
+ *     --pass PASSWORD        HTTP password (default password)
+ *     --concurrency N        Parallel connections (default 4)
+ *     --rate N               Total requests/s, 0 = as fast as possible (default 0)
+ *     --duration S           Test length in seconds (default 30)
+ *     --interval S           Report interval in seconds (default 5)
+ *     --mix status=N,control=N,root=N  Request weights (default 8,1,1)
+ *     --timeout MS           Per-request timeout (default 5000)
+ *     --no-keep-alive        Open a new connection for every request
+ *     --session              Log in once (/api/login) and send a bearer token
+ *     --conditional          Send If-None-Match with the last status ETag (304s count as success)
+ *     --fields LIST          Request only these /api/status fields (?fields=LIST)
+ *     --max-error-rate F     Exit with status 1 if the error rate exceeds F
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+enum RequestKind { REQ_STATUS, REQ_CONTROL, REQ_ROOT, REQ_HEAP, REQ_KIND_COUNT };
+
+static const char* KIND_NAMES[] = { "status", "control", "root", "heap" };
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::string user = "admin";
+    std::string pass = "password";
+    int concurrency = 4;
+    double rate = 0;
+    double duration = 30;
+    double interval = 5;
+    int weights[3] = { 8, 1, 1 };
+    long timeoutUs = 5000000;
+    bool keepAlive = true;
+    bool session = false;
+    bool conditional = false;
+    std::string fields;
+    double maxErrorRate = -1;
+};
+
+struct Stats {
+    std::vector<long> latencies;
+    unsigned long requests = 0;
+    unsigned long errors = 0;
+    unsigned long perKind[REQ_KIND_COUNT] = {};
+    unsigned long notModified = 0;
+    unsigned long statusBytes = 0;  // Status response bytes including headers
+
+    void reset() {
+        latencies.clear();
+        requests = errors = notModified = statusBytes = 0;
+        memset(perKind, 0, sizeof(perKind));
+    }
+
+    long percentile(double p) {
+        if (latencies.empty()) return 0;
+        size_t index = std::min(latencies.size() - 1, (size_t)(p * latencies.size()));
+        std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+        return latencies[index];
+    }
+};
+
+struct Connection {
+    enum State { IDLE, CONNECTING, SENDING, RECEIVING } state = IDLE;
+    int fd = -1;
+    RequestKind kind = REQ_STATUS;
+    long intendedStart = 0;
+    long deadline = 0;
+    std::string out;
+    size_t outSent = 0;
+    std::string in;
+    std::string etag;       // Last status ETag seen on this connection (--conditional)
+    unsigned long connects = 0;
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static long nowUs() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string base64(const std::string& in) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < in.size(); i += 3) {
+        uint32_t v = (uint8_t)in[i] << 16;
+        if (i + 1 < in.size()) v |= (uint8_t)in[i + 1] << 8;
+        if (i + 2 < in.size()) v |= (uint8_t)in[i + 2];
+        out += table[v >> 18 & 63];
+        out += table[v >> 12 & 63];
+        out += i + 1 < in.size() ? table[v >> 6 & 63] : '=';
+        out += i + 2 < in.size() ? table[v & 63] : '=';
+    }
+    return out;
+}
+
+static long jsonNumber(const std::string& body, const char* key) {
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = body.find(pattern);
+    return pos == std::string::npos ? -1 : atol(body.c_str() + pos + pattern.size());
+}
+
+class HttpBench {
+public:
+    explicit HttpBench(const Options& options)
+        : options(options)
+        , auth("Basic " + base64(options.user + ":" + options.pass))
+        , connections(options.concurrency)
+        , rng(12345)
+    {
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(options.port);
+        hostent* host = gethostbyname(options.host.c_str());
+        if (host) memcpy(&addr.sin_addr, host->h_addr, sizeof(addr.sin_addr));
+    }
+
+    int run() {
+        if (options.session && !login()) {
+            fprintf(stderr, "login failed\n");
+            return 1;
+        }
+
+        long start = nowUs();
+        long end = start + (long)(options.duration * 1e6);
+        long nextReport = start + (long)(options.interval * 1e6);
+        long nextSchedule = start;
+        long heapDue = start;
+
+        printf("%8s %8s %9s %9s %9s %9s %7s %9s %9s\n",
+               "t_s", "reqs", "req/s", "p50_ms", "p99_ms", "p999_ms", "err_%", "heap_free", "heap_min");
+
+        while (!stopRequested) {
+            long now = nowUs();
+            if (now >= end && allIdle()) break;
+
+            if (now >= nextReport) {
+                report(interval, (now - start) / 1e6, options.interval, false);
+                interval.reset();
+                nextReport += (long)(options.interval * 1e6);
+            }
+
+            // Issue new requests on idle connections
+            for (Connection& conn : connections) {
+                if (conn.state != Connection::IDLE || now >= end) continue;
+                if (options.rate > 0 && now < nextSchedule) break;
+
+                RequestKind kind = pickKind();
+                if (now >= heapDue) {
+                    kind = REQ_HEAP;
+                    heapDue = now + (long)(options.interval * 1e6 / 2);
+                }
+                long intended = options.rate > 0 ? nextSchedule : now;
+                if (options.rate > 0) nextSchedule += (long)(1e6 / options.rate);
+                startRequest(conn, kind, intended, now);
+            }
+
+            std::vector<pollfd> fds;
+            std::vector<Connection*> owners;
+            for (Connection& conn : connections) {
+                if (conn.state == Connection::IDLE) continue;
+                pollfd pfd = { conn.fd, (short)(conn.state == Connection::RECEIVING ? POLLIN : POLLOUT), 0 };
+                fds.push_back(pfd);
+                owners.push_back(&conn);
+            }
+
+            long wake = std::min(nextReport, end);
+            if (options.rate > 0) wake = std::min(wake, std::max(now, nextSchedule));
+            for (Connection* conn : owners) wake = std::min(wake, conn->deadline);
+            int waitMs = (int)std::max(0L, (wake - now + 999) / 1000);
+            if (fds.empty() && now >= end) break;
+
+            if (poll(fds.data(), fds.size(), waitMs) < 0 && errno != EINTR) break;
+
+            now = nowUs();
+            for (size_t i = 0; i < fds.size(); i++) {
+                Connection& conn = *owners[i];
+                if (fds[i].revents) service(conn, now);
+                else if (now >= conn.deadline) fail(conn);
+            }
+        }
+
+        double elapsed = (nowUs() - start) / 1e6;
+        printf("\nsummary:\n");
+        report(total, elapsed, elapsed, true);
+        unsigned long connects = 0;
+        for (Connection& conn : connections) connects += conn.connects;
+        printf("requests: status=%lu control=%lu root=%lu heap=%lu, connections opened=%lu\n",
+               total.perKind[REQ_STATUS], total.perKind[REQ_CONTROL], total.perKind[REQ_ROOT],
+               total.perKind[REQ_HEAP], connects);
+        printf("heap: minimum-ever free %ld bytes, lowest sampled free %ld bytes\n", heapMinFree, heapLowestFree);
+        if (total.perKind[REQ_STATUS]) {
+            printf("status: %lu not modified (%.1f%%), %.0f bytes/response\n", total.notModified,
+                   100.0 * total.notModified / total.perKind[REQ_STATUS],
+                   (double)total.statusBytes / total.perKind[REQ_STATUS]);
+        }
+
+        double errorRate = total.requests ? (double)total.errors / total.requests : 0;
+        if (options.maxErrorRate >= 0 && errorRate > options.maxErrorRate) {
+            fprintf(stderr, "error rate %.4f exceeds limit %.4f\n", errorRate, options.maxErrorRate);
+            return 1;
+        }
+        return 0;
+    }
+
+private:
+    const Options& options;
+    std::string auth;
+    sockaddr_in addr = {};
+    std::vector<Connection> connections;
+    std::mt19937 rng;
+    Stats interval;
+    Stats total;
+    long heapFree = -1;
+    long heapMinFree = -1;
+    long heapLowestFree = -1;
+
+    bool login() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            return false;
+        }
+        std::string request = "POST /api/login HTTP/1.1\r\nHost: " + options.host + "\r\n"
+                              "Authorization: " + auth + "\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+        send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+
+        std::string response;
+        char buffer[1024];
+        ssize_t n;
+        while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) response.append(buffer, n);
+        close(fd);
+
+        size_t pos = response.find("\"token\":\"");
+        if (pos == std::string::npos) return false;
+        pos += 9;
+        auth = "Bearer " + response.substr(pos, response.find('"', pos) - pos);
+        return true;
+    }
+
+    bool allIdle() const {
+        for (const Connection& conn : connections) {
+            if (conn.state != Connection::IDLE) return false;
+        }
+        return true;
+    }
+
+    RequestKind pickKind() {
+        int sum = options.weights[0] + options.weights[1] + options.weights[2];
+        int r = std::uniform_int_distribution<int>(0, std::max(sum, 1) - 1)(rng);
+        if (r < options.weights[0]) return REQ_STATUS;
+        if (r < options.weights[0] + options.weights[1]) return REQ_CONTROL;
+        return REQ_ROOT;
+    }
+
+    void startRequest(Connection& conn, RequestKind kind, long intended, long now) {
+        static const char* paths[] = { "/api/status", "/api/control?device=CH4&state=0", "/", "/api/heap" };
+        const char* method = kind == REQ_CONTROL ? "POST" : "GET";
+        std::string path = paths[kind];
+        std::string conditional;
+        if (kind == REQ_STATUS) {
+            if (!options.fields.empty()) path += "?fields=" + options.fields;
+            if (options.conditional && !conn.etag.empty()) conditional = "If-None-Match: " + conn.etag + "\r\n";
+        }
+
+        conn.kind = kind;
+        conn.intendedStart = intended;
+        conn.deadline = now + options.timeoutUs;
+        conn.out = std::string(method) + " " + path + " HTTP/1.1\r\n"
+                   "Host: " + options.host + "\r\n"
+                   "Authorization: " + auth + "\r\n" + conditional +
+                   "Connection: " + (options.keepAlive ? "keep-alive" : "close") + "\r\n"
+                   "Content-Length: 0\r\n\r\n";
+        conn.outSent = 0;
+        conn.in.clear();
+
+        if (conn.fd >= 0) {
+            conn.state = Connection::SENDING;
+            return;
+        }
+
+        conn.fd = socket(AF_INET, SOCK_STREAM, 0);
+        fcntl(conn.fd, F_SETFL, O_NONBLOCK);
+        int one = 1;
+        setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        conn.connects++;
+        conn.state = Connection::CONNECTING;
+        if (connect(conn.fd, (sockaddr*)&addr, sizeof(addr)) == 0) conn.state = Connection::SENDING;
+        else if (errno != EINPROGRESS) fail(conn);
+    }
+
+    void service(Connection& conn, long now) {
+        if (conn.state == Connection::CONNECTING) {
+            int error = 0;
+            socklen_t len = sizeof(error);
+            getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &error, &len);
+            if (error) {
+                fail(conn);
+                return;
+            }
+            conn.state = Connection::SENDING;
+        }
+
+        if (conn.state == Connection::SENDING) {
+            ssize_t n = send(conn.fd, conn.out.data() + conn.outSent, conn.out.size() - conn.outSent, MSG_NOSIGNAL);
+            if (n < 0) {
+                // A reused connection the server already closed: retry once on a fresh one
+                if (errno != EAGAIN) retryOnNewConnection(conn, now);
+                return;
+            }
+            conn.outSent += n;
+            if (conn.outSent == conn.out.size()) conn.state = Connection::RECEIVING;
+            return;
+        }
+
+        char buffer[4096];
+        ssize_t n = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn.in.append(buffer, n);
+            checkComplete(conn, now, false);
+        } else if (n == 0) {
+            checkComplete(conn, now, true);
+        } else if (errno != EAGAIN) {
+            if (conn.in.empty()) retryOnNewConnection(conn, now);
+            else fail(conn);
+        }
+    }
+
+    void retryOnNewConnection(Connection& conn, long now) {
+        bool reused = conn.connects > 0 && conn.in.empty() && conn.outSent < conn.out.size();
+        closeConnection(conn);
+        if (!reused) {
+            fail(conn);
+            return;
+        }
+        startRequest(conn, conn.kind, conn.intendedStart, now);
+    }
+
+    void checkComplete(Connection& conn, long now, bool eof) {
+        size_t headerEnd = conn.in.find("\r\n\r\n");
+        if (headerEnd == std::string::npos) {
+            if (eof) {
+                if (conn.in.empty()) retryOnNewConnection(conn, now);
+                else fail(conn);
+            }
+            return;
+        }
+
+        std::string headers = conn.in.substr(0, headerEnd);
+        long contentLength = -1;
+        bool serverCloses = false;
+        size_t pos = 0;
+        while ((pos = headers.find("\r\n", pos)) != std::string::npos) {
+            pos += 2;
+            if (strncasecmp(headers.c_str() + pos, "Content-Length:", 15) == 0) {
+                contentLength = atol(headers.c_str() + pos + 15);
+            } else if (strncasecmp(headers.c_str() + pos, "ETag:", 5) == 0 && conn.kind == REQ_STATUS) {
+                size_t lineEnd = headers.find("\r\n", pos);
+                conn.etag = headers.substr(pos + 6, lineEnd == std::string::npos ? std::string::npos : lineEnd - pos - 6);
+            } else if (strncasecmp(headers.c_str() + pos, "Connection:", 11) == 0) {
+                serverCloses = strcasestr(headers.c_str() + pos, "close") == headers.c_str() + pos + 12;
+            }
+        }
+
+        size_t bodyLength = conn.in.size() - headerEnd - 4;
+        if (contentLength >= 0 ? bodyLength < (size_t)contentLength : !eof) {
+            if (eof) fail(conn);
+            return;
+        }
+
+        int status = 0;
+        sscanf(conn.in.c_str(), "HTTP/%*s %d", &status);
+        bool notModified = status == 304 && conn.kind == REQ_STATUS;
+        if (conn.kind == REQ_STATUS) {
+            for (Stats* stats : { &interval, &total }) {
+                stats->statusBytes += headerEnd + 4 + bodyLength;
+                if (notModified) stats->notModified++;
+            }
+        }
+        record(conn, now, !notModified && (status < 200 || status >= 300));
+
+        if (conn.kind == REQ_HEAP && status == 200) {
+            std::string body = conn.in.substr(headerEnd + 4);
+            heapFree = jsonNumber(body, "free");
+            long minFree = jsonNumber(body, "minFree");
+            if (minFree >= 0) heapMinFree = minFree;
+            if (heapFree >= 0 && (heapLowestFree < 0 || heapFree < heapLowestFree)) heapLowestFree = heapFree;
+        }
+
+        if (serverCloses || eof || !options.keepAlive) closeConnection(conn);
+        conn.state = Connection::IDLE;
+    }
+
+    void record(Connection& conn, long now, bool error) {
+        for (Stats* stats : { &interval, &total }) {
+            stats->perKind[conn.kind]++;
+            if (conn.kind == REQ_HEAP) continue;
+            stats->requests++;
+            if (error) stats->errors++;
+            else stats->latencies.push_back(now - conn.intendedStart);
+        }
+    }
+
+    void fail(Connection& conn) {
+        record(conn, nowUs(), true);
+        closeConnection(conn);
+        conn.state = Connection::IDLE;
+    }
+
+    void closeConnection(Connection& conn) {
+        if (conn.fd >= 0) close(conn.fd);
+        conn.fd = -1;
+    }
+
+    void report(Stats& stats, double t, double seconds, bool summary) {
+        double errorPct = stats.requests ? 100.0 * stats.errors / stats.requests : 0;
+        long p50 = stats.percentile(0.50), p99 = stats.percentile(0.99), p999 = stats.percentile(0.999);
+        printf("%8.1f %8lu %9.1f %9.2f %9.2f %9.2f %7.2f %9ld %9ld\n", t, stats.requests,
+               seconds > 0 ? stats.requests / seconds : 0.0, p50 / 1000.0, p99 / 1000.0, p999 / 1000.0,
+               errorPct, heapFree, heapMinFree);
+        if (!summary) fflush(stdout);
+    }
+};
+
+static bool parseMix(const char* text, Options& options) {
+    int weights[3] = { 0, 0, 0 };
+    std::string mix = text;
+    size_t start = 0;
+    while (start < mix.size()) {
+        size_t end = mix.find(',', start);
+        if (end == std::string::npos) end = mix.size();
+        std::string item = mix.substr(start, end - start);
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string name = item.substr(0, eq);
+        int weight = atoi(item.c_str() + eq + 1);
+        bool known = false;
+        for (int kind = 0; kind < 3; kind++) {
+            if (name == KIND_NAMES[kind]) {
+                weights[kind] = weight;
+                known = true;
+            }
+        }
+        if (!known) return false;
+        start = end + 1;
+    }
+    memcpy(options.weights, weights, sizeof(weights));
+    return true;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: pdu_http_bench [--host H] [--port N] [--user U] [--pass P] [--concurrency N]\n"
+                    "                      [--rate N] [--duration S] [--interval S] [--mix status=8,control=1,root=1]\n"
+                    "                      [--timeout MS] [--no-keep-alive] [--session] [--conditional]\n"
+                    "                      [--fields LIST] [--max-error-rate F]\n");
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--no-keep-alive") options.keepAlive = false;
+        else if (arg == "--session") options.session = true;
+        else if (arg == "--conditional") options.conditional = true;
+        else if (arg == "--fields" && hasValue) options.fields = argv[++i];
+        else if (arg == "--host" && hasValue) options.host = argv[++i];
+        else if (arg == "--port" && hasValue) options.port = atoi(argv[++i]);
+        else if (arg == "--user" && hasValue) options.user = argv[++i];
+        else if (arg == "--pass" && hasValue) options.pass = argv[++i];
+        else if (arg == "--concurrency" && hasValue) options.concurrency = std::max(1, atoi(argv[++i]));
+        else if (arg == "--rate" && hasValue) options.rate = atof(argv[++i]);
+        else if (arg == "--duration" && hasValue) options.duration = atof(argv[++i]);
+        else if (arg == "--interval" && hasValue) options.interval = std::max(0.1, atof(argv[++i]));
+        else if (arg == "--timeout" && hasValue) options.timeoutUs = atol(argv[++i]) * 1000;
+        else if (arg == "--max-error-rate" && hasValue) options.maxErrorRate = atof(argv[++i]);
+        else if (arg == "--mix" && hasValue) {
+            if (!parseMix(argv[++i], options)) {
+                usage();
+                return 1;
+            }
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    signal(SIGINT, [](int) { stopRequested = 1; });
+    signal(SIGPIPE, SIG_IGN);
+
+    HttpBench bench(options);
+    return bench.run();
+}
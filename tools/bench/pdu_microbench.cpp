@@ -0,0 +1,230 @@
+/*
+ * PDU Microbenchmark Runner
+ *
+ * Runs the firmware's PDUMicrobench suite (src/pdu_microbench.cpp) on the
+ * host build against simulated hardware in real time, prints ns/op,
+ * allocations/op and stack depth per case, and compares them with a
+ * baseline file. The run fails when a case is slower or deeper than the
+ * baseline by more than the threshold, or allocates more at all.
+ *
+ * Without a baseline file the results are saved as the new baseline.
+ * Host timings depend on the machine, so the baseline is kept per build
+ * directory rather than in the repository. A fixed reference loop is timed
+ * before and after the suite and ns/op is compared relative to it, so a
+ * shared or throttled host slowing the whole run does not read as a
+ * regression. The suite is also run several times and each case keeps its
+ * fastest round, since host noise comes in bursts longer than one case,
+ * and a failing run is repeated in a fresh process before it is reported:
+ * memory placement alone can slow a whole process on a shared host.
+ *
+ * Firmware serial output goes to stdout, the report to stderr.
+ *
+ * Usage:
+ *   pdu_microbench [options]
+ *     --baseline FILE        Baseline file (default build/microbench.baseline)
+ *     --save                 Overwrite the baseline with this run
+ *     --threshold PCT        Allowed ns/op and stack growth (default 20)
+ *     --min-time-ms N        Timed run per case (default BENCH_MIN_TIME)
+ *     --rounds N             Suite runs; each case keeps its fastest (default 5)
+ *     --attempts N           Processes to try before reporting a failure (default 3)
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include <Arduino.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <map>
+#include <vector>
+#include <string>
+#include "pdu_config.h"
+#include "pdu_controller.h"
+#include "pdu_web_server.h"
+#include "pdu_microbench.h"
+#include "sim_hardware.h"
+
+void setup();
+
+extern PDUController pdu;
+extern PDUWebServer webServer;
+
+struct Baseline {
+    double nsPerOp;
+    double allocsPerOp;
+    unsigned long stackBytes;
+};
+
+static const char* REFERENCE_NAME = "reference";
+
+// Fixed integer work that does not depend on the firmware
+static void __attribute__((noinline)) referenceKernel() {
+    static volatile uint32_t sink;
+    uint32_t x = sink | 1;
+    for (int i = 0; i < 256; i++) x = x * 1103515245u + 12345u;
+    sink = x;
+}
+
+static double timeReference() {
+    const uint32_t iterations = 20000;
+    double best = 0;
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+        uint32_t start = ESP.getCycleCount();
+        for (uint32_t i = 0; i < iterations; i++) referenceKernel();
+        double ns = (ESP.getCycleCount() - start) * 1000.0 / getCpuFrequencyMhz() / iterations;
+        if (repeat == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+static bool loadBaseline(const char* path, std::map<std::string, Baseline>& baseline) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+
+    char line[160];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') continue;
+        char name[64];
+        Baseline entry;
+        if (sscanf(line, "%63s %lf %lf %lu", name, &entry.nsPerOp, &entry.allocsPerOp, &entry.stackBytes) == 4) {
+            baseline[name] = entry;
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static bool saveBaseline(const char* path, const BenchResult* results, size_t count, double reference) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    fprintf(file, "# pdu_microbench baseline: case ns/op allocs/op stack-bytes\n");
+    fprintf(file, "%s %.1f 0 0\n", REFERENCE_NAME, reference);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(file, "%s %.1f %.3f %lu\n", results[i].name, results[i].nsPerOp, results[i].allocsPerOp,
+                (unsigned long)results[i].stackBytes);
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* baselinePath = "build/microbench.baseline";
+    bool save = false;
+    double threshold = 20;
+    uint32_t minTimeMs = BENCH_MIN_TIME;
+    int rounds = 5;
+    int attempts = 3;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--save") == 0) save = true;
+        else if (strcmp(argv[i], "--baseline") == 0 && hasValue) baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && hasValue) threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--min-time-ms") == 0 && hasValue) minTimeMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--rounds") == 0 && hasValue) rounds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--attempts") == 0 && hasValue) attempts = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: pdu_microbench [--baseline FILE] [--save] [--threshold PCT] "
+                            "[--min-time-ms N] [--rounds N] [--attempts N]\n");
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    setenv("PDU_PORT_OFFSET", "38000", 0);
+
+    SimHardware::setPin(F1_PIN, HIGH);
+    SimHardware::setPin(F2_PIN, HIGH);
+    SimHardware::setPin(F3_PIN, HIGH);
+    SimHardware::setPin(F4_PIN, HIGH);
+    SimHardware::setPin(VP_PIN, LOW);
+    SimHardware::setPin(IGN_PIN, HIGH);
+    SimHardware::setAnalog(BAT_PIN, 1185);
+    SimHardware::setTemperature(25.0f);
+
+    setup();
+
+    BenchResult results[PDUMicrobench::CASE_COUNT];
+    BenchResult round[PDUMicrobench::CASE_COUNT];
+    double reference = timeReference();
+    size_t count = PDUMicrobench::run(pdu, webServer, results, minTimeMs);
+    for (int r = 1; r < rounds; r++) {
+        PDUMicrobench::run(pdu, webServer, round, minTimeMs);
+        for (size_t i = 0; i < count; i++) {
+            if (round[i].nsPerOp < results[i].nsPerOp) results[i].nsPerOp = round[i].nsPerOp;
+        }
+    }
+    double after = timeReference();
+    if (after < reference) reference = after;
+
+    std::map<std::string, Baseline> baseline;
+    bool haveBaseline = !save && loadBaseline(baselinePath, baseline);
+    int regressions = 0;
+
+    // Scale the baseline timings to this run's machine speed
+    double speed = 1;
+    auto baseReference = baseline.find(REFERENCE_NAME);
+    if (baseReference != baseline.end() && baseReference->second.nsPerOp > 0) {
+        speed = reference / baseReference->second.nsPerOp;
+    }
+    fprintf(stderr, "reference %.1f ns/op (%.2fx baseline)\n", reference, speed);
+
+    fprintf(stderr, "%-12s %10s %10s %8s %10s  %s\n", "case", "ns/op", "allocs/op", "stack", "iters",
+            haveBaseline ? "vs baseline" : "");
+    for (size_t i = 0; i < count; i++) {
+        const BenchResult& result = results[i];
+        char verdict[96] = "";
+        auto entry = baseline.find(result.name);
+        if (haveBaseline && entry != baseline.end()) {
+            const Baseline& base = entry->second;
+            double change = base.nsPerOp > 0 ? (result.nsPerOp / (base.nsPerOp * speed) - 1) * 100 : 0;
+            bool slower = change > threshold;
+            bool allocates = result.allocsPerOp > base.allocsPerOp + 0.0005;
+            bool deeper = result.stackBytes > base.stackBytes * (1 + threshold / 100) + 16;
+            snprintf(verdict, sizeof(verdict), "%+6.1f%% %s%s%s", change, slower ? " SLOWER" : "",
+                     allocates ? " ALLOCATES" : "", deeper ? " DEEPER" : "");
+            if (slower || allocates || deeper) regressions++;
+        } else if (haveBaseline) {
+            snprintf(verdict, sizeof(verdict), "new");
+        }
+        fprintf(stderr, "%-12s %10.1f %10.3f %8lu %10lu  %s\n", result.name, result.nsPerOp,
+                result.allocsPerOp, (unsigned long)result.stackBytes, (unsigned long)result.iterations,
+                verdict);
+    }
+
+    // Firmware tasks are still running, so leave without static destructors
+    int status = 0;
+    if (!haveBaseline) {
+        if (saveBaseline(baselinePath, results, count, reference)) {
+            fprintf(stderr, "[microbench] baseline saved to %s\n", baselinePath);
+        } else {
+            fprintf(stderr, "[microbench] cannot write %s\n", baselinePath);
+            status = 1;
+        }
+    } else if (regressions > 0 && attempts > 1) {
+        fprintf(stderr, "[microbench] %d case(s) regressed, repeating in a new process\n", regressions);
+        fflush(stdout);
+        fflush(stderr);
+        std::vector<char*> args(argv, argv + argc);
+        char remaining[12];
+        snprintf(remaining, sizeof(remaining), "%d", attempts - 1);
+        args.push_back((char*)"--attempts");
+        args.push_back(remaining);
+        args.push_back(nullptr);
+        execv("/proc/self/exe", args.data());
+        fprintf(stderr, "[microbench] cannot restart: %s\n", strerror(errno));
+        status = 1;
+    } else if (regressions > 0) {
+        fprintf(stderr, "[microbench] FAIL: %d case(s) regressed beyond %.0f%% (baseline %s)\n", regressions,
+                threshold, baselinePath);
+        status = 1;
+    } else {
+        fprintf(stderr, "[microbench] PASS (threshold %.0f%%, baseline %s)\n", threshold, baselinePath);
+    }
+    fflush(stdout);
+    _exit(status);
+}
@@ -0,0 +1,19 @@
+#!/bin/sh
+#
+# Builds the host firmware and the HTTP benchmark, runs the firmware with
+# simulated hardware on a private port and benchmarks it. Extra arguments
+# are passed to pdu_http_bench; the script exits with its status.
+#
+#   tools/bench/run_http_bench.sh --duration 60 --concurrency 8 --max-error-rate 0.001
+
+set -e
+cd "$(dirname "$0")/.."
+make -s build/pdu_host build/pdu_http_bench
+
+PORT_OFFSET=${PDU_PORT_OFFSET:-18000}
+PDU_PORT_OFFSET=$PORT_OFFSET ./build/pdu_host < /dev/null > build/pdu_host.log 2>&1 &
+HOST_PID=$!
+trap 'kill $HOST_PID 2>/dev/null' EXIT INT TERM
+sleep 1
+
+./build/pdu_http_bench --port $((PORT_OFFSET + 80)) "$@"
@@ -0,0 +1,417 @@
+/*
+ * PDU Fleet Collector
+ *
+ * Host-side tool that polls /api/status on many PDUs concurrently from a
+ * single poll() event loop. Each device has its own request timeout and
+ * exponential backoff after failures. Results are normalized into one CSV
+ * stream on stdout; control commands can be fanned out to every device
+ * before polling starts. Throughput (devices/s) is reported on stderr.
+ *
+ * Usage:
+ *   pdu_fleet [options] host[:port] ...
+ *     --targets FILE      Read additional host[:port] entries (one per line)
+ *     --user NAME         HTTP user (default admin)
+ *     --pass PASSWORD     HTTP password (default password)
+ *     --rounds N          Status polls per device, 0 = until interrupted (default 1)
+ *     --interval MS       Delay between polls of one device (default 2000)
+ *     --timeout MS        Per-request timeout (default 2000)
+ *     --concurrency N     Maximum requests in flight (default 64)
+ *     --control DEV=STATE Send /api/control to every device first (repeatable)
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const char* STATUS_FIELDS[] = {
+    "f1", "f2", "f3", "f4", "ign", "temp", "tempThreshold", "battery",
+    "relay", "timeThreshold", "ch1", "ch2", "ch3", "ch4"
+};
+
+static const long BACKOFF_BASE_MS = 500;
+static const long BACKOFF_MAX_MS = 60000;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static long nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static long wallMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+static std::string base64(const std::string& in) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    size_t i = 0;
+    for (; i + 2 < in.size(); i += 3) {
+        uint32_t v = (uint8_t)in[i] << 16 | (uint8_t)in[i + 1] << 8 | (uint8_t)in[i + 2];
+        out += table[v >> 18 & 63]; out += table[v >> 12 & 63];
+        out += table[v >> 6 & 63]; out += table[v & 63];
+    }
+    if (i + 1 == in.size()) {
+        uint32_t v = (uint8_t)in[i] << 16;
+        out += table[v >> 18 & 63]; out += table[v >> 12 & 63]; out += "==";
+    } else if (i + 2 == in.size()) {
+        uint32_t v = (uint8_t)in[i] << 16 | (uint8_t)in[i + 1] << 8;
+        out += table[v >> 18 & 63]; out += table[v >> 12 & 63]; out += table[v >> 6 & 63]; out += '=';
+    }
+    return out;
+}
+
+// Extracts the raw value of "key" from a flat JSON object (numbers/booleans only)
+static std::string jsonField(const std::string& body, const char* key) {
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = body.find(pattern);
+    if (pos == std::string::npos) return "";
+    pos += pattern.size();
+    size_t end = body.find_first_of(",}", pos);
+    return body.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+}
+
+struct Request {
+    std::string path;
+    std::string method;
+};
+
+struct Device {
+    std::string name;
+    sockaddr_storage addr;
+    socklen_t addrLen;
+
+    enum State { IDLE, CONNECTING, SENDING, RECEIVING } state = IDLE;
+    int fd = -1;
+    long startTime = 0;
+    long deadline = 0;
+    long nextAttempt = 0;
+    int failures = 0;
+    int polls = 0;
+    std::deque<Request> controls;
+    Request current;
+    std::string out;
+    size_t outSent = 0;
+    std::string in;
+};
+
+struct Options {
+    std::string user = "admin";
+    std::string pass = "password";
+    int rounds = 1;
+    long interval = 2000;
+    long timeout = 2000;
+    size_t concurrency = 64;
+};
+
+static bool resolve(const std::string& target, Device& device) {
+    std::string host = target;
+    std::string port = "80";
+    size_t colon = target.rfind(':');
+    if (colon != std::string::npos) {
+        host = target.substr(0, colon);
+        port = target.substr(colon + 1);
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || !result) return false;
+
+    memcpy(&device.addr, result->ai_addr, result->ai_addrlen);
+    device.addrLen = result->ai_addrlen;
+    device.name = target;
+    freeaddrinfo(result);
+    return true;
+}
+
+class FleetCollector {
+public:
+    FleetCollector(std::vector<Device>& devices, const Options& options)
+        : devices(devices)
+        , options(options)
+        , auth(base64(options.user + ":" + options.pass))
+    {
+    }
+
+    void run() {
+        long start = nowMs();
+        printf("time_ms,device,status,latency_ms");
+        for (const char* field : STATUS_FIELDS) printf(",%s", field);
+        printf("\n");
+
+        while (!stopRequested && !finished()) {
+            long now = nowMs();
+            for (Device& device : devices) {
+                if (device.state == Device::IDLE && inFlight < options.concurrency &&
+                    now >= device.nextAttempt && !done(device)) {
+                    startRequest(device, now);
+                }
+            }
+
+            std::vector<pollfd> fds;
+            std::vector<Device*> owners;
+            long wake = now + 1000;
+            for (Device& device : devices) {
+                if (device.state == Device::IDLE) {
+                    if (!done(device) && device.nextAttempt < wake) wake = device.nextAttempt;
+                    continue;
+                }
+                pollfd pfd = { device.fd, 0, 0 };
+                pfd.events = device.state == Device::RECEIVING ? POLLIN : POLLOUT;
+                fds.push_back(pfd);
+                owners.push_back(&device);
+                if (device.deadline < wake) wake = device.deadline;
+            }
+
+            int wait = (int)std::max(0L, wake - now);
+            int ready = poll(fds.data(), fds.size(), wait);
+            if (ready < 0 && errno != EINTR) break;
+
+            now = nowMs();
+            for (size_t i = 0; i < fds.size(); i++) {
+                Device& device = *owners[i];
+                if (fds[i].revents) service(device, fds[i].revents, now);
+                else if (now >= device.deadline) fail(device, now, "timeout");
+            }
+        }
+
+        double seconds = (nowMs() - start) / 1000.0;
+        fprintf(stderr, "%lu responses, %lu failures in %.2f s (%.1f devices/s)\n",
+                successes, failures, seconds, seconds > 0 ? successes / seconds : 0.0);
+    }
+
+private:
+    std::vector<Device>& devices;
+    const Options& options;
+    std::string auth;
+    size_t inFlight = 0;
+    unsigned long successes = 0;
+    unsigned long failures = 0;
+
+    bool done(const Device& device) const {
+        return device.controls.empty() && options.rounds > 0 && device.polls >= options.rounds;
+    }
+
+    bool finished() const {
+        for (const Device& device : devices) {
+            if (device.state != Device::IDLE || !done(device)) return false;
+        }
+        return true;
+    }
+
+    void startRequest(Device& device, long now) {
+        device.current = device.controls.empty() ? Request{ "/api/status", "GET" } : device.controls.front();
+        device.out = device.current.method + " " + device.current.path + " HTTP/1.0\r\n"
+                     "Host: " + device.name + "\r\n"
+                     "Authorization: Basic " + auth + "\r\n"
+                     "Content-Length: 0\r\n\r\n";
+        device.outSent = 0;
+        device.in.clear();
+        device.startTime = now;
+        device.deadline = now + options.timeout;
+
+        device.fd = socket(device.addr.ss_family, SOCK_STREAM, 0);
+        if (device.fd < 0) {
+            fail(device, now, "socket");
+            return;
+        }
+        fcntl(device.fd, F_SETFL, O_NONBLOCK);
+        int one = 1;
+        setsockopt(device.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        inFlight++;
+        device.state = Device::CONNECTING;
+        if (connect(device.fd, (sockaddr*)&device.addr, device.addrLen) == 0) {
+            device.state = Device::SENDING;
+        } else if (errno != EINPROGRESS) {
+            fail(device, now, "connect");
+        }
+    }
+
+    void service(Device& device, short revents, long now) {
+        if (device.state == Device::CONNECTING) {
+            int error = 0;
+            socklen_t len = sizeof(error);
+            getsockopt(device.fd, SOL_SOCKET, SO_ERROR, &error, &len);
+            if (error != 0) {
+                fail(device, now, "connect");
+                return;
+            }
+            device.state = Device::SENDING;
+        }
+
+        if (device.state == Device::SENDING) {
+            ssize_t n = send(device.fd, device.out.data() + device.outSent,
+                             device.out.size() - device.outSent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno != EAGAIN) fail(device, now, "send");
+                return;
+            }
+            device.outSent += n;
+            if (device.outSent == device.out.size()) device.state = Device::RECEIVING;
+            return;
+        }
+
+        char buffer[2048];
+        ssize_t n = recv(device.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            device.in.append(buffer, n);
+            return;
+        }
+        if (n < 0 && errno == EAGAIN) return;
+        if (n < 0 || (revents & POLLERR)) {
+            fail(device, now, "recv");
+            return;
+        }
+        complete(device, now);
+    }
+
+    void complete(Device& device, long now) {
+        close(device.fd);
+        device.fd = -1;
+        device.state = Device::IDLE;
+        inFlight--;
+
+        int status = 0;
+        sscanf(device.in.c_str(), "HTTP/%*s %d", &status);
+        if (status != 200) {
+            char reason[32];
+            snprintf(reason, sizeof(reason), "http_%d", status);
+            fail(device, now, reason, false);
+            return;
+        }
+
+        device.failures = 0;
+        successes++;
+        if (!device.controls.empty()) {
+            device.controls.pop_front();
+            device.nextAttempt = now;
+            return;
+        }
+
+        size_t bodyStart = device.in.find("\r\n\r\n");
+        std::string body = bodyStart == std::string::npos ? "" : device.in.substr(bodyStart + 4);
+        printf("%ld,%s,ok,%ld", wallMs(), device.name.c_str(), now - device.startTime);
+        for (const char* field : STATUS_FIELDS) printf(",%s", jsonField(body, field).c_str());
+        printf("\n");
+        fflush(stdout);
+
+        device.polls++;
+        device.nextAttempt = device.startTime + options.interval;
+    }
+
+    void fail(Device& device, long now, const char* reason, bool open = true) {
+        if (open) {
+            if (device.fd >= 0) close(device.fd);
+            device.fd = -1;
+            if (device.state != Device::IDLE) inFlight--;
+            device.state = Device::IDLE;
+        }
+
+        failures++;
+        printf("%ld,%s,%s,%ld", wallMs(), device.name.c_str(), reason, now - device.startTime);
+        for (size_t i = 0; i < sizeof(STATUS_FIELDS) / sizeof(STATUS_FIELDS[0]); i++) printf(",");
+        printf("\n");
+        fflush(stdout);
+
+        // A failed poll still counts as one round so finite runs terminate
+        if (device.controls.empty()) device.polls++;
+        else device.controls.pop_front();
+
+        long backoff = BACKOFF_BASE_MS << std::min(device.failures, 7);
+        device.failures++;
+        device.nextAttempt = now + std::min(backoff, BACKOFF_MAX_MS);
+    }
+};
+
+static void usage() {
+    fprintf(stderr, "usage: pdu_fleet [--targets FILE] [--user U] [--pass P] [--rounds N] [--interval MS]\n"
+                    "                 [--timeout MS] [--concurrency N] [--control DEV=STATE] host[:port] ...\n");
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<std::string> targets;
+    std::vector<Request> controls;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--targets" && hasValue) {
+            std::ifstream file(argv[++i]);
+            std::string line;
+            while (std::getline(file, line)) {
+                if (!line.empty() && line[0] != '#') targets.push_back(line);
+            }
+        }
+        else if (arg == "--user" && hasValue) options.user = argv[++i];
+        else if (arg == "--pass" && hasValue) options.pass = argv[++i];
+        else if (arg == "--rounds" && hasValue) options.rounds = atoi(argv[++i]);
+        else if (arg == "--interval" && hasValue) options.interval = atol(argv[++i]);
+        else if (arg == "--timeout" && hasValue) options.timeout = atol(argv[++i]);
+        else if (arg == "--concurrency" && hasValue) options.concurrency = std::max(1, atoi(argv[++i]));
+        else if (arg == "--control" && hasValue) {
+            std::string command = argv[++i];
+            size_t eq = command.find('=');
+            if (eq == std::string::npos) {
+                usage();
+                return 1;
+            }
+            controls.push_back({ "/api/control?device=" + command.substr(0, eq) +
+                                 "&state=" + command.substr(eq + 1), "POST" });
+        }
+        else if (arg[0] == '-') {
+            usage();
+            return 1;
+        }
+        else targets.push_back(arg);
+    }
+
+    if (targets.empty()) {
+        usage();
+        return 1;
+    }
+
+    std::vector<Device> devices;
+    devices.reserve(targets.size());
+    for (const std::string& target : targets) {
+        Device device;
+        if (!resolve(target, device)) {
+            fprintf(stderr, "cannot resolve %s\n", target.c_str());
+            continue;
+        }
+        device.controls.assign(controls.begin(), controls.end());
+        devices.push_back(device);
+    }
+
+    signal(SIGINT, [](int) { stopRequested = 1; });
+    signal(SIGPIPE, SIG_IGN);
+
+    FleetCollector collector(devices, options);
+    collector.run();
+    return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * PDU Fleet Simulator
+ *
+ * Host-side stand-in for many PDUs, used to exercise pdu_fleet without
+ * hardware. Listens on a range of local ports, one per simulated device,
+ * and answers /api/status and /api/control with the same JSON shape as
+ * the firmware. Response delay and failure rate are configurable.
+ *
+ * Usage:
+ *   pdu_sim [--base-port N] [--count N] [--delay MS] [--fail-rate P]
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct SimDevice {
+    int listenFd;
+    int port;
+    bool channels[4] = { true, true, true, true };
+    bool relayFlag = true;
+    float temp = 25.0f;
+};
+
+struct Connection {
+    int fd;
+    SimDevice* device;
+    std::string in;
+    std::string out;
+    size_t outSent = 0;
+    long respondAt = 0;
+};
+
+static long nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string queryArg(const std::string& path, const std::string& name) {
+    size_t pos = path.find(name + "=");
+    if (pos == std::string::npos) return "";
+    pos += name.size() + 1;
+    return path.substr(pos, path.find('&', pos) - pos);
+}
+
+static std::string handle(SimDevice& device, const std::string& request, double failRate) {
+    if ((double)rand() / RAND_MAX < failRate) {
+        return "HTTP/1.0 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+    }
+
+    std::string path = request.substr(request.find(' ') + 1);
+    path = path.substr(0, path.find(' '));
+    std::string body;
+
+    if (path.rfind("/api/status", 0) == 0) {
+        device.temp += ((rand() % 21) - 10) / 100.0f;
+        char json[512];
+        snprintf(json, sizeof(json),
+                 "{\"f1\":1,\"f2\":1,\"f3\":1,\"f4\":1,\"ign\":1,\"temp\":%.2f,\"tempThreshold\":65.00,"
+                 "\"battery\":%.2f,\"relay\":%d,\"timeThreshold\":300000,"
+                 "\"ch1\":%d,\"ch2\":%d,\"ch3\":%d,\"ch4\":%d}",
+                 device.temp, 12.0 + (rand() % 100) / 100.0, device.relayFlag ? 1 : 0,
+                 device.channels[0], device.channels[1], device.channels[2], device.channels[3]);
+        body = json;
+    } else if (path.rfind("/api/control", 0) == 0) {
+        std::string name = queryArg(path, "device");
+        int state = atoi(queryArg(path, "state").c_str());
+        if (name.size() == 3 && name.rfind("CH", 0) == 0 && name[2] >= '1' && name[2] <= '4') {
+            device.channels[name[2] - '1'] = (state == 0);
+        } else if (name == "RELAY") {
+            device.relayFlag = (state == 1);
+        }
+        body = "{\"success\":true,\"message\":\"ok\"}";
+    } else {
+        return "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    }
+
+    return "HTTP/1.0 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+int main(int argc, char** argv) {
+    int basePort = 18080;
+    int count = 16;
+    long delayMs = 0;
+    double failRate = 0.0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--base-port") basePort = atoi(argv[i + 1]);
+        else if (arg == "--count") count = atoi(argv[i + 1]);
+        else if (arg == "--delay") delayMs = atol(argv[i + 1]);
+        else if (arg == "--fail-rate") failRate = atof(argv[i + 1]);
+        else {
+            fprintf(stderr, "usage: pdu_sim [--base-port N] [--count N] [--delay MS] [--fail-rate P]\n");
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<SimDevice> devices(count);
+    for (int i = 0; i < count; i++) {
+        SimDevice& device = devices[i];
+        device.port = basePort + i;
+        device.listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(device.listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(device.port);
+        if (bind(device.listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(device.listenFd, 64) < 0) {
+            perror("bind");
+            return 1;
+        }
+        fcntl(device.listenFd, F_SETFL, O_NONBLOCK);
+    }
+    fprintf(stderr, "simulating %d PDUs on 127.0.0.1:%d-%d\n", count, basePort, basePort + count - 1);
+
+    std::vector<Connection> connections;
+    for (;;) {
+        std::vector<pollfd> fds;
+        for (SimDevice& device : devices) fds.push_back({ device.listenFd, POLLIN, 0 });
+        long now = nowMs();
+        int wait = 100;
+        for (Connection& conn : connections) {
+            short events = POLLIN;
+            if (!conn.out.empty()) {
+                if (now >= conn.respondAt) events = POLLOUT;
+                else wait = std::min<long>(wait, conn.respondAt - now);
+            }
+            fds.push_back({ conn.fd, events, 0 });
+        }
+
+        if (poll(fds.data(), fds.size(), wait) < 0 && errno != EINTR) break;
+        now = nowMs();
+
+        std::vector<Connection> accepted;
+        for (int i = 0; i < count; i++) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            int fd;
+            while ((fd = accept(devices[i].listenFd, nullptr, nullptr)) >= 0) {
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                Connection conn;
+                conn.fd = fd;
+                conn.device = &devices[i];
+                accepted.push_back(conn);
+            }
+        }
+
+        std::vector<Connection> alive;
+        for (size_t i = 0; i < connections.size(); i++) {
+            Connection& conn = connections[i];
+            short revents = fds[count + i].revents;
+            bool closeConn = false;
+
+            if (revents & POLLIN) {
+                char buffer[2048];
+                ssize_t n = recv(conn.fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) closeConn = true;
+                else conn.in.append(buffer, n);
+                if (conn.out.empty() && conn.in.find("\r\n\r\n") != std::string::npos) {
+                    conn.out = handle(*conn.device, conn.in, failRate);
+                    conn.respondAt = now + delayMs;
+                }
+            }
+            if (!closeConn && (revents & POLLOUT)) {
+                ssize_t n = send(conn.fd, conn.out.data() + conn.outSent, conn.out.size() - conn.outSent, 0);
+                if (n < 0) closeConn = true;
+                else if ((conn.outSent += n) == conn.out.size()) closeConn = true;
+            }
+            if (revents & (POLLERR | POLLHUP)) closeConn = true;
+
+            if (closeConn) close(conn.fd);
+            else alive.push_back(conn);
+        }
+        alive.insert(alive.end(), accepted.begin(), accepted.end());
+        connections.swap(alive);
+    }
+    return 0;
+}
@@ -0,0 +1,349 @@
+/*
+ * Host Arduino Core Shim Implementation
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "Arduino.h"
+#include "host_heap.h"
+#include "sim_hardware.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// ---------------------------------------------------------------------------
+// Heap accounting
+
+namespace {
+
+std::atomic<size_t> liveBytes{0};
+std::atomic<size_t> peakBytes{0};
+std::atomic<uint64_t> allocCount{0};
+
+struct alignas(std::max_align_t) AllocHeader {
+    size_t size;
+};
+
+void* trackedAlloc(size_t size) {
+    AllocHeader* header = static_cast<AllocHeader*>(malloc(sizeof(AllocHeader) + size));
+    if (!header) throw std::bad_alloc();
+    header->size = size;
+    size_t live = liveBytes += size;
+    size_t peak = peakBytes;
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live)) {}
+    allocCount++;
+    return header + 1;
+}
+
+void trackedFree(void* ptr) {
+    if (!ptr) return;
+    AllocHeader* header = static_cast<AllocHeader*>(ptr) - 1;
+    liveBytes -= header->size;
+    free(header);
+}
+
+}
+
+void* operator new(size_t size) { return trackedAlloc(size); }
+void* operator new[](size_t size) { return trackedAlloc(size); }
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedFree(ptr); }
+
+size_t HostHeap::getLiveBytes() { return liveBytes; }
+size_t HostHeap::getPeakBytes() { return peakBytes; }
+uint64_t HostHeap::getAllocCount() { return allocCount; }
+
+uint32_t EspClass::getFreeHeap() {
+    size_t live = liveBytes;
+    return live < HOST_HEAP_SIZE ? HOST_HEAP_SIZE - live : 0;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    size_t peak = peakBytes;
+    return peak < HOST_HEAP_SIZE ? HOST_HEAP_SIZE - peak : 0;
+}
+
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap(); }
+uint32_t EspClass::getHeapSize() { return HOST_HEAP_SIZE; }
+uint32_t EspClass::getCycleCount() { return (uint32_t)(SimHardware::nowMicros() * 240); }
+
+uint32_t getCpuFrequencyMhz() { return 240; }
+void EspClass::restart() { exit(0); }
+
+uint32_t esp_random() {
+    static std::mutex mutex;
+    static uint64_t state = std::chrono::steady_clock::now().time_since_epoch().count() | 1;
+    std::lock_guard<std::mutex> lock(mutex);
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (uint32_t)state;
+}
+
+// ---------------------------------------------------------------------------
+// GPIO and timing
+
+void pinMode(uint8_t pin, uint8_t mode) { SimHardware::setPinMode(pin, mode); }
+void digitalWrite(uint8_t pin, uint8_t val) { SimHardware::writePin(pin, val); }
+int digitalRead(uint8_t pin) { return SimHardware::getPin(pin); }
+uint16_t analogRead(uint8_t pin) { return SimHardware::getAnalog(pin); }
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+    SimHardware::attachInterrupt(pin, reinterpret_cast<void (*)(void*)>(handler), nullptr, mode);
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode) {
+    SimHardware::attachInterrupt(pin, handler, arg, mode);
+}
+
+void detachInterrupt(uint8_t pin) { SimHardware::detachInterrupt(pin); }
+
+unsigned long millis() { return (unsigned long)(uint32_t)(SimHardware::nowMicros() / 1000); }
+unsigned long micros() { return (unsigned long)(uint32_t)SimHardware::nowMicros(); }
+void delay(uint32_t ms) { SimHardware::sleepMicros((uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us) { SimHardware::sleepMicros(us); }
+void yield() { std::this_thread::yield(); }
+
+// ---------------------------------------------------------------------------
+// FreeRTOS tasks
+
+BaseType_t xTaskCreate(void (*task)(void*), const char*, uint32_t, void* param, UBaseType_t, TaskHandle_t* handle) {
+    std::thread(task, param).detach();
+    if (handle) *handle = nullptr;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stackDepth,
+                                   void* param, UBaseType_t priority, TaskHandle_t* handle, BaseType_t) {
+    return xTaskCreate(task, name, stackDepth, param, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t) { pthread_exit(nullptr); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    static thread_local char threadMarker;
+    return &threadMarker;
+}
+void vTaskDelay(TickType_t ticks) { delay(ticks * portTICK_PERIOD_MS); }
+TickType_t xTaskGetTickCount() { return millis() / portTICK_PERIOD_MS; }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+// ---------------------------------------------------------------------------
+// String
+
+String::String(unsigned char value, unsigned char base) : String((unsigned long)value, base) {}
+String::String(int value, unsigned char base) : String((long)value, base) {}
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base) {
+    if (base == 10) buffer = std::to_string(value);
+    else if (value < 0) buffer = "-" + String((unsigned long)-value, base).buffer;
+    else buffer = String((unsigned long)value, base).buffer;
+}
+
+String::String(unsigned long value, unsigned char base) {
+    if (base == 10) {
+        buffer = std::to_string(value);
+        return;
+    }
+    do {
+        int digit = value % base;
+        buffer.insert(buffer.begin(), (char)(digit < 10 ? '0' + digit : 'a' + digit - 10));
+        value /= base;
+    } while (value);
+}
+
+String::String(float value, unsigned int decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned int decimalPlaces) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", decimalPlaces, value);
+    buffer = text;
+}
+
+bool String::equalsIgnoreCase(const String& rhs) const {
+    return strcasecmp(buffer.c_str(), rhs.buffer.c_str()) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    return buffer.size() >= suffix.buffer.size() &&
+           buffer.compare(buffer.size() - suffix.buffer.size(), std::string::npos, suffix.buffer) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t pos = buffer.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& str, unsigned int from) const {
+    size_t pos = buffer.find(str.buffer, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const {
+    size_t pos = buffer.rfind(c);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from) const {
+    return from < buffer.size() ? String(buffer.substr(from)) : String();
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= buffer.size()) return String();
+    return String(buffer.substr(from, to - from));
+}
+
+void String::trim() {
+    size_t start = buffer.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        buffer.clear();
+        return;
+    }
+    size_t end = buffer.find_last_not_of(" \t\r\n");
+    buffer = buffer.substr(start, end - start + 1);
+}
+
+void String::toUpperCase() {
+    for (char& c : buffer) c = toupper((unsigned char)c);
+}
+
+void String::toLowerCase() {
+    for (char& c : buffer) c = tolower((unsigned char)c);
+}
+
+void String::replace(const String& find, const String& replacement) {
+    if (find.buffer.empty()) return;
+    size_t pos = 0;
+    while ((pos = buffer.find(find.buffer, pos)) != std::string::npos) {
+        buffer.replace(pos, find.buffer.size(), replacement.buffer);
+        pos += replacement.buffer.size();
+    }
+}
+
+String IPAddress::toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(text);
+}
+
+// ---------------------------------------------------------------------------
+// Print / Stream / Serial
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (size--) written += write(*buffer++);
+    return written;
+}
+
+size_t Print::printf(const char* format, ...) {
+    // Same as the ESP32 core: a 64-byte stack buffer, heap only for longer output
+    char stackText[64];
+    char* text = stackText;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(stackText), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+
+    if ((size_t)length >= sizeof(stackText)) {
+        text = static_cast<char*>(malloc(length + 1));
+        if (!text) return 0;
+        va_start(args, format);
+        vsnprintf(text, length + 1, format, args);
+        va_end(args);
+    }
+    size_t written = write((const uint8_t*)text, length);
+    if (text != stackText) free(text);
+    return written;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String result;
+    unsigned long start = millis();
+    for (;;) {
+        int c = read();
+        if (c < 0) {
+            if (millis() - start >= timeoutMs) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (c == terminator) break;
+        result += (char)c;
+    }
+    return result;
+}
+
+namespace {
+
+std::mutex serialInputMutex;
+std::deque<char> serialInput;
+
+void serialReader() {
+    char buffer[256];
+    ssize_t n;
+    while ((n = ::read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
+        std::lock_guard<std::mutex> lock(serialInputMutex);
+        serialInput.insert(serialInput.end(), buffer, buffer + n);
+    }
+}
+
+std::mutex serialOutputMutex;
+
+}
+
+void HardwareSerial::begin(unsigned long) {
+    static std::once_flag started;
+    std::call_once(started, [] { std::thread(serialReader).detach(); });
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    std::lock_guard<std::mutex> lock(serialOutputMutex);
+    fwrite(buffer, 1, size, stdout);
+    return size;
+}
+
+int HardwareSerial::available() {
+    std::lock_guard<std::mutex> lock(serialInputMutex);
+    return serialInput.size();
+}
+
+int HardwareSerial::read() {
+    std::lock_guard<std::mutex> lock(serialInputMutex);
+    if (serialInput.empty()) return -1;
+    char c = serialInput.front();
+    serialInput.pop_front();
+    return (uint8_t)c;
+}
+
+void HardwareSerial::pushInput(const char* data) {
+    std::lock_guard<std::mutex> lock(serialInputMutex);
+    serialInput.insert(serialInput.end(), data, data + strlen(data));
+}
+
+void HardwareSerial::flush() {
+    std::lock_guard<std::mutex> lock(serialOutputMutex);
+    fflush(stdout);
+}
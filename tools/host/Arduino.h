@@ -0,0 +1,215 @@
+/*
+ * Host Arduino Core Shim
+ *
+ * Minimal subset of the ESP32 Arduino core used by the PDU firmware,
+ * implemented on top of the C++ standard library and SimHardware so the
+ * firmware sources compile and run unmodified on Linux.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+using std::min;
+using std::max;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define PROGMEM
+#define IRAM_ATTR
+#define ARDUINO_ISR_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR __attribute__((section("rtc_noinit")))   // Backed by PDU_RTC_FILE, see esp_system.cpp
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// GPIO
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// Timing
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// Arduino String, backed by std::string
+class String {
+public:
+    String(const char* cstr = "") : buffer(cstr ? cstr : "") {}
+    String(const std::string& str) : buffer(str) {}
+    String(char c) : buffer(1, c) {}
+    String(unsigned char value, unsigned char base = 10);
+    String(int value, unsigned char base = 10);
+    String(unsigned int value, unsigned char base = 10);
+    String(long value, unsigned char base = 10);
+    String(unsigned long value, unsigned char base = 10);
+    String(float value, unsigned int decimalPlaces = 2);
+    String(double value, unsigned int decimalPlaces = 2);
+
+    unsigned int length() const { return buffer.length(); }
+    const char* c_str() const { return buffer.c_str(); }
+    bool isEmpty() const { return buffer.empty(); }
+    bool reserve(unsigned int size) { buffer.reserve(size); return true; }
+
+    char operator[](unsigned int index) const { return index < buffer.size() ? buffer[index] : 0; }
+    char charAt(unsigned int index) const { return (*this)[index]; }
+
+    String& operator+=(const String& rhs) { buffer += rhs.buffer; return *this; }
+    String& operator+=(const char* rhs) { buffer += rhs; return *this; }
+    String& operator+=(char rhs) { buffer += rhs; return *this; }
+    String& operator+=(int rhs) { return *this += String(rhs); }
+    String& operator+=(unsigned int rhs) { return *this += String(rhs); }
+    String& operator+=(long rhs) { return *this += String(rhs); }
+    String& operator+=(unsigned long rhs) { return *this += String(rhs); }
+    bool concat(const String& rhs) { buffer += rhs.buffer; return true; }
+
+    friend String operator+(const String& lhs, const String& rhs) { return String(lhs.buffer + rhs.buffer); }
+    friend String operator+(const String& lhs, const char* rhs) { return String(lhs.buffer + rhs); }
+    friend String operator+(const char* lhs, const String& rhs) { return String(lhs + rhs.buffer); }
+    friend String operator+(const String& lhs, char rhs) { return String(lhs.buffer + rhs); }
+
+    bool operator==(const String& rhs) const { return buffer == rhs.buffer; }
+    bool operator==(const char* rhs) const { return buffer == rhs; }
+    bool operator!=(const String& rhs) const { return buffer != rhs.buffer; }
+    bool operator!=(const char* rhs) const { return buffer != rhs; }
+    bool operator<(const String& rhs) const { return buffer < rhs.buffer; }
+    bool equals(const String& rhs) const { return buffer == rhs.buffer; }
+    bool equalsIgnoreCase(const String& rhs) const;
+
+    bool startsWith(const String& prefix) const { return buffer.compare(0, prefix.buffer.size(), prefix.buffer) == 0; }
+    bool endsWith(const String& suffix) const;
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String& str, unsigned int from = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+
+    long toInt() const { return strtol(buffer.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(buffer.c_str(), nullptr); }
+    double toDouble() const { return strtod(buffer.c_str(), nullptr); }
+
+    void trim();
+    void toUpperCase();
+    void toLowerCase();
+    void replace(const String& find, const String& replacement);
+
+private:
+    std::string buffer;
+};
+
+class IPAddress {
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address(a | b << 8 | c << 16 | (uint32_t)d << 24) {}
+    String toString() const;
+    uint8_t operator[](int index) const { return address >> (index * 8); }
+
+private:
+    uint32_t address;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+
+    size_t print(const char* str) { return write(str); }
+    size_t print(const String& str) { return write(str.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return printf("%d", value); }
+    size_t print(unsigned int value) { return printf("%u", value); }
+    size_t print(long value) { return printf("%ld", value); }
+    size_t print(unsigned long value) { return printf("%lu", value); }
+    size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+    size_t print(const IPAddress& ip) { return print(ip.toString()); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(const T& value) { return print(value) + println(); }
+    size_t println(double value, int digits) { return print(value, digits) + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() { return -1; }
+    virtual void flush() {}
+    String readStringUntil(char terminator);
+    void setTimeout(unsigned long ms) { timeoutMs = ms; }
+
+protected:
+    unsigned long timeoutMs = 1000;
+};
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud);
+    void end() {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int available() override;
+    int read() override;
+    int availableForWrite() { return 128; }
+    void flush() override;
+    operator bool() const { return true; }
+    using Print::write;
+
+    // Host only: queue bytes as if they had arrived on the UART
+    void pushInput(const char* data);
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getHeapSize();
+    uint32_t getCycleCount();
+    void restart();
+};
+
+extern EspClass ESP;
+
+uint32_t esp_random();
+uint32_t getCpuFrequencyMhz();  // Matches the rate ESP.getCycleCount() counts at
+
+#endif // HOST_ARDUINO_H
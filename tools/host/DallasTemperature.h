@@ -0,0 +1,62 @@
+/*
+ * Host DallasTemperature Shim
+ *
+ * Simulated DS18B20: readings come from SimHardware::getTemperature() and
+ * blocking conversions take the datasheet time for the configured
+ * resolution (94/188/375/750 ms for 9-12 bits). With auto-save on (the
+ * library default), setResolution() also waits the 20 ms EEPROM copy.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef HOST_DALLAS_TEMPERATURE_H
+#define HOST_DALLAS_TEMPERATURE_H
+
+#include "OneWire.h"
+#include "sim_hardware.h"
+
+#define DEVICE_DISCONNECTED_C -127
+
+class DallasTemperature {
+public:
+    explicit DallasTemperature(OneWire*) {}
+
+    void begin() {}
+    uint8_t getDeviceCount() { return 1; }
+    void setResolution(uint8_t bits) {
+        resolution = bits < 9 ? 9 : (bits > 12 ? 12 : bits);
+        if (autoSaveScratchPad) delay(20);     // COPY SCRATCHPAD to the sensor EEPROM
+    }
+    uint8_t getResolution() { return resolution; }
+    void setWaitForConversion(bool wait) { waitForConversion = wait; }
+    bool getWaitForConversion() { return waitForConversion; }
+    void setAutoSaveScratchPad(bool save) { autoSaveScratchPad = save; }
+    bool getAutoSaveScratchPad() { return autoSaveScratchPad; }
+    int16_t millisToWaitForConversion(uint8_t bits) { return 750 >> (12 - bits); }
+
+    void requestTemperatures() {
+        conversionStart = millis();
+        if (waitForConversion) delay(millisToWaitForConversion(resolution));
+    }
+
+    bool isConversionComplete() {
+        return millis() - conversionStart >= (unsigned long)millisToWaitForConversion(resolution);
+    }
+
+    float getTempCByIndex(uint8_t) {
+        // Quantize to the configured resolution like the real sensor
+        float step = 0.0625f * (1 << (12 - resolution));
+        return floorf(SimHardware::getTemperature() / step) * step;
+    }
+
+private:
+    uint8_t resolution = 12;
+    bool waitForConversion = true;
+    bool autoSaveScratchPad = true;
+    unsigned long conversionStart = 0;
+};
+
+#endif // HOST_DALLAS_TEMPERATURE_H
@@ -0,0 +1,23 @@
+/*
+ * Host OneWire Shim
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef HOST_ONEWIRE_H
+#define HOST_ONEWIRE_H
+
+#include "Arduino.h"
+
+class OneWire {
+public:
+    explicit OneWire(uint8_t pin) : pin(pin) {}
+
+private:
+    uint8_t pin;
+};
+
+#endif // HOST_ONEWIRE_H
@@ -0,0 +1,73 @@
+/*
+ * Host Preferences Shim Implementation
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "Preferences.h"
+#include <mutex>
+
+namespace {
+std::mutex storeMutex;
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>> namespaces;
+}
+
+bool Preferences::begin(const char* name, bool readOnlyMode) {
+    ns = name;
+    readOnly = readOnlyMode;
+    opened = true;
+    return true;
+}
+
+void Preferences::end() {
+    opened = false;
+}
+
+std::map<std::string, std::vector<uint8_t>>* Preferences::store() {
+    return opened ? &namespaces[ns] : nullptr;
+}
+
+bool Preferences::clear() {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (!opened || readOnly) return false;
+    store()->clear();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (!opened || readOnly) return false;
+    return store()->erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return opened && store()->count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (!opened || readOnly) return 0;
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    (*store())[key] = std::vector<uint8_t>(bytes, bytes + length);
+    return length;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (!opened) return 0;
+    auto it = store()->find(key);
+    return it == store()->end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (!opened) return 0;
+    auto it = store()->find(key);
+    if (it == store()->end() || it->second.size() > maxLength) return 0;
+    memcpy(buffer, it->second.data(), it->second.size());
+    return it->second.size();
+}
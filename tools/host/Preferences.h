@@ -0,0 +1,64 @@
+/*
+ * Host Preferences Shim
+ *
+ * In-memory replacement for the ESP32 NVS-backed Preferences library.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include "Arduino.h"
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false);
+    void end();
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putBool(const char* key, bool value) { return putValue(key, value); }
+    size_t putUChar(const char* key, uint8_t value) { return putValue(key, value); }
+    size_t putUShort(const char* key, uint16_t value) { return putValue(key, value); }
+    size_t putUInt(const char* key, uint32_t value) { return putValue(key, value); }
+    size_t putULong(const char* key, uint32_t value) { return putValue(key, value); }
+    size_t putFloat(const char* key, float value) { return putValue(key, value); }
+    size_t putBytes(const char* key, const void* value, size_t length);
+    size_t putString(const char* key, const char* value) { return putBytes(key, value, strlen(value) + 1); }
+
+    bool getBool(const char* key, bool defaultValue = false) { return getValue(key, defaultValue); }
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return getValue(key, defaultValue); }
+    uint16_t getUShort(const char* key, uint16_t defaultValue = 0) { return getValue(key, defaultValue); }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    uint32_t getULong(const char* key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    float getFloat(const char* key, float defaultValue = 0) { return getValue(key, defaultValue); }
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buffer, size_t maxLength);
+    size_t getString(const char* key, char* value, size_t maxLength) { return getBytes(key, value, maxLength); }
+
+private:
+    std::string ns;
+    bool readOnly = true;
+    bool opened = false;
+
+    template <typename T> size_t putValue(const char* key, T value) {
+        return putBytes(key, &value, sizeof(value));
+    }
+
+    template <typename T> T getValue(const char* key, T defaultValue) {
+        T value;
+        return getBytesLength(key) == sizeof(T) && getBytes(key, &value, sizeof(T)) ? value : defaultValue;
+    }
+
+    std::map<std::string, std::vector<uint8_t>>* store();
+};
+
+#endif // HOST_PREFERENCES_H
@@ -0,0 +1,260 @@
+/*
+ * Host WebServer Shim Implementation
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "WebServer.h"
+#include <strings.h>
+
+namespace {
+
+std::string urlDecode(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '+') out += ' ';
+        else if (text[i] == '%' && i + 2 < text.size()) {
+            out += (char)strtol(text.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else out += text[i];
+    }
+    return out;
+}
+
+std::string base64Decode(const std::string& in) {
+    std::string out;
+    int value = 0;
+    int bits = -8;
+    for (char c : in) {
+        const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        const char* p = strchr(table, c);
+        if (c == '=' || !p || !c) break;
+        value = (value << 6) + (p - table);
+        bits += 6;
+        if (bits >= 0) {
+            out += (char)((value >> bits) & 0xFF);
+            bits -= 8;
+        }
+    }
+    return out;
+}
+
+const char* statusText(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "";
+    }
+}
+
+}
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction handler) {
+    routes.push_back({ uri, method, handler });
+}
+
+void WebServer::handleClient() {
+    if (!currentClient) {
+        currentClient = server.accept();
+        if (!currentClient) return;
+        request.clear();
+        requestStart = millis();
+    }
+
+    uint8_t buffer[1024];
+    int n;
+    while (currentClient.available() > 0 && (n = currentClient.read(buffer, sizeof(buffer))) > 0) {
+        request.append((const char*)buffer, n);
+    }
+
+    if (!parseRequest()) {
+        if (!currentClient.connected() || millis() - requestStart > HTTP_MAX_DATA_WAIT) currentClient.stop();
+        return;
+    }
+
+    handleRequest();
+    finishRequest();
+}
+
+bool WebServer::parseRequest() {
+    size_t headerEnd = request.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) return false;
+
+    size_t bodyLength = 0;
+    std::vector<std::pair<String, String>> parsedHeaders;
+    size_t lineStart = request.find("\r\n") + 2;
+    while (lineStart < headerEnd) {
+        size_t lineEnd = request.find("\r\n", lineStart);
+        std::string line = request.substr(lineStart, lineEnd - lineStart);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            std::string name = line.substr(0, colon);
+            std::string value = line.substr(line.find_first_not_of(' ', colon + 1) == std::string::npos
+                                            ? line.size() : line.find_first_not_of(' ', colon + 1));
+            if (strcasecmp(name.c_str(), "Content-Length") == 0) bodyLength = strtoul(value.c_str(), nullptr, 10);
+            parsedHeaders.push_back({ String(name), String(value) });
+        }
+        lineStart = lineEnd + 2;
+    }
+    if (request.size() < headerEnd + 4 + bodyLength) return false;
+
+    std::string requestLine = request.substr(0, request.find("\r\n"));
+    std::string methodName = requestLine.substr(0, requestLine.find(' '));
+    std::string target = requestLine.substr(methodName.size() + 1);
+    target = target.substr(0, target.find(' '));
+
+    if (methodName == "GET") currentMethod = HTTP_GET;
+    else if (methodName == "POST") currentMethod = HTTP_POST;
+    else if (methodName == "PUT") currentMethod = HTTP_PUT;
+    else if (methodName == "DELETE") currentMethod = HTTP_DELETE;
+    else if (methodName == "OPTIONS") currentMethod = HTTP_OPTIONS;
+    else if (methodName == "HEAD") currentMethod = HTTP_HEAD;
+    else currentMethod = HTTP_ANY;
+
+    headers = parsedHeaders;
+    requestArgs.clear();
+    size_t query = target.find('?');
+    currentUri = String(urlDecode(target.substr(0, query)));
+    if (query != std::string::npos) parseArgs(target.substr(query + 1));
+
+    std::string body = request.substr(headerEnd + 4, bodyLength);
+    if (!body.empty()) {
+        if (header("Content-Type").startsWith("application/x-www-form-urlencoded")) parseArgs(body);
+        else requestArgs.push_back({ String("plain"), String(body) });
+    }
+    return true;
+}
+
+void WebServer::parseArgs(const std::string& query) {
+    size_t start = 0;
+    while (start <= query.size()) {
+        size_t end = query.find('&', start);
+        if (end == std::string::npos) end = query.size();
+        std::string pair = query.substr(start, end - start);
+        if (!pair.empty()) {
+            size_t eq = pair.find('=');
+            requestArgs.push_back({ String(urlDecode(pair.substr(0, eq))),
+                             String(eq == std::string::npos ? "" : urlDecode(pair.substr(eq + 1))) });
+        }
+        start = end + 1;
+    }
+}
+
+void WebServer::handleRequest() {
+    responded = false;
+    chunked = false;
+    contentLength = CONTENT_LENGTH_NOT_SET;
+    responseHeaders.clear();
+
+    for (Route& route : routes) {
+        if (route.uri == currentUri && (route.method == HTTP_ANY || route.method == currentMethod)) {
+            route.handler();
+            return;
+        }
+    }
+
+    if (notFoundHandler) notFoundHandler();
+    else send(404, "text/plain", String("Not found: ") + currentUri);
+}
+
+void WebServer::finishRequest() {
+    if (chunked) sendContent("", 0);
+    currentClient.stop();
+    request.clear();
+}
+
+String WebServer::arg(const String& name) const {
+    for (const auto& entry : requestArgs) {
+        if (entry.first == name) return entry.second;
+    }
+    return String();
+}
+
+bool WebServer::hasArg(const String& name) const {
+    for (const auto& entry : requestArgs) {
+        if (entry.first == name) return true;
+    }
+    return false;
+}
+
+String WebServer::header(const String& name) const {
+    for (const auto& entry : headers) {
+        if (entry.first.equalsIgnoreCase(name)) return entry.second;
+    }
+    return String();
+}
+
+bool WebServer::hasHeader(const String& name) const {
+    for (const auto& entry : headers) {
+        if (entry.first.equalsIgnoreCase(name)) return true;
+    }
+    return false;
+}
+
+bool WebServer::authenticate(const char* username, const char* password) {
+    String authorization = header("Authorization");
+    if (!authorization.startsWith("Basic ")) return false;
+    std::string decoded = base64Decode(authorization.substring(6).c_str());
+    return decoded == std::string(username) + ":" + password;
+}
+
+void WebServer::requestAuthentication() {
+    sendHeader("WWW-Authenticate", "Basic realm=\"Login Required\"");
+    send(401);
+}
+
+void WebServer::sendHeader(const String& name, const String& value, bool first) {
+    if (first) responseHeaders.insert(responseHeaders.begin(), { name, value });
+    else responseHeaders.push_back({ name, value });
+}
+
+void WebServer::sendResponseHeader(int code, const char* contentType, size_t length) {
+    String head = String("HTTP/1.1 ") + String(code) + " " + statusText(code) + "\r\n";
+    if (contentType && *contentType) head += String("Content-Type: ") + contentType + "\r\n";
+    if (length == CONTENT_LENGTH_UNKNOWN) {
+        chunked = true;
+        head += "Transfer-Encoding: chunked\r\n";
+    } else {
+        head += String("Content-Length: ") + String((unsigned long)length) + "\r\n";
+    }
+    for (const auto& entry : responseHeaders) head += entry.first + ": " + entry.second + "\r\n";
+    head += "Connection: close\r\n\r\n";
+    currentClient.write((const uint8_t*)head.c_str(), head.length());
+    responded = true;
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+    send(code, contentType, content.c_str(), content.length());
+}
+
+void WebServer::send(int code, const char* contentType, const char* content, size_t length) {
+    size_t announced = contentLength == CONTENT_LENGTH_NOT_SET ? length : contentLength;
+    sendResponseHeader(code, contentType, announced);
+    if (announced != CONTENT_LENGTH_UNKNOWN && length) currentClient.write((const uint8_t*)content, length);
+    else if (length) sendContent(content, length);
+}
+
+void WebServer::sendContent(const char* content, size_t length) {
+    if (!chunked) {
+        currentClient.write((const uint8_t*)content, length);
+        return;
+    }
+    char size[16];
+    snprintf(size, sizeof(size), "%zx\r\n", length);
+    currentClient.write((const uint8_t*)size, strlen(size));
+    currentClient.write((const uint8_t*)content, length);
+    currentClient.write((const uint8_t*)"\r\n", 2);
+    if (length == 0) chunked = false;
+}
@@ -0,0 +1,99 @@
+/*
+ * Host WebServer Shim
+ *
+ * Subset of the ESP32 WebServer API on top of the host WiFiServer. Like
+ * the ESP32 library it serves one client at a time from handleClient(),
+ * reads the request without blocking across calls and answers with
+ * "Connection: close".
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef HOST_WEBSERVER_H
+#define HOST_WEBSERVER_H
+
+#include "WiFi.h"
+#include <functional>
+#include <utility>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+#define HTTP_MAX_DATA_WAIT 5000
+
+class WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    explicit WebServer(int port = 80) : server(port) {}
+
+    void begin() { server.begin(); }
+    void close() { server.end(); }
+    void handleClient();
+
+    void on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction handler);
+    void onNotFound(THandlerFunction handler) { notFoundHandler = handler; }
+
+    String uri() const { return currentUri; }
+    HTTPMethod method() const { return currentMethod; }
+    String arg(const String& name) const;
+    String arg(int index) const { return index < (int)requestArgs.size() ? requestArgs[index].second : String(); }
+    String argName(int index) const { return index < (int)requestArgs.size() ? requestArgs[index].first : String(); }
+    int args() const { return requestArgs.size(); }
+    bool hasArg(const String& name) const;
+    String header(const String& name) const;
+    bool hasHeader(const String& name) const;
+    void collectHeaders(const char* headerKeys[], size_t headerKeysCount) { (void)headerKeys; (void)headerKeysCount; }
+    WiFiClient& client() { return currentClient; }
+
+    bool authenticate(const char* username, const char* password);
+    void requestAuthentication();
+
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void setContentLength(size_t length) { contentLength = length; }
+    void send(int code, const char* contentType = nullptr, const String& content = String(""));
+    void send(int code, const String& contentType, const String& content) { send(code, contentType.c_str(), content); }
+    void send(int code, const char* contentType, const char* content) { send(code, contentType, content, strlen(content)); }
+    void send(int code, const char* contentType, const char* content, size_t length);
+    void send_P(int code, const char* contentType, const char* content) { send(code, contentType, content); }
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t length);
+
+private:
+    struct Route {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction handler;
+    };
+
+    WiFiServer server;
+    std::vector<Route> routes;
+    THandlerFunction notFoundHandler;
+
+    WiFiClient currentClient;
+    std::string request;
+    unsigned long requestStart = 0;
+
+    String currentUri;
+    HTTPMethod currentMethod = HTTP_ANY;
+    std::vector<std::pair<String, String>> requestArgs;
+    std::vector<std::pair<String, String>> headers;
+    std::vector<std::pair<String, String>> responseHeaders;
+    size_t contentLength = CONTENT_LENGTH_NOT_SET;
+    bool chunked = false;
+    bool responded = false;
+
+    bool parseRequest();
+    void handleRequest();
+    void finishRequest();
+    void parseArgs(const std::string& query);
+    void sendResponseHeader(int code, const char* contentType, size_t length);
+};
+
+#endif // HOST_WEBSERVER_H
@@ -0,0 +1,155 @@
+/*
+ * Host WiFi Shim Implementation
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "WiFi.h"
+#include "sim_hardware.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+WiFiClient::Socket::~Socket() {
+    if (fd >= 0) close(fd);
+}
+
+WiFiClient::WiFiClient(int fd) : socket(std::make_shared<Socket>(fd)) {
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &result) != 0) return 0;
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int ok = fd >= 0 && ::connect(fd, result->ai_addr, result->ai_addrlen) == 0;
+    freeaddrinfo(result);
+    if (!ok) {
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    *this = WiFiClient(fd);
+    return 1;
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    if (!socket) return 0;
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = send(socket->fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else if (n < 0 && errno == EAGAIN) {
+            pollfd pfd = { socket->fd, POLLOUT, 0 };
+            if (poll(&pfd, 1, 5000) <= 0) break;
+        } else {
+            break;
+        }
+    }
+    return sent;
+}
+
+int WiFiClient::available() {
+    if (!socket) return 0;
+    int count = 0;
+    ioctl(socket->fd, FIONREAD, &count);
+    return count;
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+    if (!socket) return -1;
+    ssize_t n = recv(socket->fd, buffer, size, 0);
+    return n > 0 ? (int)n : -1;
+}
+
+int WiFiClient::peek() {
+    if (!socket) return -1;
+    uint8_t c;
+    return recv(socket->fd, &c, 1, MSG_PEEK) == 1 ? c : -1;
+}
+
+void WiFiClient::stop() {
+    socket.reset();
+}
+
+uint8_t WiFiClient::connected() {
+    if (!socket) return 0;
+    uint8_t c;
+    ssize_t n = recv(socket->fd, &c, 1, MSG_PEEK);
+    if (n > 0) return 1;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 1;
+    return 0;
+}
+
+void WiFiClient::setNoDelay(bool noDelay) {
+    if (!socket) return;
+    int value = noDelay ? 1 : 0;
+    setsockopt(socket->fd, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+}
+
+void WiFiServer::begin(uint16_t newPort) {
+    if (newPort) port = newPort;
+    listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(SimHardware::mapPort(port));
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 128) < 0) {
+        fprintf(stderr, "WiFiServer: cannot listen on port %u\n", SimHardware::mapPort(port));
+        close(listenFd);
+        listenFd = -1;
+        return;
+    }
+    fcntl(listenFd, F_SETFL, O_NONBLOCK);
+}
+
+void WiFiServer::end() {
+    if (listenFd >= 0) close(listenFd);
+    listenFd = -1;
+}
+
+bool WiFiServer::hasClient() {
+    if (listenFd < 0) return false;
+    pollfd pfd = { listenFd, POLLIN, 0 };
+    return poll(&pfd, 1, 0) > 0;
+}
+
+WiFiClient WiFiServer::accept() {
+    if (listenFd < 0) return WiFiClient();
+    int fd = ::accept(listenFd, nullptr, nullptr);
+    if (fd < 0) return WiFiClient();
+    WiFiClient client(fd);
+    if (noDelay) client.setNoDelay(true);
+    return client;
+}
@@ -0,0 +1,99 @@
+/*
+ * Host WiFi Shim
+ *
+ * The radio is a no-op on the host; WiFiServer and WiFiClient are plain
+ * non-blocking TCP sockets on the loopback interface. Listening ports are
+ * shifted by SimHardware::mapPort() so no privileges are needed.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+#include <memory>
+
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+typedef enum { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+
+class WiFiClient : public Stream {
+public:
+    WiFiClient() {}
+    explicit WiFiClient(int fd);
+
+    int connect(const char* host, uint16_t port);
+    int connect(IPAddress ip, uint16_t port);
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size);
+    int peek() override;
+    void flush() override {}
+    void stop();
+    uint8_t connected();
+    void setNoDelay(bool noDelay);
+    int fd() const { return socket ? socket->fd : -1; }
+    IPAddress remoteIP() const { return IPAddress(127, 0, 0, 1); }
+    operator bool() { return connected(); }
+    bool operator==(const WiFiClient& rhs) const { return socket == rhs.socket; }
+    using Print::write;
+
+private:
+    struct Socket {
+        int fd;
+        explicit Socket(int fd) : fd(fd) {}
+        ~Socket();
+    };
+    std::shared_ptr<Socket> socket;
+};
+
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t port = 80, uint8_t maxClients = 4) : port(port) { (void)maxClients; }
+    void begin(uint16_t port = 0);
+    void end();
+    WiFiClient available() { return accept(); }
+    WiFiClient accept();
+    bool hasClient();
+    void setNoDelay(bool noDelay) { this->noDelay = noDelay; }
+    operator bool() const { return listenFd >= 0; }
+
+private:
+    uint16_t port;
+    int listenFd = -1;
+    bool noDelay = false;
+};
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t m) { currentMode = m; return true; }
+    wifi_mode_t getMode() { return currentMode; }
+    bool softAP(const char*, const char* = nullptr) { return enable(WIFI_AP); }
+    bool softAPdisconnect(bool wifiOff = false) { return wifiOff ? disable(WIFI_AP) : true; }
+    IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+    uint8_t softAPgetStationNum() { return 0; }
+    int begin(const char*, const char* = nullptr) { enable(WIFI_STA); return WL_CONNECTED; }   // Joins at once
+    int status() { return currentMode & WIFI_STA ? WL_CONNECTED : WL_DISCONNECTED; }
+    uint8_t* macAddress(uint8_t* mac) { static const uint8_t sim[6] = { 0x02, 0, 0, 0, 0, 0x01 }; memcpy(mac, sim, 6); return mac; }
+    bool disconnect(bool = false) { return true; }
+    bool setSleep(bool) { return true; }
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+
+private:
+    wifi_mode_t currentMode = WIFI_OFF;
+
+    bool enable(wifi_mode_t bit) { currentMode = (wifi_mode_t)(currentMode | bit); return true; }
+    bool disable(wifi_mode_t bit) { currentMode = (wifi_mode_t)(currentMode & ~bit); return true; }
+};
+
+extern WiFiClass WiFi;
+
+#endif // HOST_WIFI_H
@@ -0,0 +1,21 @@
+/*
+ * Host RTC GPIO Driver Shim
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef HOST_DRIVER_RTC_IO_H
+#define HOST_DRIVER_RTC_IO_H
+
+#include "gpio.h"
+
+// Same pins as on the ESP32: only these can wake it from deep sleep
+inline bool rtc_gpio_is_valid_gpio(gpio_num_t pin) {
+    return pin == 0 || pin == 2 || pin == 4 || (pin >= 12 && pin <= 15) ||
+           (pin >= 25 && pin <= 27) || (pin >= 32 && pin <= 39);
+}
+
+#endif // HOST_DRIVER_RTC_IO_H
@@ -0,0 +1,95 @@
+/*
+ * Host ESP Partition Shim Implementation
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "esp_partition.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+#include "sim_hardware.h"
+
+namespace {
+const uint32_t SECTOR_SIZE = 4096;
+const uint32_t ERASE_TIME_US = 45000;  // Typical 4 KB sector erase
+const uint32_t READ_TIME_US = 20;      // One small read (command, address, cache off/on)
+
+// Same place as in partitions.csv
+const esp_partition_t journalPartition = {
+    ESP_PARTITION_TYPE_DATA, 0x40, 0x3E0000, 0x10000, "journal", false
+};
+
+std::mutex flashMutex;
+std::vector<uint8_t> contents;
+FILE* backingFile = nullptr;
+
+void load() {
+    if (!contents.empty()) return;
+    contents.assign(journalPartition.size, 0xFF);
+
+    const char* path = getenv("PDU_FLASH_FILE");
+    if (path == nullptr) return;
+    backingFile = fopen(path, "r+b");
+    if (backingFile == nullptr) backingFile = fopen(path, "w+b");
+    if (backingFile == nullptr) return;
+    size_t loaded = fread(contents.data(), 1, contents.size(), backingFile);
+    (void)loaded;
+}
+
+void store(size_t offset, size_t size) {
+    if (backingFile == nullptr) return;
+    fseek(backingFile, offset, SEEK_SET);
+    fwrite(&contents[offset], 1, size, backingFile);
+    fflush(backingFile);
+}
+
+bool inRange(const esp_partition_t* partition, size_t offset, size_t size) {
+    return partition == &journalPartition && offset <= partition->size && size <= partition->size - offset;
+}
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+    if (type != journalPartition.type) return nullptr;
+    if (subtype != ESP_PARTITION_SUBTYPE_ANY && (int)subtype != journalPartition.subtype) return nullptr;
+    if (label != nullptr && strcmp(label, journalPartition.label) != 0) return nullptr;
+    return &journalPartition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size) {
+    if (!inRange(partition, offset, size)) return ESP_ERR_INVALID_SIZE;
+    std::lock_guard<std::mutex> lock(flashMutex);
+    load();
+    memcpy(dst, &contents[offset], size);
+    SimHardware::sleepMicros(READ_TIME_US);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t offset, const void* src, size_t size) {
+    if (!inRange(partition, offset, size)) return ESP_ERR_INVALID_SIZE;
+    std::lock_guard<std::mutex> lock(flashMutex);
+    load();
+    const uint8_t* bytes = (const uint8_t*)src;
+    for (size_t i = 0; i < size; i++) contents[offset + i] &= bytes[i];  // NOR: 1 -> 0 only
+    store(offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+    if (!inRange(partition, offset, size)) return ESP_ERR_INVALID_SIZE;
+    if (offset % SECTOR_SIZE != 0 || size % SECTOR_SIZE != 0) return ESP_ERR_INVALID_ARG;
+    {
+        std::lock_guard<std::mutex> lock(flashMutex);
+        load();
+        memset(&contents[offset], 0xFF, size);
+        store(offset, size);
+    }
+    SimHardware::sleepMicros((uint64_t)ERASE_TIME_US * (size / SECTOR_SIZE));
+    return ESP_OK;
+}
@@ -0,0 +1,82 @@
+/*
+ * Host ESP Sleep Shim Implementation
+ *
+ * Light sleep polls the simulated wake-up pin and the timer. Time passes
+ * as it would on the device: virtually on the thread that owns the clock,
+ * in real time otherwise, so a parked pdu_host wakes up when its IGN input
+ * is driven HIGH (see pdu_host --ign-toggle).
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "esp_sleep.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "sim_hardware.h"
+
+namespace {
+const uint64_t POLL_US = 1000;
+
+uint64_t timerUs = 0;           // 0 = timer wake-up disabled
+int wakePin = -1;               // Light sleep GPIO wake-up (high level)
+bool gpioWakeEnabled = false;
+esp_sleep_wakeup_cause_t lastCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) {
+    if (type != GPIO_INTR_HIGH_LEVEL) return ESP_ERR_INVALID_ARG;
+    wakePin = pin;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t pin) {
+    if (pin == wakePin) wakePin = -1;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs) {
+    timerUs = timeUs;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level) {
+    return level == 1 ? gpio_wakeup_enable(pin, GPIO_INTR_HIGH_LEVEL) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup() {
+    gpioWakeEnabled = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source) {
+    if (source == ESP_SLEEP_WAKEUP_ALL || source == ESP_SLEEP_WAKEUP_TIMER) timerUs = 0;
+    if (source == ESP_SLEEP_WAKEUP_ALL || source == ESP_SLEEP_WAKEUP_GPIO) gpioWakeEnabled = false;
+    return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    return lastCause;
+}
+
+esp_err_t esp_light_sleep_start() {
+    uint64_t start = SimHardware::nowMicros();
+    for (;;) {
+        if (gpioWakeEnabled && wakePin >= 0 && SimHardware::getPin(wakePin) == 1) {
+            lastCause = ESP_SLEEP_WAKEUP_GPIO;
+            return ESP_OK;
+        }
+        if (timerUs > 0 && SimHardware::nowMicros() - start >= timerUs) {
+            lastCause = ESP_SLEEP_WAKEUP_TIMER;
+            return ESP_OK;
+        }
+        SimHardware::sleepMicros(POLL_US);
+    }
+}
+
+void esp_deep_sleep_start() {
+    fprintf(stderr, "esp_deep_sleep_start: deep sleep is not simulated, exiting\n");
+    exit(0);
+}
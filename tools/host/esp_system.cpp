@@ -0,0 +1,69 @@
+/*
+ * Host ESP System Shim Implementation
+ *
+ * RTC_NOINIT_ATTR variables are placed in their own section. When
+ * PDU_RTC_FILE is set, that section is replaced by a shared mapping of the
+ * file before setup() runs, so whatever the firmware last wrote there is
+ * still present when the next pdu_host starts, even after kill -9. Together
+ * with PDU_RESET_REASON this simulates a watchdog or panic restart:
+ *
+ *   PDU_RTC_FILE=/tmp/rtc.bin ./build/pdu_host                        (kill it)
+ *   PDU_RTC_FILE=/tmp/rtc.bin PDU_RESET_REASON=wdt ./build/pdu_host
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "esp_system.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+const size_t PAGE_SIZE = 4096;
+
+// Linked after the firmware objects, so this ends the section on a page boundary; the
+// alignment also makes the whole section start on one
+__attribute__((section("rtc_noinit"), aligned(PAGE_SIZE), used)) char rtcEnd[PAGE_SIZE];
+
+struct ResetReasonName {
+    const char* name;
+    esp_reset_reason_t reason;
+};
+
+const ResetReasonName RESET_REASONS[] = {
+    { "poweron", ESP_RST_POWERON }, { "ext", ESP_RST_EXT }, { "sw", ESP_RST_SW },
+    { "panic", ESP_RST_PANIC }, { "int_wdt", ESP_RST_INT_WDT }, { "task_wdt", ESP_RST_TASK_WDT },
+    { "wdt", ESP_RST_WDT }, { "deepsleep", ESP_RST_DEEPSLEEP }, { "brownout", ESP_RST_BROWNOUT },
+};
+}
+
+extern "C" char __start_rtc_noinit[];
+
+__attribute__((constructor)) static void mapRtcMemory() {
+    const char* path = getenv("PDU_RTC_FILE");
+    if (path == nullptr) return;
+
+    size_t size = rtcEnd - __start_rtc_noinit;
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || ftruncate(fd, size) != 0 ||
+        mmap(__start_rtc_noinit, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        fprintf(stderr, "PDU_RTC_FILE: cannot map %s\n", path);
+        exit(1);
+    }
+    close(fd);
+}
+
+esp_reset_reason_t esp_reset_reason() {
+    const char* value = getenv("PDU_RESET_REASON");
+    if (value == nullptr) return ESP_RST_POWERON;
+    for (const ResetReasonName& entry : RESET_REASONS) {
+        if (strcmp(value, entry.name) == 0) return entry.reason;
+    }
+    return ESP_RST_UNKNOWN;
+}
@@ -0,0 +1,46 @@
+/*
+ * Host FreeRTOS Shim
+ *
+ * Maps the handful of FreeRTOS primitives used by the firmware onto
+ * std::thread and std::mutex.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <mutex>
+
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7fffffff
+#define configMAX_PRIORITIES 25
+
+struct portMUX_TYPE {
+    std::recursive_mutex mutex;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+inline void portENTER_CRITICAL(portMUX_TYPE* mux) { mux->mutex.lock(); }
+inline void portEXIT_CRITICAL(portMUX_TYPE* mux) { mux->mutex.unlock(); }
+inline void portENTER_CRITICAL_ISR(portMUX_TYPE* mux) { mux->mutex.lock(); }
+inline void portEXIT_CRITICAL_ISR(portMUX_TYPE* mux) { mux->mutex.unlock(); }
+#define portYIELD_FROM_ISR(...) do {} while (0)
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,29 @@
+/*
+ * Host Heap Accounting Header
+ *
+ * The host build replaces global operator new/delete so that the ESP heap
+ * APIs can report a simulated free heap, its low-water mark and the number
+ * of allocations performed by the firmware.
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef HOST_HEAP_H
+#define HOST_HEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOST_HEAP_SIZE (320 * 1024)  // Roughly the free DRAM of an ESP32 running Wi-Fi
+
+class HostHeap {
+public:
+    static size_t getLiveBytes();
+    static size_t getPeakBytes();
+    static uint64_t getAllocCount();
+};
+
+#endif // HOST_HEAP_H
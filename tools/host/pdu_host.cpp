@@ -0,0 +1,73 @@
+/*
+ * PDU Host Runner
+ *
+ * Runs the unmodified firmware (setup()/loop() from src/) on Linux against
+ * simulated hardware. Servers listen on loopback at port + PDU_PORT_OFFSET
+ * (default 8000, so the web UI is on 8080). Serial input is read from stdin.
+ *
+ * Usage:
+ *   pdu_host [--ign 0|1] [--temp C] [--battery-adc N] [--ign-toggle S]
+ *
+ * --ign-toggle flips the IGN input every S seconds (drive/park cycles, e.g.
+ * to exercise parked mode).
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include <Arduino.h>
+#include <signal.h>
+#include <thread>
+#include "pdu_config.h"
+#include "sim_hardware.h"
+
+void setup();
+void loop();
+
+int main(int argc, char** argv) {
+    int ign = HIGH;
+    float temp = 25.0f;
+    int batteryAdc = 1185;  // ~12.6 V through the firmware's divider formula
+    float ignToggle = 0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        String arg = argv[i];
+        if (arg == "--ign") ign = atoi(argv[i + 1]) ? HIGH : LOW;
+        else if (arg == "--temp") temp = atof(argv[i + 1]);
+        else if (arg == "--battery-adc") batteryAdc = atoi(argv[i + 1]);
+        else if (arg == "--ign-toggle") ignToggle = atof(argv[i + 1]);
+        else {
+            fprintf(stderr, "usage: pdu_host [--ign 0|1] [--temp C] [--battery-adc N] [--ign-toggle S]\n");
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    // Healthy unit at rest: fuses intact, no VP fault
+    SimHardware::setPin(F1_PIN, HIGH);
+    SimHardware::setPin(F2_PIN, HIGH);
+    SimHardware::setPin(F3_PIN, HIGH);
+    SimHardware::setPin(F4_PIN, HIGH);
+    SimHardware::setPin(VP_PIN, LOW);
+    SimHardware::setPin(IGN_PIN, ign);
+    SimHardware::setAnalog(BAT_PIN, batteryAdc);
+    SimHardware::setTemperature(temp);
+
+    if (ignToggle > 0) {
+        std::thread([ignToggle]() {
+            for (;;) {
+                SimHardware::sleepMicros(ignToggle * 1e6);
+                SimHardware::setPin(IGN_PIN, SimHardware::getPin(IGN_PIN) == HIGH ? LOW : HIGH);
+            }
+        }).detach();
+    }
+
+    setup();
+    for (;;) {
+        loop();
+    }
+}
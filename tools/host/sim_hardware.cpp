@@ -0,0 +1,121 @@
+/*
+ * Simulated Hardware Implementation
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include "sim_hardware.h"
+#include "Arduino.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+struct PinState {
+    std::atomic<int> level{LOW};
+    std::atomic<int> analog{0};
+    uint8_t mode = INPUT;
+    void (*handler)(void*) = nullptr;
+    void* arg = nullptr;
+    int interruptMode = 0;
+};
+
+PinState pins[SIM_PIN_COUNT];
+std::recursive_mutex interruptMutex;
+std::atomic<bool> virtualTime{false};
+std::atomic<uint64_t> virtualMicros{0};
+std::thread::id clockOwner;
+std::atomic<float> temperature{25.0f};
+const auto startTime = std::chrono::steady_clock::now();
+
+}
+
+void SimHardware::setVirtualTime(bool enabled) {
+    // Only the calling thread drives virtual time; background tasks keep sleeping in real time
+    clockOwner = std::this_thread::get_id();
+    virtualTime = enabled;
+}
+
+bool SimHardware::isVirtualTime() {
+    return virtualTime;
+}
+
+uint64_t SimHardware::nowMicros() {
+    if (virtualTime) return virtualMicros;
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+void SimHardware::advanceMicros(uint64_t us) {
+    virtualMicros += us;
+}
+
+void SimHardware::sleepMicros(uint64_t us) {
+    if (virtualTime && std::this_thread::get_id() == clockOwner) advanceMicros(us);
+    else std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void SimHardware::setPin(uint8_t pin, int level) {
+    if (pin >= SIM_PIN_COUNT) return;
+    PinState& state = pins[pin];
+    int previous = state.level.exchange(level);
+    if (previous == level) return;
+
+    // Interrupt handlers run serialized, like the single GPIO interrupt on the ESP32
+    std::lock_guard<std::recursive_mutex> lock(interruptMutex);
+    bool fire = state.interruptMode == CHANGE ||
+                (state.interruptMode == RISING && level == HIGH) ||
+                (state.interruptMode == FALLING && level == LOW);
+    if (fire && state.handler) state.handler(state.arg);
+}
+
+int SimHardware::getPin(uint8_t pin) {
+    return pin < SIM_PIN_COUNT ? pins[pin].level.load() : LOW;
+}
+
+void SimHardware::setPinMode(uint8_t pin, uint8_t mode) {
+    if (pin < SIM_PIN_COUNT) pins[pin].mode = mode;
+}
+
+void SimHardware::writePin(uint8_t pin, int level) {
+    if (pin < SIM_PIN_COUNT) pins[pin].level = level;
+}
+
+void SimHardware::attachInterrupt(uint8_t pin, void (*handler)(void*), void* arg, int mode) {
+    if (pin >= SIM_PIN_COUNT) return;
+    std::lock_guard<std::recursive_mutex> lock(interruptMutex);
+    pins[pin].handler = handler;
+    pins[pin].arg = arg;
+    pins[pin].interruptMode = mode;
+}
+
+void SimHardware::detachInterrupt(uint8_t pin) {
+    attachInterrupt(pin, nullptr, nullptr, 0);
+}
+
+void SimHardware::setAnalog(uint8_t pin, int value) {
+    if (pin < SIM_PIN_COUNT) pins[pin].analog = value;
+}
+
+int SimHardware::getAnalog(uint8_t pin) {
+    return pin < SIM_PIN_COUNT ? pins[pin].analog.load() : 0;
+}
+
+void SimHardware::setTemperature(float celsius) {
+    temperature = celsius;
+}
+
+float SimHardware::getTemperature() {
+    return temperature;
+}
+
+uint16_t SimHardware::mapPort(uint16_t port) {
+    const char* offset = getenv("PDU_PORT_OFFSET");
+    return port + (offset ? atoi(offset) : 8000);
+}
@@ -0,0 +1,50 @@
+/*
+ * Simulated Hardware Header
+ *
+ * Host-side model of the ESP32 pins, ADC, DS18B20 and clock used by the
+ * Arduino shims in this directory. Inputs can be driven from host code
+ * (edges fire attached interrupt handlers), and the clock can run in real
+ * time or in virtual time where delay() on the thread that enabled it
+ * advances time instantly (other threads still sleep in real time).
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#ifndef SIM_HARDWARE_H
+#define SIM_HARDWARE_H
+
+#include <stdint.h>
+
+#define SIM_PIN_COUNT 40
+
+class SimHardware {
+public:
+    // Clock
+    static void setVirtualTime(bool enabled);
+    static bool isVirtualTime();
+    static uint64_t nowMicros();
+    static void advanceMicros(uint64_t us);
+    static void sleepMicros(uint64_t us);
+
+    // Digital pins (inputs driven by the simulation, outputs written by firmware)
+    static void setPin(uint8_t pin, int level);
+    static int getPin(uint8_t pin);
+    static void setPinMode(uint8_t pin, uint8_t mode);
+    static void writePin(uint8_t pin, int level);
+    static void attachInterrupt(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+    static void detachInterrupt(uint8_t pin);
+
+    // Analog inputs and temperature sensor
+    static void setAnalog(uint8_t pin, int value);
+    static int getAnalog(uint8_t pin);
+    static void setTemperature(float celsius);
+    static float getTemperature();
+
+    // Port mapping for network servers (port + offset, PDU_PORT_OFFSET env, default 8000)
+    static uint16_t mapPort(uint16_t port);
+};
+
+#endif // SIM_HARDWARE_H
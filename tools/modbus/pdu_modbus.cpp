@@ -0,0 +1,342 @@
+/*
+ * PDU Modbus Client
+ *
+ * Host-side Modbus TCP client for the PDU's register map (see
+ * include/pdu_modbus.h). It reads and writes single tables, or decodes the
+ * whole map with "status". With --connections and --repeat it keeps
+ * several connections open with a request outstanding on each, which
+ * exercises the server's concurrent connection handling and reports the
+ * request rate on stderr.
+ *
+ * Usage:
+ *   pdu_modbus [options] COMMAND [ARGS]
+ *     --host HOST            Server address (default 127.0.0.1)
+ *     --port PORT            Server port (default 8502, pdu_host's 502 + PDU_PORT_OFFSET)
+ *     --unit N               Unit id (default 1)
+ *     --timeout MS           Reply timeout (default 2000)
+ *     --connections N        Connections used at once (default 1)
+ *     --repeat N             Requests per connection (default 1)
+ *
+ *   Commands:
+ *     status                         Read every table and print it decoded
+ *     read-coils ADDR COUNT          Also read-inputs, read-holding, read-input-registers
+ *     write-coil ADDR 0|1
+ *     write-coils ADDR V[,V...]
+ *     write-register ADDR VALUE
+ *     write-registers ADDR V[,V...]
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+// Table sizes of the firmware's register map
+static const int COIL_COUNT = 6;
+static const int INPUT_COUNT = 5;
+static const int INPUT_REGISTER_COUNT = 10;
+static const int HOLDING_REGISTER_COUNT = 2;
+
+struct Options {
+    const char* host = "127.0.0.1";
+    int port = 8502;
+    uint8_t unit = 1;
+    int timeoutMs = 2000;
+    int connections = 1;
+    long repeat = 1;
+};
+
+static long nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static const char* exceptionName(uint8_t code) {
+    switch (code) {
+        case 0x01: return "illegal function";
+        case 0x02: return "illegal data address";
+        case 0x03: return "illegal data value";
+        case 0x06: return "server device busy";
+        default: return "exception";
+    }
+}
+
+static int connectTo(const Options& options) {
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    char service[8];
+    snprintf(service, sizeof(service), "%d", options.port);
+    if (getaddrinfo(options.host, service, &hints, &result) != 0) return -1;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    timeval timeout = { options.timeoutMs / 1000, (options.timeoutMs % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+static bool readAll(int fd, uint8_t* buffer, size_t size) {
+    while (size > 0) {
+        ssize_t n = recv(fd, buffer, size, 0);
+        if (n <= 0) return false;
+        buffer += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool sendRequest(int fd, uint16_t transaction, uint8_t unit, const Bytes& pdu) {
+    Bytes frame = { (uint8_t)(transaction >> 8), (uint8_t)transaction, 0, 0,
+                    (uint8_t)((pdu.size() + 1) >> 8), (uint8_t)(pdu.size() + 1), unit };
+    frame.insert(frame.end(), pdu.begin(), pdu.end());
+    return send(fd, frame.data(), frame.size(), MSG_NOSIGNAL) == (ssize_t)frame.size();
+}
+
+// Reads one reply into pdu; false on timeout, disconnect or a mismatched transaction
+static bool receiveReply(int fd, uint16_t transaction, Bytes& pdu) {
+    uint8_t header[7];
+    if (!readAll(fd, header, sizeof(header))) return false;
+    uint16_t replyTransaction = header[0] << 8 | header[1];
+    uint16_t length = header[4] << 8 | header[5];
+    if (replyTransaction != transaction || length < 2) return false;
+    pdu.resize(length - 1);
+    return readAll(fd, pdu.data(), pdu.size());
+}
+
+static bool checkReply(const Bytes& request, const Bytes& reply) {
+    if (reply.size() >= 2 && reply[0] == (request[0] | 0x80)) {
+        fprintf(stderr, "pdu_modbus: function %u: %s (%u)\n", request[0], exceptionName(reply[1]), reply[1]);
+        return false;
+    }
+    if (reply.empty() || reply[0] != request[0]) {
+        fprintf(stderr, "pdu_modbus: unexpected reply to function %u\n", request[0]);
+        return false;
+    }
+    return true;
+}
+
+static Bytes makeRead(uint8_t function, uint16_t start, uint16_t count) {
+    return { function, (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(count >> 8), (uint8_t)count };
+}
+
+static std::vector<uint16_t> decodeValues(const Bytes& request, const Bytes& reply) {
+    std::vector<uint16_t> values;
+    uint16_t count = request[3] << 8 | request[4];
+    for (uint16_t i = 0; i < count; i++) {
+        if (request[0] <= 0x02) {
+            size_t byte = 2 + i / 8;
+            values.push_back(byte < reply.size() ? (reply[byte] >> (i % 8)) & 1 : 0);
+        } else {
+            size_t offset = 2 + i * 2;
+            values.push_back(offset + 1 < reply.size() ? reply[offset] << 8 | reply[offset + 1] : 0);
+        }
+    }
+    return values;
+}
+
+static bool parseList(const char* text, std::vector<uint16_t>& values) {
+    std::string list(text);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        std::string item = list.substr(start, end - start);
+        char* stop = nullptr;
+        long value = strtol(item.c_str(), &stop, 0);
+        if (item.empty() || *stop != '\0' || value < -32768 || value > 65535) return false;
+        values.push_back((uint16_t)value);
+        start = end + 1;
+    }
+    return !values.empty();
+}
+
+static bool buildRequest(int argc, char** argv, Bytes& request) {
+    if (argc < 1) return false;
+    const char* command = argv[0];
+    static const struct { const char* name; uint8_t function; } reads[] = {
+        { "read-coils", 0x01 }, { "read-inputs", 0x02 }, { "read-holding", 0x03 }, { "read-input-registers", 0x04 }
+    };
+    for (const auto& read : reads) {
+        if (strcmp(command, read.name) == 0 && argc == 3) {
+            request = makeRead(read.function, atoi(argv[1]), atoi(argv[2]));
+            return true;
+        }
+    }
+
+    if (argc != 3) return false;
+    uint16_t start = atoi(argv[1]);
+    std::vector<uint16_t> values;
+    if (!parseList(argv[2], values)) return false;
+
+    if (strcmp(command, "write-coil") == 0 && values.size() == 1) {
+        request = { 0x05, (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(values[0] ? 0xFF : 0x00), 0x00 };
+    } else if (strcmp(command, "write-register") == 0 && values.size() == 1) {
+        request = { 0x06, (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(values[0] >> 8), (uint8_t)values[0] };
+    } else if (strcmp(command, "write-coils") == 0) {
+        request = { 0x0F, (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(values.size() >> 8),
+                    (uint8_t)values.size(), (uint8_t)((values.size() + 7) / 8) };
+        request.resize(request.size() + (values.size() + 7) / 8, 0);
+        for (size_t i = 0; i < values.size(); i++) {
+            if (values[i]) request[6 + i / 8] |= 1 << (i % 8);
+        }
+    } else if (strcmp(command, "write-registers") == 0) {
+        request = { 0x10, (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(values.size() >> 8),
+                    (uint8_t)values.size(), (uint8_t)(values.size() * 2) };
+        for (uint16_t value : values) {
+            request.push_back(value >> 8);
+            request.push_back(value & 0xFF);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void printValues(const Bytes& request, const Bytes& reply) {
+    if (request[0] > 0x04) {
+        printf("OK\n");
+        return;
+    }
+    uint16_t start = request[1] << 8 | request[2];
+    std::vector<uint16_t> values = decodeValues(request, reply);
+    for (size_t i = 0; i < values.size(); i++) printf("%u:%u\n", (unsigned)(start + i), values[i]);
+}
+
+static bool transact(int fd, uint16_t transaction, const Options& options, const Bytes& request, Bytes& reply) {
+    if (!sendRequest(fd, transaction, options.unit, request) || !receiveReply(fd, transaction, reply)) {
+        fprintf(stderr, "pdu_modbus: no reply from %s:%d\n", options.host, options.port);
+        return false;
+    }
+    return checkReply(request, reply);
+}
+
+static int printStatus(int fd, const Options& options) {
+    Bytes requests[] = {
+        makeRead(0x01, 0, COIL_COUNT), makeRead(0x02, 0, INPUT_COUNT),
+        makeRead(0x04, 0, INPUT_REGISTER_COUNT), makeRead(0x03, 0, HOLDING_REGISTER_COUNT)
+    };
+    std::vector<uint16_t> tables[4];
+    for (int i = 0; i < 4; i++) {
+        Bytes reply;
+        if (!transact(fd, i + 1, options, requests[i], reply)) return 1;
+        tables[i] = decodeValues(requests[i], reply);
+    }
+
+    const std::vector<uint16_t>& coils = tables[0];
+    const std::vector<uint16_t>& inputs = tables[1];
+    const std::vector<uint16_t>& registers = tables[2];
+    const std::vector<uint16_t>& holding = tables[3];
+    auto word32 = [&](int address) { return (unsigned long)registers[address] << 16 | registers[address + 1]; };
+
+    for (int channel = 0; channel < 4; channel++) printf("CH%d:%s\n", channel + 1, coils[channel] ? "ON" : "OFF");
+    printf("RELAY:%s\n", coils[4] ? "ON" : "OFF");
+    printf("VPLOCK:%u\n", coils[5]);
+    for (int fuse = 0; fuse < 4; fuse++) printf("F%d:%u\n", fuse + 1, inputs[fuse]);
+    printf("IGN:%u\n", inputs[4]);
+    printf("TEMP:%.2f\n", (int16_t)registers[0] / 100.0);
+    printf("BATTERY:%.2f\n", registers[1] / 100.0);
+    printf("VPTRIPS:%lu\n", word32(2));
+    printf("VPTRIP_LATENCY_US:%lu\n", word32(4));
+    printf("VPTRIP_MAX_LATENCY_US:%lu\n", word32(6));
+    printf("VERSION:%lu\n", word32(8));
+    printf("TSTEMP:%.2f\n", (int16_t)holding[0] / 100.0);
+    printf("TSTIME_S:%u\n", holding[1]);
+    return 0;
+}
+
+static int usage() {
+    fprintf(stderr,
+            "usage: pdu_modbus [--host HOST] [--port PORT] [--unit N] [--timeout MS] [--connections N] [--repeat N]\n"
+            "                  status | read-coils|read-inputs|read-holding|read-input-registers ADDR COUNT |\n"
+            "                  write-coil|write-register ADDR VALUE | write-coils|write-registers ADDR V[,V...]\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    int i = 1;
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!hasValue) return usage();
+        if (strcmp(argv[i], "--host") == 0) options.host = argv[++i];
+        else if (strcmp(argv[i], "--port") == 0) options.port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--unit") == 0) options.unit = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--timeout") == 0) options.timeoutMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--connections") == 0) options.connections = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--repeat") == 0) options.repeat = atol(argv[++i]);
+        else return usage();
+    }
+    if (i >= argc || options.connections < 1 || options.repeat < 1) return usage();
+
+    bool status = strcmp(argv[i], "status") == 0 && i + 1 == argc;
+    Bytes request;
+    if (!status && !buildRequest(argc - i, argv + i, request)) return usage();
+
+    std::vector<int> sockets;
+    for (int c = 0; c < options.connections; c++) {
+        int fd = connectTo(options);
+        if (fd < 0) {
+            fprintf(stderr, "pdu_modbus: cannot connect to %s:%d\n", options.host, options.port);
+            return 1;
+        }
+        sockets.push_back(fd);
+    }
+    if (status) return printStatus(sockets[0], options);
+
+    // One request outstanding on every connection at a time
+    long start = nowMs();
+    Bytes reply;
+    for (long round = 0; round < options.repeat; round++) {
+        uint16_t transaction = (uint16_t)(round + 1);
+        for (int fd : sockets) {
+            if (!sendRequest(fd, transaction, options.unit, request)) {
+                fprintf(stderr, "pdu_modbus: send failed\n");
+                return 1;
+            }
+        }
+        for (int fd : sockets) {
+            if (!receiveReply(fd, transaction, reply)) {
+                fprintf(stderr, "pdu_modbus: no reply from %s:%d\n", options.host, options.port);
+                return 1;
+            }
+            if (!checkReply(request, reply)) return 1;
+        }
+    }
+    long elapsed = nowMs() - start;
+
+    printValues(request, reply);
+    long total = options.repeat * options.connections;
+    if (total > 1) {
+        fprintf(stderr, "[modbus] %ld requests over %d connection(s) in %ld ms (%.0f req/s)\n", total,
+                options.connections, elapsed, elapsed > 0 ? total * 1000.0 / elapsed : 0.0);
+    }
+    return 0;
+}
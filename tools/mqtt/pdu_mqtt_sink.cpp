@@ -0,0 +1,348 @@
+/*
+ * PDU MQTT Telemetry Sink
+ *
+ * Host-side stand-in for the MQTT broker that the PDU publishes telemetry
+ * to (see include/pdu_telemetry.h). It accepts MQTT 3.1.1 connections,
+ * acknowledges QoS 1 publishes and keep-alive pings, and decodes each
+ * telemetry batch: one line per batch, and with --verbose one line per
+ * sample and event. Behind a real broker, the payloads can be fed in as
+ * hex instead, e.g.
+ *
+ *   mosquitto_sub -t 'pdu/+/telemetry' -F %x | pdu_mqtt_sink --hex
+ *
+ * After every batch it reports the bytes received per sample against the
+ * same samples sent as one JSON message each (the /api/status field names,
+ * QoS 1 publish to the same topic), and with 40 bytes of TCP/IP headers per
+ * packet as a rough airtime figure.
+ *
+ * Usage:
+ *   pdu_mqtt_sink [options]
+ *     --port PORT            Listening port (default 1883)
+ *     --hex                  Decode hex payloads from stdin, one per line
+ *     --verbose              Print every sample and event
+ *     --batches N            Exit after N batches (default: run until killed)
+ *     --pause-after N        Stop answering after N batches, so the PDU spools;
+ *                            resume with SIGUSR1
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static const int FORMAT = 1;
+static const int PACKET_OVERHEAD = 40;      // IPv4 + TCP headers per packet
+
+struct Options {
+    int port = 1883;
+    bool hex = false;
+    bool verbose = false;
+    long batches = 0;
+    long pauseAfter = 0;
+};
+
+struct Totals {
+    long batches = 0;
+    long samples = 0;
+    long events = 0;
+    long lost = 0;
+    long payloadBytes = 0;
+    long mqttBytes = 0;             // Received from the PDU, all MQTT packets
+    long packets = 0;               // Reads from the socket (an upper bound on TCP segments)
+    long jsonBytes = 0;             // Same samples as one JSON publish each
+    long jsonPackets = 0;
+};
+
+static volatile sig_atomic_t resumeRequested = 0;
+
+static void onResume(int) {
+    resumeRequested = 1;
+}
+
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t length) : data(data), end(data + length) {}
+    bool atEnd() const { return data >= end; }
+    bool byte(uint8_t& value) {
+        if (data >= end) return false;
+        value = *data++;
+        return true;
+    }
+    bool varint(uint32_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t c;
+            if (!byte(c)) return false;
+            value |= (uint32_t)(c & 0x7F) << shift;
+            if (!(c & 0x80)) return true;
+        }
+        return false;
+    }
+    bool zigzag(int32_t& value) {
+        uint32_t raw;
+        if (!varint(raw)) return false;
+        value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+        return true;
+    }
+
+private:
+    const uint8_t* data;
+    const uint8_t* end;
+};
+
+// Bytes of a QoS 1 PUBLISH carrying payloadLength bytes to topic
+static long publishSize(size_t topicLength, size_t payloadLength) {
+    size_t remaining = 2 + topicLength + 2 + payloadLength;
+    size_t lengthBytes = remaining < 128 ? 1 : remaining < 16384 ? 2 : 3;
+    return 1 + lengthBytes + remaining;
+}
+
+static bool decodeBatch(const std::string& topic, const Bytes& payload, const Options& options, Totals& totals) {
+    Reader reader(payload.data(), payload.size());
+    uint8_t version;
+    uint32_t number, boot, t0, interval;
+    if (!reader.byte(version) || version != FORMAT || !reader.varint(number) || !reader.varint(boot) ||
+        !reader.varint(t0) || !reader.varint(interval)) {
+        fprintf(stderr, "pdu_mqtt_sink: %s: not a telemetry batch (format %u)\n", topic.c_str(), payload.empty() ? 0 : payload[0]);
+        return false;
+    }
+
+    uint32_t time = t0 - interval;
+    uint32_t eventUs = t0 * 1000;
+    uint32_t flags = 0, trips = 0;
+    int32_t temp = 0, battery = 0;
+    long samples = 0, events = 0, lost = 0;
+    while (!reader.atEnd()) {
+        uint8_t head;
+        reader.byte(head);
+        bool ok = true;
+        if (head == 0xC0) {
+            uint32_t count;
+            ok = reader.varint(count);
+            lost += count;
+            if (ok && options.verbose) printf("  lost %u events\n", count);
+        } else if ((head & 0xC0) == 0x80) {
+            uint32_t pin;
+            int32_t delta;
+            ok = reader.varint(pin) && reader.zigzag(delta);
+            eventUs += delta;
+            events++;
+            if (ok && options.verbose) printf("  event t=%uus pin=%u level=%u\n", eventUs, pin, head & 1);
+        } else if ((head & 0x80) == 0) {
+            // Fields not present are unchanged; the time step defaults to the interval
+            uint32_t elapsed = interval, flagChanges = 0, tripChanges = 0;
+            int32_t tempChange = 0, batteryChange = 0;
+            if (head & 0x01) ok = ok && reader.varint(elapsed);
+            if (head & 0x02) ok = ok && reader.varint(flagChanges);
+            if (head & 0x04) ok = ok && reader.zigzag(tempChange);
+            if (head & 0x08) ok = ok && reader.zigzag(batteryChange);
+            if (head & 0x10) ok = ok && reader.varint(tripChanges);
+            time += elapsed;
+            flags ^= flagChanges;
+            temp += tempChange;
+            battery += batteryChange;
+            trips += tripChanges;
+            samples++;
+
+            char json[256];
+            int jsonLength = snprintf(json, sizeof(json),
+                "{\"t\":%u,\"F1\":%u,\"F2\":%u,\"F3\":%u,\"F4\":%u,\"ign\":%u,\"temp\":%.2f,\"battery\":%.2f,"
+                "\"relay\":%u,\"CH1\":%u,\"CH2\":%u,\"CH3\":%u,\"CH4\":%u,\"vpTrips\":%u,\"vpLocked\":%u}",
+                time, flags & 1, flags >> 1 & 1, flags >> 2 & 1, flags >> 3 & 1, flags >> 4 & 1, temp / 100.0,
+                battery / 100.0, flags >> 5 & 1, flags >> 7 & 1, flags >> 8 & 1, flags >> 9 & 1, flags >> 10 & 1,
+                trips, flags >> 6 & 1);
+            totals.jsonBytes += publishSize(topic.size(), jsonLength);
+            totals.jsonPackets++;
+            if (ok && options.verbose) printf("  %s\n", json);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "pdu_mqtt_sink: %s: batch %u truncated or malformed\n", topic.c_str(), number);
+            return false;
+        }
+    }
+
+    totals.batches++;
+    totals.samples += samples;
+    totals.events += events;
+    totals.lost += lost;
+    totals.payloadBytes += payload.size();
+    printf("batch boot=%u n=%u t0=%ums samples=%ld events=%ld lost=%ld bytes=%zu (%.2f/sample)\n", boot, number, t0,
+           samples, events, lost, payload.size(), samples ? (double)payload.size() / samples : 0.0);
+    return true;
+}
+
+static void printTotals(const Totals& totals) {
+    if (totals.samples == 0) return;
+    double received = totals.mqttBytes > 0 ? totals.mqttBytes : totals.payloadBytes;
+    double air = received + (double)totals.packets * PACKET_OVERHEAD;
+    double jsonAir = totals.jsonBytes + (double)totals.jsonPackets * PACKET_OVERHEAD;
+    printf("total batches=%ld samples=%ld events=%ld lost=%ld | per sample: batched %.2f B (%.2f B on air), "
+           "JSON per reading %.2f B (%.2f B on air), %.1fx less\n",
+           totals.batches, totals.samples, totals.events, totals.lost, received / totals.samples,
+           air / totals.samples, (double)totals.jsonBytes / totals.samples, jsonAir / totals.samples,
+           air > 0 ? jsonAir / air : 0.0);
+    fflush(stdout);
+}
+
+static bool done(const Options& options, const Totals& totals) {
+    return options.batches > 0 && totals.batches >= options.batches;
+}
+
+static int runHex(const Options& options) {
+    Totals totals;
+    char line[16384];
+    while (fgets(line, sizeof(line), stdin) != nullptr) {
+        Bytes payload;
+        for (char* c = line; isxdigit((unsigned char)c[0]) && isxdigit((unsigned char)c[1]); c += 2) {
+            char pair[3] = { c[0], c[1], 0 };
+            payload.push_back(strtoul(pair, nullptr, 16));
+        }
+        if (payload.empty()) continue;
+        totals.packets++;
+        if (decodeBatch("hex", payload, options, totals)) printTotals(totals);
+        if (done(options, totals)) break;
+    }
+    return 0;
+}
+
+// Handles the complete packets at the front of buffer; false ends the connection
+static bool handlePackets(int fd, Bytes& buffer, const Options& options, Totals& totals) {
+    for (;;) {
+        if (buffer.size() < 2) return true;
+        size_t remaining = 0, header = 1;
+        for (int shift = 0;; shift += 7) {
+            if (header >= buffer.size()) return true;
+            uint8_t c = buffer[header++];
+            remaining |= (size_t)(c & 0x7F) << shift;
+            if (!(c & 0x80)) break;
+            if (shift >= 21) return false;
+        }
+        if (buffer.size() < header + remaining) return true;
+
+        uint8_t type = buffer[0] >> 4;
+        const uint8_t* body = buffer.data() + header;
+        if (type == 1) {            // CONNECT
+            size_t protocolLength = body[0] << 8 | body[1];
+            size_t idOffset = 2 + protocolLength + 4;
+            std::string clientId(body + idOffset + 2, body + idOffset + 2 + (body[idOffset] << 8 | body[idOffset + 1]));
+            printf("connect %s\n", clientId.c_str());
+            static const uint8_t connack[] = { 0x20, 2, 0, 0 };
+            send(fd, connack, sizeof(connack), MSG_NOSIGNAL);
+        } else if (type == 3) {     // PUBLISH
+            uint8_t qos = buffer[0] >> 1 & 3;
+            size_t topicLength = body[0] << 8 | body[1];
+            std::string topic(body + 2, body + 2 + topicLength);
+            size_t offset = 2 + topicLength;
+            uint16_t packetId = 0;
+            if (qos > 0) {
+                packetId = body[offset] << 8 | body[offset + 1];
+                offset += 2;
+            }
+            Bytes payload(body + offset, body + remaining);
+            decodeBatch(topic, payload, options, totals);
+            printTotals(totals);
+            if (qos == 1) {
+                uint8_t puback[] = { 0x40, 2, (uint8_t)(packetId >> 8), (uint8_t)packetId };
+                send(fd, puback, sizeof(puback), MSG_NOSIGNAL);
+            }
+        } else if (type == 12) {    // PINGREQ
+            static const uint8_t pingresp[] = { 0xD0, 0 };
+            send(fd, pingresp, sizeof(pingresp), MSG_NOSIGNAL);
+        } else if (type == 14) {    // DISCONNECT
+            return false;
+        }
+        buffer.erase(buffer.begin(), buffer.begin() + header + remaining);
+        if (done(options, totals)) return false;
+    }
+}
+
+static int runBroker(const Options& options) {
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(options.port);
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 4) < 0) {
+        fprintf(stderr, "pdu_mqtt_sink: cannot listen on port %d\n", options.port);
+        return 1;
+    }
+    fprintf(stderr, "pdu_mqtt_sink: listening on 127.0.0.1:%d\n", options.port);
+
+    Totals totals;
+    bool paused = false;
+    while (!done(options, totals)) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        Bytes buffer;
+        for (;;) {
+            if (!paused && options.pauseAfter > 0 && totals.batches >= options.pauseAfter && !resumeRequested) {
+                fprintf(stderr, "pdu_mqtt_sink: paused after %ld batches (SIGUSR1 resumes)\n", totals.batches);
+                paused = true;
+            }
+            if (paused) {
+                // Unreachable broker: drop the connection and accept nothing until resumed
+                if (!resumeRequested) break;
+                fprintf(stderr, "pdu_mqtt_sink: resumed\n");
+                paused = false;
+            }
+
+            pollfd pfd = { fd, POLLIN, 0 };
+            if (poll(&pfd, 1, 200) == 0) continue;
+            uint8_t data[4096];
+            ssize_t n = recv(fd, data, sizeof(data), 0);
+            if (n <= 0) break;
+            totals.mqttBytes += n;
+            totals.packets++;
+            buffer.insert(buffer.end(), data, data + n);
+            if (!handlePackets(fd, buffer, options, totals)) break;
+        }
+        close(fd);
+        while (paused && !resumeRequested) usleep(100000);
+    }
+    close(listenFd);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--port") == 0 && hasValue) options.port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--hex") == 0) options.hex = true;
+        else if (strcmp(argv[i], "--verbose") == 0) options.verbose = true;
+        else if (strcmp(argv[i], "--batches") == 0 && hasValue) options.batches = atol(argv[++i]);
+        else if (strcmp(argv[i], "--pause-after") == 0 && hasValue) options.pauseAfter = atol(argv[++i]);
+        else {
+            fprintf(stderr, "usage: pdu_mqtt_sink [--port PORT] [--hex] [--verbose] [--batches N] "
+                            "[--pause-after N]\n");
+            return 2;
+        }
+    }
+    signal(SIGUSR1, onResume);
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    return options.hex ? runHex(options) : runBroker(options);
+}
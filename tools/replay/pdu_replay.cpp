@@ -0,0 +1,550 @@
+/*
+ * PDU Trace Replayer
+ *
+ * Replays a trace recorded by the firmware (SET_TRACE / POST /api/trace)
+ * into the firmware itself (setup()/loop() from src/) under virtual time,
+ * and prints the resulting output timeline: every relay and channel
+ * change with its time since the start of the trace. With --golden the
+ * timeline is compared against a stored copy and the exit status reports
+ * whether the firmware still makes the same decisions.
+ *
+ * The start-up snapshot (input levels, samples, settings) is applied
+ * before setup(), so the replay boots with the recorded configuration;
+ * the rest of the trace is fed in at the recorded times. A trace is read
+ * from any of:
+ *   - the binary download of GET /api/trace
+ *   - a serial capture containing the TRACE:<hex> lines of GET_TRACE
+ *   - the text form printed by --decode (one record per line), which is
+ *     also convenient for writing scenarios by hand:
+ *
+ *       # ms  record
+ *       0     pin IGN 1
+ *       0     temp 25.5
+ *       0     adc BAT 1185
+ *       0     cmd SET_RELAY:1
+ *       0     start
+ *       60000 cmd SET_CH3:1
+ *
+ * Firmware serial output is discarded (sent to stderr with --verbose).
+ *
+ * Usage:
+ *   pdu_replay [--tick-ms N] [--tail-s S] [--verbose] [--golden FILE [--update]] TRACE
+ *   pdu_replay --decode TRACE
+ *   pdu_replay --encode TRACE OUT
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include <Arduino.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "pdu_config.h"
+#include "pdu_controller.h"
+#include "pdu_event_log.h"
+#include "pdu_trace.h"
+#include "SerialCommandHandler.h"
+#include "sim_hardware.h"
+
+void setup();
+void loop();
+extern PDUController pdu;
+
+struct TraceRecord {
+    uint32_t timeMs;    // Since the start of the trace
+    uint8_t type;
+    uint8_t pin;
+    int value;          // Pin level, ADC counts or temperature in 1/16 degC
+    std::string command;
+};
+
+struct PinName {
+    uint8_t pin;
+    const char* name;
+};
+
+static const PinName INPUT_NAMES[] = {
+    { F1_PIN, "F1" }, { F2_PIN, "F2" }, { F3_PIN, "F3" }, { F4_PIN, "F4" },
+    { IGN_PIN, "IGN" }, { VP_PIN, "VP" }, { BAT_PIN, "BAT" }
+};
+
+static const PinName OUTPUT_NAMES[] = {
+    { CH1_PIN, "CH1" }, { CH2_PIN, "CH2" }, { CH3_PIN, "CH3" }, { CH4_PIN, "CH4" }, { RELAY_PIN, "RELAY" }
+};
+
+static const char* inputName(uint8_t pin) {
+    for (const PinName& entry : INPUT_NAMES) {
+        if (entry.pin == pin) return entry.name;
+    }
+    return nullptr;
+}
+
+static int inputPin(const std::string& name) {
+    for (const PinName& entry : INPUT_NAMES) {
+        if (name == entry.name) return entry.pin;
+    }
+    return isdigit((unsigned char)name[0]) ? atoi(name.c_str()) : -1;
+}
+
+// ---------------------------------------------------------------------------
+// Trace formats
+
+static bool readVarint(const std::vector<uint8_t>& data, size_t& pos, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < data.size(); shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static bool parseBinary(const std::vector<uint8_t>& data, std::vector<TraceRecord>& records, std::string& error) {
+    if (data.size() < TRACE_HEADER_SIZE || memcmp(data.data(), TRACE_MAGIC, 4) != 0) {
+        error = "not a trace (bad magic)";
+        return false;
+    }
+    if (data[4] != TRACE_VERSION) {
+        error = "unsupported trace version " + std::to_string(data[4]);
+        return false;
+    }
+
+    uint32_t timeMs = 0;
+    size_t pos = TRACE_HEADER_SIZE;
+    while (pos < data.size()) {
+        size_t recordStart = pos;
+        TraceRecord record = {};
+        record.type = data[pos++];
+        uint32_t delta;
+        if (!readVarint(data, pos, delta)) break;
+        timeMs += delta;
+        record.timeMs = timeMs;
+
+        bool complete = true;
+        switch (record.type) {
+            case TRACE_PIN:
+                complete = pos + 1 <= data.size();
+                if (!complete) break;
+                record.pin = data[pos] & 0x7F;
+                record.value = data[pos] >> 7;
+                pos += 1;
+                break;
+            case TRACE_TEMP:
+                complete = pos + 2 <= data.size();
+                if (!complete) break;
+                record.value = (int16_t)(data[pos] | data[pos + 1] << 8);
+                pos += 2;
+                break;
+            case TRACE_ADC:
+                complete = pos + 3 <= data.size();
+                if (!complete) break;
+                record.pin = data[pos];
+                record.value = data[pos + 1] | data[pos + 2] << 8;
+                pos += 3;
+                break;
+            case TRACE_CMD: {
+                uint32_t length;
+                complete = readVarint(data, pos, length) && pos + length <= data.size();
+                if (!complete) break;
+                record.command.assign((const char*)&data[pos], length);
+                pos += length;
+                break;
+            }
+            case TRACE_START:
+                break;
+            default:
+                error = "unknown record type " + std::to_string(record.type) + " at offset " +
+                        std::to_string(recordStart);
+                return false;
+        }
+        if (!complete) break;
+        records.push_back(record);
+    }
+
+    if (pos < data.size()) {
+        error = "trailing partial record at offset " + std::to_string(pos);
+        return false;
+    }
+    return true;
+}
+
+static bool parseText(const std::string& text, std::vector<TraceRecord>& records, std::string& error) {
+    std::istringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        std::string body = line.substr(0, comment);
+        std::istringstream fields(body);
+        TraceRecord record = {};
+        std::string kind;
+        double timeMs;
+        if (!(fields >> timeMs)) {
+            if (body.find_first_not_of(" \t\r") == std::string::npos) continue;
+            error = "line " + std::to_string(lineNumber) + ": expected a time in ms";
+            return false;
+        }
+        record.timeMs = (uint32_t)timeMs;
+        fields >> kind;
+
+        bool valid = true;
+        if (kind == "pin" || kind == "adc") {
+            std::string name;
+            valid = (bool)(fields >> name >> record.value);
+            int pin = valid ? inputPin(name) : -1;
+            valid = valid && pin >= 0 && pin < 128;
+            record.type = kind == "pin" ? TRACE_PIN : TRACE_ADC;
+            record.pin = pin;
+            if (record.type == TRACE_PIN) record.value = record.value ? 1 : 0;
+        } else if (kind == "temp") {
+            double celsius;
+            valid = (bool)(fields >> celsius);
+            record.type = TRACE_TEMP;
+            record.value = (int)lround(celsius * 16);
+        } else if (kind == "cmd") {
+            // The command is the rest of the original line, so it may contain '#'
+            size_t start = line.find("cmd") + 3;
+            start = line.find_first_not_of(" \t", start);
+            record.type = TRACE_CMD;
+            record.command = start == std::string::npos ? "" : line.substr(start);
+            while (!record.command.empty() && isspace((unsigned char)record.command.back())) {
+                record.command.pop_back();
+            }
+        } else if (kind == "start") {
+            record.type = TRACE_START;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            error = "line " + std::to_string(lineNumber) + ": cannot parse '" + line + "'";
+            return false;
+        }
+        if (!records.empty() && record.timeMs < records.back().timeMs) {
+            error = "line " + std::to_string(lineNumber) + ": time goes backwards";
+            return false;
+        }
+        records.push_back(record);
+    }
+    return true;
+}
+
+static bool loadTrace(const char* path, std::vector<TraceRecord>& records, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (contents.compare(0, 4, TRACE_MAGIC) == 0) {
+        std::vector<uint8_t> data(contents.begin(), contents.end());
+        return parseBinary(data, records, error);
+    }
+
+    // Serial capture of GET_TRACE: collect the TRACE:<hex> lines, ignore everything else
+    if (contents.find("TRACE:") != std::string::npos) {
+        std::vector<uint8_t> data;
+        std::istringstream lines(contents);
+        std::string line;
+        while (std::getline(lines, line)) {
+            size_t start = line.find("TRACE:");
+            if (start == std::string::npos) continue;
+            for (size_t i = start + 6; i + 1 < line.size() && isxdigit((unsigned char)line[i]); i += 2) {
+                data.push_back((uint8_t)strtoul(line.substr(i, 2).c_str(), nullptr, 16));
+            }
+        }
+        return parseBinary(data, records, error);
+    }
+
+    return parseText(contents, records, error);
+}
+
+static void printText(FILE* out, const std::vector<TraceRecord>& records) {
+    fprintf(out, "# ms record\n");
+    for (const TraceRecord& record : records) {
+        const char* name = inputName(record.pin);
+        char pin[8];
+        if (name == nullptr) {
+            snprintf(pin, sizeof(pin), "%u", record.pin);
+            name = pin;
+        }
+        switch (record.type) {
+            case TRACE_PIN: fprintf(out, "%u pin %s %d\n", record.timeMs, name, record.value); break;
+            case TRACE_TEMP: fprintf(out, "%u temp %.4g\n", record.timeMs, record.value / 16.0); break;
+            case TRACE_ADC: fprintf(out, "%u adc %s %d\n", record.timeMs, name, record.value); break;
+            case TRACE_CMD: fprintf(out, "%u cmd %s\n", record.timeMs, record.command.c_str()); break;
+            case TRACE_START: fprintf(out, "%u start\n", record.timeMs); break;
+        }
+    }
+}
+
+static void putVarint(std::vector<uint8_t>& data, uint32_t value) {
+    while (value >= 0x80) {
+        data.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    data.push_back(value);
+}
+
+static bool writeBinary(const char* path, const std::vector<TraceRecord>& records) {
+    std::vector<uint8_t> data(TRACE_MAGIC, TRACE_MAGIC + 4);
+    data.push_back(TRACE_VERSION);
+    uint32_t lastMs = 0;
+    for (const TraceRecord& record : records) {
+        data.push_back(record.type);
+        putVarint(data, record.timeMs - lastMs);
+        lastMs = record.timeMs;
+        switch (record.type) {
+            case TRACE_PIN: data.push_back((record.pin & 0x7F) | (record.value ? 0x80 : 0)); break;
+            case TRACE_TEMP:
+                data.push_back(record.value & 0xFF);
+                data.push_back((record.value >> 8) & 0xFF);
+                break;
+            case TRACE_ADC:
+                data.push_back(record.pin);
+                data.push_back(record.value & 0xFF);
+                data.push_back((record.value >> 8) & 0xFF);
+                break;
+            case TRACE_CMD:
+                putVarint(data, record.command.size());
+                data.insert(data.end(), record.command.begin(), record.command.end());
+                break;
+        }
+    }
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)data.data(), data.size());
+    return (bool)file;
+}
+
+// ---------------------------------------------------------------------------
+// Replay
+
+static void applyInput(const TraceRecord& record) {
+    switch (record.type) {
+        case TRACE_PIN: SimHardware::setPin(record.pin, record.value); break;
+        case TRACE_TEMP: SimHardware::setTemperature(record.value / 16.0f); break;
+        case TRACE_ADC: SimHardware::setAnalog(record.pin, record.value); break;
+    }
+}
+
+class OutputTimeline {
+public:
+    OutputTimeline() : eventSeq(0), startMs(0) {
+        for (const PinName& output : OUTPUT_NAMES) levels.push_back(initialLevel(output.pin));
+    }
+
+    void begin(uint32_t traceStartMs) {
+        startMs = traceStartMs;
+        eventSeq = PDUEventLog::getNextSeq();
+    }
+
+    // Output changes since the last call; repeated writes of the same level are not changes
+    void collect() {
+        PDUEvent events[EVENT_MAX_PER_REQUEST];
+        uint32_t nowMs = millis();
+        uint32_t nowUs = micros();
+        size_t count;
+        do {
+            count = PDUEventLog::read(eventSeq, events, EVENT_MAX_PER_REQUEST, eventSeq);
+            for (size_t i = 0; i < count; i++) {
+                for (size_t index = 0; index < levels.size(); index++) {
+                    if (OUTPUT_NAMES[index].pin != events[i].pin || levels[index] == events[i].level) continue;
+                    levels[index] = events[i].level;
+                    uint32_t eventMs = nowMs - (nowUs - events[i].timestampUs) / 1000 - startMs;
+                    bool on = OUTPUT_NAMES[index].pin == RELAY_PIN ? events[i].level == HIGH : events[i].level == LOW;
+                    lines.push_back(std::to_string(eventMs) + " " + OUTPUT_NAMES[index].name + (on ? " ON" : " OFF"));
+                }
+            }
+        } while (count == EVENT_MAX_PER_REQUEST);
+    }
+
+    const std::vector<std::string>& getLines() const { return lines; }
+
+private:
+    std::vector<int> levels;
+    std::vector<std::string> lines;
+    uint32_t eventSeq;
+    uint32_t startMs;
+
+    static int initialLevel(uint8_t pin) { return pin == RELAY_PIN ? LOW : HIGH; }
+};
+
+static std::vector<std::string> readLines(const char* path, bool& found) {
+    std::vector<std::string> lines;
+    std::ifstream file(path);
+    found = (bool)file;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line[0] != '#') lines.push_back(line);
+    }
+    return lines;
+}
+
+static int compareGolden(const std::vector<std::string>& actual, const char* path) {
+    bool found;
+    std::vector<std::string> expected = readLines(path, found);
+    if (!found) {
+        fprintf(stderr, "[replay] cannot read golden timeline %s (use --update to create it)\n", path);
+        return 1;
+    }
+
+    size_t count = actual.size() > expected.size() ? actual.size() : expected.size();
+    int mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char* want = i < expected.size() ? expected[i].c_str() : "(end)";
+        const char* got = i < actual.size() ? actual[i].c_str() : "(end)";
+        if (strcmp(want, got) == 0) continue;
+        if (mismatches++ < 10) fprintf(stderr, "[replay] line %zu: expected '%s', got '%s'\n", i + 1, want, got);
+    }
+    if (mismatches > 0) {
+        fprintf(stderr, "[replay] FAIL: %d of %zu timeline lines differ from %s\n", mismatches, count, path);
+        return 1;
+    }
+    fprintf(stderr, "[replay] PASS: %zu timeline lines match %s\n", count, path);
+    return 0;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: pdu_replay [--tick-ms N] [--tail-s S] [--verbose] [--golden FILE [--update]] TRACE\n"
+            "       pdu_replay --decode TRACE\n"
+            "       pdu_replay --encode TRACE OUT\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    uint32_t tickMs = 1;
+    uint32_t tailS = 60;
+    bool verbose = false;
+    bool update = false;
+    bool decode = false;
+    const char* encodePath = nullptr;
+    const char* goldenPath = nullptr;
+    const char* tracePath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--tick-ms") == 0 && hasValue) tickMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--tail-s") == 0 && hasValue) tailS = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--golden") == 0 && hasValue) goldenPath = argv[++i];
+        else if (strcmp(argv[i], "--update") == 0) update = true;
+        else if (strcmp(argv[i], "--verbose") == 0) verbose = true;
+        else if (strcmp(argv[i], "--decode") == 0) decode = true;
+        else if (strcmp(argv[i], "--encode") == 0 && hasValue) {
+            tracePath = argv[++i];
+            if (i + 1 >= argc) usage();
+            encodePath = argv[++i];
+        }
+        else if (argv[i][0] != '-' && tracePath == nullptr) tracePath = argv[i];
+        else usage();
+    }
+    if (tracePath == nullptr || (update && goldenPath == nullptr)) usage();
+    if (tickMs == 0) tickMs = 1;
+
+    std::vector<TraceRecord> records;
+    std::string error;
+    if (!loadTrace(tracePath, records, error)) {
+        fprintf(stderr, "[replay] %s: %s\n", tracePath, error.c_str());
+        return 1;
+    }
+    if (decode) {
+        printText(stdout, records);
+        return 0;
+    }
+    if (encodePath != nullptr) {
+        if (!writeBinary(encodePath, records)) {
+            fprintf(stderr, "[replay] cannot write %s\n", encodePath);
+            return 1;
+        }
+        return 0;
+    }
+
+    // The timeline keeps the real stdout; firmware serial output goes elsewhere
+    FILE* timelineOut = fdopen(dup(STDOUT_FILENO), "w");
+    int sink = verbose ? dup(STDERR_FILENO) : open("/dev/null", O_WRONLY);
+    dup2(sink, STDOUT_FILENO);
+    close(sink);
+
+    signal(SIGPIPE, SIG_IGN);
+    setenv("PDU_PORT_OFFSET", "29000", 0);
+    SimHardware::setVirtualTime(true);
+
+    // Traces without a snapshot marker (hand-written ones) start with defaults at time 0
+    size_t next = 0;
+    size_t snapshotEnd = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        if (records[i].type == TRACE_START) snapshotEnd = i + 1;
+    }
+    for (; next < snapshotEnd; next++) {
+        const TraceRecord& record = records[next];
+        if (record.type == TRACE_CMD) SerialCommandHandler::handleCommand(record.command.c_str(), pdu);
+        else applyInput(record);
+    }
+
+    OutputTimeline timeline;
+    timeline.begin(millis());
+    uint32_t startMs = millis();
+    uint32_t endMs = (records.empty() ? 0 : records.back().timeMs) + tailS * 1000;
+    uint64_t ticks = 0;
+    uint32_t commands = 0;
+
+    setup();
+    timeline.collect();
+
+    for (;;) {
+        uint32_t elapsed = millis() - startMs;
+        for (; next < records.size() && records[next].timeMs <= elapsed; next++) {
+            const TraceRecord& record = records[next];
+            if (record.type == TRACE_CMD) {
+                Serial.pushInput((record.command + "\n").c_str());
+                commands++;
+            } else {
+                applyInput(record);
+            }
+        }
+
+        loop();
+        timeline.collect();
+        ticks++;
+
+        if (next >= records.size() && elapsed >= endMs) break;
+        SimHardware::advanceMicros((uint64_t)tickMs * 1000);
+    }
+
+    const std::vector<std::string>& lines = timeline.getLines();
+    fprintf(stderr, "[replay] %s: %zu records, %u commands, %.1f s replayed in %llu ticks, %zu output changes\n",
+            tracePath, records.size(), commands, (millis() - startMs) / 1000.0, (unsigned long long)ticks,
+            lines.size());
+
+    int status = 0;
+    if (goldenPath != nullptr && update) {
+        FILE* golden = fopen(goldenPath, "w");
+        if (golden == nullptr) {
+            fprintf(stderr, "[replay] cannot write %s\n", goldenPath);
+            status = 1;
+        } else {
+            const char* traceName = strrchr(tracePath, '/') ? strrchr(tracePath, '/') + 1 : tracePath;
+            fprintf(golden, "# Output timeline of %s (ms since trace start)\n", traceName);
+            for (const std::string& line : lines) fprintf(golden, "%s\n", line.c_str());
+            fclose(golden);
+            fprintf(stderr, "[replay] golden timeline written to %s\n", goldenPath);
+        }
+    } else if (goldenPath != nullptr) {
+        status = compareGolden(lines, goldenPath);
+    } else {
+        for (const std::string& line : lines) fprintf(timelineOut, "%s\n", line.c_str());
+    }
+
+    fflush(timelineOut);
+    fflush(stdout);
+    _exit(status);
+}
@@ -0,0 +1,172 @@
+/*
+ * PDU Heap Soak Test
+ *
+ * Runs the firmware (setup()/loop() from src/) for a long stretch of
+ * virtual time against simulated hardware that cycles temperature, IGN,
+ * fuses and VP faults, and periodically sends serial queries. Every loop()
+ * iteration's allocation count comes from PDUHeap; the run fails if any
+ * steady-state or query tick after warm-up allocated. Ticks that change
+ * settings (which write flash) are reported but not asserted.
+ *
+ * Firmware serial output goes to stdout, the soak report to stderr.
+ *
+ * Usage:
+ *   pdu_soak [--hours H] [--tick-ms N] [--warmup-s S]
+ *
+ * Author: Ahmed Ellamie
+ * Email: ahmed.ellamiee@gmail.com
+ * Created: 5/7/2025
+ * Modified: 7/29/2025
+ */
+
+#include <Arduino.h>
+#include <signal.h>
+#include "pdu_config.h"
+#include "pdu_heap.h"
+#include "sim_hardware.h"
+
+void setup();
+void loop();
+
+static const uint64_t MINUTE_MS = 60000ULL;
+static const uint64_t HOUR_MS = 60 * MINUTE_MS;
+
+enum TickKind { TICK_STEADY, TICK_QUERY, TICK_CONFIG, TICK_KIND_COUNT };
+static const char* const TICK_KIND_NAMES[TICK_KIND_COUNT] = { "steady", "query", "config" };
+
+struct TickStats {
+    uint64_t ticks = 0;
+    uint64_t allocTicks = 0;
+    uint64_t allocs = 0;
+};
+
+// Triangle wave 25 -> 70 -> 25 degC over four hours, crossing both rule thresholds
+static float temperatureAt(uint64_t ms) {
+    const uint64_t period = 4 * HOUR_MS;
+    float phase = (float)(ms % period) / period;
+    float rise = phase < 0.5f ? phase * 2 : (1 - phase) * 2;
+    return 25.0f + 45.0f * rise;
+}
+
+// IGN off for 30 minutes every 3 hours (long enough for every IGN-off timer to expire)
+static int ignitionAt(uint64_t ms) {
+    return ms % (3 * HOUR_MS) >= 2 * HOUR_MS + 30 * MINUTE_MS ? LOW : HIGH;
+}
+
+int main(int argc, char** argv) {
+    double hours = 24;
+    uint32_t tickMs = 10;
+    uint32_t warmupS = 10;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--hours") == 0) hours = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--tick-ms") == 0) tickMs = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--warmup-s") == 0) warmupS = atoi(argv[i + 1]);
+        else {
+            fprintf(stderr, "usage: pdu_soak [--hours H] [--tick-ms N] [--warmup-s S]\n");
+            return 1;
+        }
+    }
+    if (tickMs == 0) tickMs = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+    setenv("PDU_PORT_OFFSET", "28000", 0);
+    SimHardware::setVirtualTime(true);
+
+    SimHardware::setPin(F1_PIN, HIGH);
+    SimHardware::setPin(F2_PIN, HIGH);
+    SimHardware::setPin(F3_PIN, HIGH);
+    SimHardware::setPin(F4_PIN, HIGH);
+    SimHardware::setPin(VP_PIN, LOW);
+    SimHardware::setPin(IGN_PIN, HIGH);
+    SimHardware::setAnalog(BAT_PIN, 1185);
+    SimHardware::setTemperature(25.0f);
+
+    setup();
+
+    const uint64_t startMs = millis();
+    const uint64_t durationMs = (uint64_t)(hours * HOUR_MS);
+    const uint64_t vpFaultTimes[] = { 1 * HOUR_MS, 10 * HOUR_MS };  // Stays below the lockout limit
+    TickStats stats[TICK_KIND_COUNT];
+    uint64_t reportedFailures = 0;
+    uint64_t nextReport = HOUR_MS;
+    uint64_t nextQuery = 10 * MINUTE_MS;
+    bool rulesLoaded = false;
+    bool rulesCleared = false;
+    bool telemetryEnabled = false;
+
+    for (uint64_t elapsed = 0; elapsed < durationMs; elapsed = SimHardware::nowMicros() / 1000 - startMs) {
+        SimHardware::advanceMicros((uint64_t)tickMs * 1000);
+
+        SimHardware::setTemperature(temperatureAt(elapsed));
+        SimHardware::setPin(IGN_PIN, ignitionAt(elapsed));
+        SimHardware::setPin(F3_PIN, elapsed % (2 * HOUR_MS) < 1000 && elapsed > 1000 ? LOW : HIGH);
+
+        int vpLevel = LOW;
+        for (uint64_t faultTime : vpFaultTimes) {
+            if (elapsed >= faultTime && elapsed < faultTime + 200) vpLevel = HIGH;
+        }
+        SimHardware::setPin(VP_PIN, vpLevel);
+
+        // Serial traffic, queued before loop() so the shim's own buffering is not counted
+        TickKind kind = TICK_STEADY;
+        if (!rulesLoaded && elapsed >= 5000) {
+            Serial.pushInput("SET_RULES:temp > 55 hyst 2 -> off ch3 else on ch3;"
+                             "temp >= 65 hyst 2 -> off relay;"
+                             "!ign for 5m -> off ch2, ch3, ch4;"
+                             "!ign for 20m || (!ign && bat < 12.2) -> off relay\n");
+            rulesLoaded = true;
+            kind = TICK_CONFIG;
+        } else if (!telemetryEnabled && elapsed >= 6000) {
+            // Nothing listens on port 1: batches are sampled, spooled and dropped, all in the loop
+            Serial.pushInput("SET_MQTT:127.0.0.1,1\n");
+            telemetryEnabled = true;
+            kind = TICK_CONFIG;
+        } else if (!rulesCleared && elapsed >= durationMs / 2) {
+            Serial.pushInput("SET_RULES:\n");  // Second half runs the built-in policy
+            rulesCleared = true;
+            kind = TICK_CONFIG;
+        } else if (elapsed >= nextQuery) {
+            Serial.pushInput("GET_STATUS\nGET_HEAP\nGET_EVENTS\nGET_RULES\nGET_VPTRIP\nGET_SEQ\nGET_MQTT\n");
+            nextQuery += 10 * MINUTE_MS;
+            kind = TICK_QUERY;
+        }
+
+        loop();
+
+        uint32_t allocs = PDUHeap::getLastTickAllocs();
+        if (elapsed >= nextReport) {
+            fprintf(stderr, "[soak] %3llu h: free=%u largest=%u minFree=%u allocating ticks=%llu\n",
+                    (unsigned long long)(elapsed / HOUR_MS), PDUHeap::getFree(), PDUHeap::getLargestBlock(),
+                    PDUHeap::getMinFree(),
+                    (unsigned long long)(stats[TICK_STEADY].allocTicks + stats[TICK_QUERY].allocTicks));
+            nextReport += HOUR_MS;
+        }
+        if (elapsed < warmupS * 1000ULL) continue;
+
+        TickStats& tick = stats[kind];
+        tick.ticks++;
+        tick.allocs += allocs;
+        if (allocs == 0) continue;
+        tick.allocTicks++;
+
+        if (kind != TICK_CONFIG && reportedFailures++ < 10) {
+            fprintf(stderr, "[soak] %s tick at %.3f s allocated %u times\n",
+                    TICK_KIND_NAMES[kind], elapsed / 1000.0, allocs);
+        }
+    }
+
+    fprintf(stderr, "[soak] %.1f h simulated, %u ms ticks\n", hours, tickMs);
+    for (int kind = 0; kind < TICK_KIND_COUNT; kind++) {
+        fprintf(stderr, "[soak] %-6s ticks=%llu allocating=%llu allocations=%llu\n", TICK_KIND_NAMES[kind],
+                (unsigned long long)stats[kind].ticks, (unsigned long long)stats[kind].allocTicks,
+                (unsigned long long)stats[kind].allocs);
+    }
+    fprintf(stderr, "[soak] heap free=%u largest=%u minFree=%u\n",
+            PDUHeap::getFree(), PDUHeap::getLargestBlock(), PDUHeap::getMinFree());
+
+    bool passed = stats[TICK_STEADY].allocTicks == 0 && stats[TICK_QUERY].allocTicks == 0;
+    fprintf(stderr, "[soak] %s\n", passed ? "PASS" : "FAIL: steady-state ticks allocated");
+    fflush(stdout);
+    _exit(passed ? 0 : 1);
+}